@@ -55,6 +55,9 @@ namespace SE {
 		void drawMainMenu();
 		void drawViewport();
 		void drawDebugWindows();
+		void drawStatsWindow();
+		void drawMemoryWindow();
+		void drawScenesWindow();
 
 		// Viewport management
 		void handleViewportResize(const ImVec2& newSize);
@@ -74,8 +77,11 @@ namespace SE {
 		bool m_ShowViewport = true;
 		bool m_ShowMetricsWindow = false;
 		bool m_ShowStyleEditor = false;
-		bool m_ShowStatsWindow = false;
+		bool m_ShowStatsWindow = true;
 		bool m_ShowDebugWindow = true;
+		bool m_ShowMemoryWindow = false;
+		bool m_ShowScenesWindow = true;
+		char m_ScenePath[256] = "house.glb";
 
 		// ImGui state
 		ImGuiID m_DockspaceID = 0;
@@ -2,6 +2,7 @@
 #include "Editor.hpp"
 #include "core/engine.hpp"
 #include "renderer/renderer.hpp"
+#include "scene/loaded_scene.hpp"
 #include "RHI/vulkan/vulkan_device.hpp"
 #include "RHI/vulkan/vulkan_swapchain.hpp"
 
@@ -249,6 +250,8 @@ namespace SE {
 				ImGui::MenuItem("Style Editor", NULL, &m_ShowStyleEditor);
 				ImGui::MenuItem("Stats", NULL, &m_ShowStatsWindow);
 				ImGui::MenuItem("Debug", NULL, &m_ShowDebugWindow);
+				ImGui::MenuItem("Memory", NULL, &m_ShowMemoryWindow);
+				ImGui::MenuItem("Scenes", NULL, &m_ShowScenesWindow);
 				ImGui::EndMenu();
 			}
 			ImGui::EndMenuBar();
@@ -311,6 +314,235 @@ namespace SE {
 		{
 			Timer::getInstance().drawImGuiWindow(&m_ShowDebugWindow);
 		}
+
+		if (m_ShowStatsWindow)
+		{
+			drawStatsWindow();
+		}
+
+		if (m_ShowMemoryWindow)
+		{
+			drawMemoryWindow();
+		}
+
+		if (m_ShowScenesWindow)
+		{
+			drawScenesWindow();
+		}
+	}
+
+	void Editor::drawScenesWindow()
+	{
+		if (ImGui::Begin("Scenes", &m_ShowScenesWindow))
+		{
+			ImGui::InputText("Asset", m_ScenePath, sizeof(m_ScenePath));
+			ImGui::SameLine();
+			if (ImGui::Button("Load"))
+			{
+				m_Engine->loadScene(m_ScenePath);
+			}
+
+			for (const auto& [fileName, scene] : m_Engine->getLoadedScenes())
+			{
+				const SceneImportStats& stats = scene->stats;
+				ImGui::Separator();
+				ImGui::Text("%s: %u instances, %u vertices, %u triangles, %u textures", fileName.c_str(),
+					stats.instances, stats.vertices, stats.triangles, stats.textures);
+				ImGui::Text("Parse %.2f ms, decode %.2f ms, upload %.2f ms", stats.parseMs, stats.decodeMs, stats.uploadMs);
+			}
+		}
+		ImGui::End();
+	}
+
+	void Editor::drawStatsWindow()
+	{
+		if (ImGui::Begin("Stats", &m_ShowStatsWindow))
+		{
+			rhi::IDevice* device = m_Engine->getRenderer().getDevice();
+
+			const char* queueNames[] = { "Graphics", "Compute", "Copy" };
+			if (ImGui::BeginTable("Submissions", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+			{
+				ImGui::TableSetupColumn("Queue");
+				ImGui::TableSetupColumn("Submit calls");
+				ImGui::TableSetupColumn("Queue submits");
+				ImGui::TableSetupColumn("Command buffers");
+				ImGui::TableSetupColumn("Submit (ms)");
+				ImGui::TableSetupColumn("Present (ms)");
+				ImGui::TableHeadersRow();
+
+				for (uint32_t i = 0; i < 3; ++i)
+				{
+					rhi::QueueSubmissionStats stats = device->getSubmissionStats((rhi::CommandType)i);
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn(); ImGui::TextUnformatted(queueNames[i]);
+					ImGui::TableNextColumn(); ImGui::Text("%u", stats.submitRequests);
+					ImGui::TableNextColumn(); ImGui::Text("%u", stats.queueSubmits);
+					ImGui::TableNextColumn(); ImGui::Text("%u", stats.commandBuffers);
+					ImGui::TableNextColumn(); ImGui::Text("%.3f", stats.submitTimeMs);
+					ImGui::TableNextColumn(); ImGui::Text("%.3f", stats.presentTimeMs);
+				}
+				ImGui::EndTable();
+			}
+
+			Renderer& renderer = m_Engine->getRenderer();
+			const rhi::PipelineStatistics& pipelineStats = renderer.getForwardPassStatistics();
+			ImGui::Text("GPU frame: %.3f ms", renderer.getGpuFrameTimeMs());
+			ImGui::Text("Forward pass: %llu primitives, %llu VS / %llu PS invocations",
+				(unsigned long long)pipelineStats.clippingPrimitives, (unsigned long long)pipelineStats.vertexShaderInvocations,
+				(unsigned long long)pipelineStats.pixelShaderInvocations);
+			if (renderer.isMeshShadingEnabled())
+			{
+				ImGui::Text("Forward pass: %llu task / %llu mesh invocations", (unsigned long long)pipelineStats.taskShaderInvocations,
+					(unsigned long long)pipelineStats.meshShaderInvocations);
+			}
+
+			const rhi::CommandListStats& cmdStats = renderer.getCommandListStats();
+			ImGui::Separator();
+			ImGui::Text("Pipeline binds: %u (filtered %u)", cmdStats.pipelineBinds, cmdStats.filteredPipelineBinds);
+			ImGui::Text("Dynamic state: %u (filtered %u)", cmdStats.dynamicStateSets, cmdStats.filteredDynamicStateSets);
+			ImGui::Text("Constant uploads: %u (filtered %u)", cmdStats.constantUploads, cmdStats.filteredConstantUploads);
+
+			const UploadStats& uploadStats = renderer.getUploadStats();
+			ImGui::Text("Uploads: %.1f KB direct, %.1f KB staged%s", uploadStats.directBytes / 1024.0f, uploadStats.stagingBytes / 1024.0f,
+				device->isDirectUploadSupported() ? "" : " (no ReBAR/UMA)");
+			ImGui::Text("Staged uploads: %u, copy commands: %u (%u regions)", uploadStats.stagedUploads, uploadStats.copyCommands, uploadStats.copyRegions);
+			ImGui::Text("Copy queue: %.3f ms, %.1f MB/s", renderer.getUploadTimeMs(), renderer.getUploadThroughputMBps());
+
+			const float toMB = 1.0f / (1024.0f * 1024.0f);
+			StagingStats stagingStats = renderer.getStagingStats();
+			ImGui::Text("Staging: %.1f / %.1f MB (peak %.1f MB), stall %.2f ms, streaming %.1f MB",
+				stagingStats.usedSize * toMB, stagingStats.ringSize * toMB, stagingStats.highWater * toMB,
+				stagingStats.stallTimeMs, stagingStats.streamingBytes * toMB);
+			const InstanceUploadStats& instanceStats = renderer.getInstanceUploadStats();
+			ImGui::Text("Instance uploads: %u dirty, %u copy runs, %u scattered, %.1f KB", instanceStats.dirtyInstances,
+				instanceStats.copyRegions, instanceStats.scatteredInstances, instanceStats.uploadBytes / 1024.0f);
+			StaticBufferStats staticStats = renderer.getGpuScene()->getStaticBufferStats();
+			ImGui::Text("Static buffer: %.1f / %.1f MB, %u relocations pending, %.1f MB relocated", staticStats.usedSize * toMB,
+				staticStats.bufferSize * toMB, staticStats.pendingRelocations, staticStats.relocatedBytes * toMB);
+			ImGui::SameLine();
+			if (ImGui::Button("Compact"))
+			{
+				renderer.getGpuScene()->requestStaticBufferDefragmentation();
+			}
+			AsyncUploadStats asyncStats = renderer.getAsyncUploadStats();
+			ImGui::Text("Async uploads: %u jobs, %.1f MB pending, completed %llu / %llu", asyncStats.pendingJobs, asyncStats.pendingBytes * toMB,
+				(unsigned long long)asyncStats.completedValue, (unsigned long long)asyncStats.submittedValue);
+			rhi::ConstantBufferStats cbStats = device->getConstantBufferStats();
+			ImGui::Text("Constants: %.1f KB/frame (peak %.1f KB), ring %.1f/%.1f MB (peak %.1f MB), %u overflow blocks",
+				cbStats.frameSize / 1024.0f, cbStats.frameHighWater / 1024.0f,
+				cbStats.ringUsedSize * toMB, cbStats.ringSize * toMB, cbStats.ringHighWater * toMB, cbStats.overflowBlockCount);
+
+			rhi::DescriptorCacheStats cacheStats = device->getDescriptorCacheStats();
+			ImGui::Text("Samplers: %u live, %.1f%% hits", cacheStats.liveSamplers,
+				cacheStats.samplerRequests ? 100.0f * cacheStats.samplerHits / cacheStats.samplerRequests : 0.0f);
+			ImGui::Text("Views: %u live, %.1f%% hits", cacheStats.liveViews,
+				cacheStats.viewRequests ? 100.0f * cacheStats.viewHits / cacheStats.viewRequests : 0.0f);
+
+			if (ImGui::Button("Save screenshot"))
+			{
+				renderer.requestScreenshot("screenshot.ppm");
+			}
+
+			ImGui::Separator();
+			bool meshShading = renderer.isMeshShadingEnabled();
+			ImGui::BeginDisabled(!device->isMeshShadingSupported());
+			if (ImGui::Checkbox("Meshlet culling (mesh shaders)", &meshShading))
+			{
+				renderer.setMeshShadingEnabled(meshShading);
+			}
+			ImGui::EndDisabled();
+		}
+		ImGui::End();
+	}
+
+	void Editor::drawMemoryWindow()
+	{
+		if (ImGui::Begin("Memory", &m_ShowMemoryWindow))
+		{
+			Renderer& renderer = m_Engine->getRenderer();
+			rhi::MemoryStats stats = renderer.getDevice()->getMemoryStats();
+			const float toMB = 1.0f / (1024.0f * 1024.0f);
+
+			if (ImGui::BeginTable("Categories", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+			{
+				ImGui::TableSetupColumn("Category");
+				ImGui::TableSetupColumn("Allocated (MB)");
+				ImGui::TableSetupColumn("Peak (MB)");
+				ImGui::TableSetupColumn("Allocations");
+				ImGui::TableHeadersRow();
+
+				for (uint32_t i = 0; i < (uint32_t)rhi::MemoryCategory::Count; ++i)
+				{
+					const rhi::MemoryCategoryStats& category = stats.categories[i];
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn(); ImGui::TextUnformatted(rhi::getMemoryCategoryName((rhi::MemoryCategory)i));
+					ImGui::TableNextColumn(); ImGui::Text("%.2f", category.allocatedBytes * toMB);
+					ImGui::TableNextColumn(); ImGui::Text("%.2f", category.peakBytes * toMB);
+					ImGui::TableNextColumn(); ImGui::Text("%u", category.allocationCount);
+				}
+				ImGui::EndTable();
+			}
+
+			if (ImGui::BeginTable("Pools", 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+			{
+				ImGui::TableSetupColumn("Pool");
+				ImGui::TableSetupColumn("Allocations");
+				ImGui::TableSetupColumn("Blocks");
+				ImGui::TableSetupColumn("Used / Reserved (MB)");
+				ImGui::TableSetupColumn("Fragmentation");
+				ImGui::TableHeadersRow();
+
+				for (uint32_t i = 0; i < (uint32_t)rhi::MemoryPoolType::Count; ++i)
+				{
+					const rhi::MemoryPoolStats& pool = stats.pools[i];
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn(); ImGui::TextUnformatted(rhi::getMemoryPoolName((rhi::MemoryPoolType)i));
+					ImGui::TableNextColumn(); ImGui::Text("%u", pool.allocationCount);
+					ImGui::TableNextColumn(); ImGui::Text("%u", pool.blockCount);
+					ImGui::TableNextColumn(); ImGui::Text("%.2f / %.2f", pool.allocatedBytes * toMB, pool.blockBytes * toMB);
+					ImGui::TableNextColumn(); ImGui::Text("%.1f%%", pool.fragmentation * 100.0f);
+				}
+				ImGui::EndTable();
+			}
+
+			if (ImGui::BeginTable("Heaps", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+			{
+				ImGui::TableSetupColumn("Heap");
+				ImGui::TableSetupColumn("Usage (MB)");
+				ImGui::TableSetupColumn("Budget (MB)");
+				ImGui::TableSetupColumn("Peak (MB)");
+				ImGui::TableSetupColumn("Size (MB)");
+				ImGui::TableSetupColumn("Device local");
+				ImGui::TableHeadersRow();
+
+				for (uint32_t i = 0; i < stats.heapCount; ++i)
+				{
+					const rhi::MemoryHeapStats& heap = stats.heaps[i];
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn(); ImGui::Text("%u", i);
+					ImGui::TableNextColumn(); ImGui::Text("%.2f", heap.usageBytes * toMB);
+					ImGui::TableNextColumn(); ImGui::Text("%.2f", heap.budgetBytes * toMB);
+					ImGui::TableNextColumn(); ImGui::Text("%.2f", heap.peakUsageBytes * toMB);
+					ImGui::TableNextColumn(); ImGui::Text("%.2f", heap.sizeBytes * toMB);
+					ImGui::TableNextColumn(); ImGui::TextUnformatted(heap.deviceLocal ? "Yes" : "No");
+				}
+				ImGui::EndTable();
+			}
+
+			if (ImGui::Button("Dump JSON"))
+			{
+				renderer.dumpMemoryStats("memory_stats.json");
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Defragment"))
+			{
+				renderer.requestMemoryDefragmentation();
+			}
+			ImGui::SameLine();
+			ImGui::Text("Last defragmentation moved %.2f MB", renderer.getLastDefragmentedBytes() * toMB);
+		}
+		ImGui::End();
 	}
 
 	void Editor::beginFrame() {
@@ -345,6 +577,8 @@ namespace SE {
 
 		//vkCmdBeginRendering(cmd, &renderInfo);
 		ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), (VkCommandBuffer)cmd->getHandle());
+		// ImGui records its own pipeline, viewport and descriptor state
+		cmd->resetState();
 		//vkCmdEndRendering(cmd);
 	}
 
@@ -368,7 +602,7 @@ namespace SE {
 
 	void Editor::shutdown() {
 		rhi::vulkan::VulkanDevice* device = (rhi::vulkan::VulkanDevice*)m_Engine->getRenderer().getDevice();
-		vkDeviceWaitIdle(device->getDevice());
+		device->waitIdle();
 
 		destroyViewportResources();
 
@@ -14,6 +14,15 @@ namespace rhi {
 		virtual void* getCpuAddress() = 0;
 		// Returns true if buffer is currently mapped
 		virtual bool isMapped() const = 0;
+		// Makes GPU writes visible to mapped memory that is not host coherent
+		virtual void invalidate(uint64_t offset, uint64_t size) = 0;
+		// Makes CPU writes visible to the GPU for mapped memory that is not host coherent
+		virtual void flush(uint64_t offset, uint64_t size) = 0;
+
+		// Sparse buffers only, residency reflects the tile mappings submitted so far
+		virtual uint32_t getTileSize() const = 0;
+		virtual bool isTileResident(uint32_t tile) const = 0;
+		virtual uint32_t getResidentTileCount() const = 0;
 
 		const BufferDescription& getDescription() const { return m_Description; }
 	protected:
@@ -10,12 +10,16 @@ namespace rhi
 	class ISwapchain;
 	class IDescriptor;
 	class IPipelineState;
+	class IQueryHeap;
+	class IHeap;
 
 	class ICommandList : public IResource {
 	public:
 		virtual ~ICommandList() {}
 
 		CommandType getQueueType() const { return m_CommandType; }
+		const CommandListStats& getStats() const { return m_Stats; }
+		void resetStats() { m_Stats = {}; }
 
 		virtual void resetAllocator() = 0;
 		virtual void begin() = 0;
@@ -27,13 +31,22 @@ namespace rhi
 		virtual void resetState() = 0;
 
 		virtual void copyBufferToTexture(ITexture* dstTexture, uint32_t mipLevel, uint32_t arraySlice, IBuffer* srcBuffer, uint32_t offset) = 0;
+		// Copies all listed subresources with a single command, footprint offsets are relative to offset
+		virtual void copyBufferToTexture(ITexture* dstTexture, IBuffer* srcBuffer, uint32_t offset, uint32_t footprintCount, const SubresourceFootprint* footprints) = 0;
 		virtual void copyTextureToBuffer(IBuffer* dstBuffer, uint32_t offset, ITexture* srcTexture, uint32_t mipLevel, uint32_t arraySlice) = 0;
 		virtual void copyBuffer(IBuffer* dstBuffer, uint32_t dstOffset, IBuffer* srcBuffer, uint32_t srcOffset, uint32_t size) = 0;
+		// Destination regions must not overlap
+		virtual void copyBuffer(IBuffer* dstBuffer, IBuffer* srcBuffer, uint32_t regionCount, const BufferCopyRegion* regions) = 0;
 		virtual void copyTexture(ITexture* dstTexture, uint32_t dstMip, uint32_t dstArray, ITexture* srcTexture, uint32_t srcMip, uint32_t srcArray) = 0;
 		virtual void clearStorageBuffer(IResource* resource, IDescriptor* storage, const float* clearValue) = 0;
 		virtual void clearStorageBuffer(IResource* resource, IDescriptor* storage, const uint32_t* clearValue) = 0;
 		virtual void writeBuffer(IBuffer* dstBuffer, uint32_t offset, uint32_t data) = 0;
-		//virtual void updateTileMappings(Texture* dstTexture, Heap* dstHeap, uint32_t mappingCount, const TileMapping* mappings) = 0;
+		// Executed on the sparse binding queue when the command list is submitted, ordered between the work submitted
+		// before it and this command list. All mappings are bound before any command of the list runs, including
+		// commands recorded before the call; submit a separate command list to use a resource ahead of a remap.
+		// Mappings onto a heap whose memory type the resource does not accept are rejected
+		virtual void updateTileMappings(ITexture* dstTexture, IHeap* dstHeap, uint32_t mappingCount, const TileMapping* mappings) = 0;
+		virtual void updateTileMappings(IBuffer* dstBuffer, IHeap* dstHeap, uint32_t mappingCount, const TileMapping* mappings) = 0;
 
 		virtual void textureBarrier(ITexture* texture, ResourceAccessFlags accessBefore, ResourceAccessFlags accessAfter) = 0;
 		virtual void textureBarrier(ITexture* texture, uint32_t subResource, ResourceAccessFlags accessBefore, ResourceAccessFlags accessAfter) = 0;
@@ -41,6 +54,13 @@ namespace rhi
 		virtual void globalBarrier(ResourceAccessFlags accessBefore, ResourceAccessFlags accessAfter) = 0;
 		virtual void flushBarriers() = 0;
 
+		// Pipeline statistics and occlusion queries
+		virtual void beginQuery(IQueryHeap* heap, uint32_t index) = 0;
+		virtual void endQuery(IQueryHeap* heap, uint32_t index) = 0;
+		virtual void writeTimestamp(IQueryHeap* heap, uint32_t index) = 0;
+		// Copies the results into the heap's readback ring and resets the queries for reuse, must be recorded outside a render pass
+		virtual void resolveQueries(IQueryHeap* heap, uint32_t startIndex, uint32_t count) = 0;
+
 		virtual void beginRenderPass(const RenderPassDescription& renderPass) = 0;
 		virtual void endRenderPass() = 0;
 		virtual void bindPipeline(IPipelineState* state) = 0;
@@ -55,19 +75,21 @@ namespace rhi
 		virtual void draw(uint32_t vertexCount, uint32_t instanceCount = 1) = 0;
 		virtual void drawIndexed(uint32_t indexCount, uint32_t instanceCount = 1, uint32_t indexOffset = 0) = 0;
 		virtual void dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) = 0;
-		//virtual void dispatchMesh(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) = 0;
+		virtual void dispatchMesh(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) = 0;
 
-		//virtual void drawIndirect(Buffer* buffer, uint32_t offset) = 0;
-		//virtual void drawIndexedIndirect(Buffer* buffer, uint32_t offset) = 0;
-		//virtual void dispatchIndirect(Buffer* buffer, uint32_t offset) = 0;
-		//virtual void dispatchMeshIndirect(Buffer* buffer, uint32_t offset) = 0;
+		virtual void drawIndirect(IBuffer* buffer, uint32_t offset) = 0;
+		virtual void drawIndexedIndirect(IBuffer* buffer, uint32_t offset) = 0;
+		virtual void dispatchIndirect(IBuffer* buffer, uint32_t offset) = 0;
+		virtual void dispatchMeshIndirect(IBuffer* buffer, uint32_t offset) = 0;
 
-		//virtual void multiDrawIndirect(uint32_t maxCount, Buffer* argsBuffer, uint32_t argsOffset, Buffer* countBuffer, uint32_t countOffset) = 0;
-		//virtual void multiDrawIndexedIndirect(uint32_t maxCount, Buffer* argsBuffer, uint32_t argsOffset, Buffer* countBuffer, uint32_t countOffset) = 0;
+		// countBuffer may be null, then exactly maxCount commands are drawn
+		virtual void multiDrawIndirect(uint32_t maxCount, IBuffer* argsBuffer, uint32_t argsOffset, IBuffer* countBuffer, uint32_t countOffset) = 0;
+		virtual void multiDrawIndexedIndirect(uint32_t maxCount, IBuffer* argsBuffer, uint32_t argsOffset, IBuffer* countBuffer, uint32_t countOffset) = 0;
 		//virtual void multiDispatchIndirect(uint32_t maxCount, Buffer* argsBuffer, uint32_t argsOffset, Buffer* countBuffer, uint32_t countOffset) = 0;
-		//virtual void multiDispatchMeshIndirect(uint32_t maxCount, Buffer* argsBuffer, uint32_t argsOffset, Buffer* countBuffer, uint32_t countOffset) = 0;
+		virtual void multiDispatchMeshIndirect(uint32_t maxCount, IBuffer* argsBuffer, uint32_t argsOffset, IBuffer* countBuffer, uint32_t countOffset) = 0;
 
 	protected:
 		CommandType m_CommandType;
+		CommandListStats m_Stats;
 	};
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include"types.hpp"
 #include <cstdint>
+#include <functional>
 #include <span>
 #include <string>
 
@@ -13,6 +14,11 @@ namespace rhi {
 	class IShader;
 	class IPipelineState;
 	class IDescriptor;
+	class IQueryHeap;
+
+	// Called from endFrame when the usage of a heap rises above the threshold fraction of its budget
+	using MemoryBudgetCallback = std::function<void(uint32_t heapIndex, const MemoryHeapStats& heap)>;
+
 	class IDevice
 	{
 	public:
@@ -22,7 +28,14 @@ namespace rhi {
 		virtual void endFrame() = 0;
 
 		uint64_t getFrameID() const { return m_FrameID % SE::SE_MAX_FRAMES_IN_FLIGHT; };
+		// Frames ended since device creation, unlike getFrameID it does not wrap
+		uint64_t getFrameCount() const { return m_FrameID; }
 		const DeviceDescription& getDescription() const { return m_Description; }
+		bool isMeshShadingSupported() const { return m_MeshShadingSupported; }
+		// Device local memory is CPU writable (resizable BAR, UMA or software drivers)
+		bool isDirectUploadSupported() const { return m_DirectUploadSupported; }
+		// Sparse textures and buffers, their tiles are bound on a dedicated queue
+		bool isSparseResourceSupported() const { return m_SparseResourceSupported; }
 
 		// Core resource creation
 		virtual ICommandList* createCommandList(CommandType queue_type, const std::string& name) = 0;
@@ -33,15 +46,43 @@ namespace rhi {
 		virtual IShader* createShader(const ShaderDescription& desc, std::span<std::byte> data, const std::string& name) = 0;
 		virtual IPipelineState* createGraphicsPipelineState(const GraphicsPipelineDescription& desc, const std::string& name) = 0;
 		virtual IPipelineState* createComputePipelineState(const ComputePipelineDescription& desc, const std::string& name) = 0;
+		virtual IPipelineState* createMeshShadingPipelineState(const MeshShadingPipelineDescription& desc, const std::string& name) = 0;
 		virtual IDescriptor* createShaderResourceViewDescriptor(IResource* resource, const ShaderResourceViewDescriptorDescription& desc, const std::string& name) = 0;
 		virtual IDescriptor* createUnorderedAccessDescriptor(IResource* resource, const UnorderedAccessDescriptorDescription& desc, const std::string& name) = 0;
 		virtual IDescriptor* createConstantBufferDescriptor(IBuffer* buffer, const ConstantBufferDescriptorDescription& desc, const std::string& name) = 0;
 		virtual IDescriptor* createSampler(const SamplerDescription& desc, const std::string& name) = 0;
 		virtual IHeap* createHeap(const HeapDescription& desc, const std::string& name) = 0;
+		virtual IQueryHeap* createQueryHeap(const QueryHeapDescription& desc, const std::string& name) = 0;
 
 		virtual uint32_t getAllocationSize(const rhi::TextureDescription& desc) = 0;
+		// Size and alignment a resource needs when placed in an IHeap
+		virtual MemoryRequirements getMemoryRequirements(const TextureDescription& desc) = 0;
+		virtual MemoryRequirements getMemoryRequirements(const BufferDescription& desc) = 0;
+
+		// Timestamp ticks per second
+		virtual uint64_t getTimestampFrequency() const = 0;
+		// Not every queue family can write timestamps, copy queues in particular
+		virtual bool isTimestampSupported(CommandType type) const = 0;
+		// Returns false if the device can not sample both clocks together
+		virtual bool getCalibratedTimestamp(CalibratedTimestamp& timestamp) = 0;
+
+		// Stats of the last completed frame
+		virtual QueueSubmissionStats getSubmissionStats(CommandType type) const = 0;
+
+		// Memory accounting, heap usage is sampled once per frame
+		virtual MemoryStats getMemoryStats() const = 0;
+		virtual void setMemoryBudgetCallback(float threshold, MemoryBudgetCallback callback) = 0;
+		// Runs one step of compacting the upload pool, call once per frame until it returns false.
+		// Memory moved by a step is released once the frame fences passed the frame it was moved in
+		virtual bool defragmentMemory() = 0;
+		virtual uint64_t getLastDefragmentedBytes() const = 0;
+		virtual DescriptorCacheStats getDescriptorCacheStats() const = 0;
+		virtual ConstantBufferStats getConstantBufferStats() const = 0;
 	protected:
 		DeviceDescription m_Description;
 		uint64_t m_FrameID = 0;
+		bool m_MeshShadingSupported = false;
+		bool m_DirectUploadSupported = false;
+		bool m_SparseResourceSupported = false;
 	};
 }
\ No newline at end of file
@@ -5,5 +5,7 @@ namespace rhi {
 	public:
 		virtual void wait(uint64_t value) = 0;
 		virtual void signal(uint64_t value) = 0;
+		// Last value signaled on the GPU timeline, does not block
+		virtual uint64_t getCompletedValue() const = 0;
 	};
 }
\ No newline at end of file
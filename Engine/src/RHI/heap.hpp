@@ -9,6 +9,11 @@ namespace rhi
 	public:
 		const HeapDescription& getDescription() const { return m_Description; }
 
+		// TLSF sub-allocation of the heap memory, returns false if no free range fits
+		virtual bool allocate(uint32_t size, uint32_t alignment, HeapAllocation& allocation) = 0;
+		virtual void free(HeapAllocation& allocation) = 0;
+		virtual uint32_t getUsedSize() const = 0;
+
 	protected:
 		HeapDescription m_Description = {};
 	};
@@ -0,0 +1,25 @@
+#pragma once
+#include "resource.hpp"
+#include "types.hpp"
+
+namespace rhi
+{
+	// Resolved results land in a per-frame readback ring, so they can be read SE_MAX_FRAMES_IN_FLIGHT frames later without waiting on the GPU.
+	// Timestamp and occlusion results are uint64_t per query, pipeline statistics are PipelineStatistics per query.
+	class IQueryHeap : public IResource
+	{
+	public:
+		const QueryHeapDescription& getDescription() const { return m_Description; }
+
+		// Reads the results resolved the last time the current frame slot was used, false if that slot holds no results yet
+		virtual bool readResults(uint32_t startIndex, uint32_t count, void* data) = 0;
+
+	protected:
+		QueryHeapDescription m_Description = {};
+	};
+
+	inline uint32_t getQueryResultSize(QueryType type)
+	{
+		return type == QueryType::PipelineStatistics ? sizeof(PipelineStatistics) : sizeof(uint64_t);
+	}
+}
\ No newline at end of file
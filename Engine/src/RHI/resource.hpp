@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include <string>
 
 namespace rhi {
@@ -12,9 +13,15 @@ namespace rhi {
 		virtual bool isBuffer() const { return false; }
 
 		const std::string& getDebugName() const { return m_DebugName; }
+		// Never reused, unlike the address of a destroyed resource
+		uint64_t getUniqueID() const { return m_UniqueID; }
 
 	protected:
 		IDevice* m_Device = nullptr;
 		std::string m_DebugName;
+
+	private:
+		inline static std::atomic<uint64_t> s_NextUniqueID = 1;
+		uint64_t m_UniqueID = s_NextUniqueID.fetch_add(1, std::memory_order_relaxed);
 	};
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #pragma once
 #include "rhi.hpp"
 #include"vulkan\vulkan_device.hpp"
+#include <algorithm>
 
 namespace rhi
 {
@@ -124,9 +125,159 @@ namespace rhi
 		case Format::S8_UINT:
 			return width * 1;
 
-			// Compressed/YUV formats (return 0 or handle differently)
+			// YUV formats have no single row pitch
+		case Format::Unknown:
+		case Format::YUV420_8BIT:
+		case Format::YUV420_10BIT:
+		case Format::YUV422_8BIT:
+		case Format::YUV422_10BIT:
+		case Format::YUV444_8BIT:
+		case Format::YUV444_10BIT:
+			return 0;
+
+			// Block compressed formats, pitch of one row of blocks
+		default:
+			return (width + getFormatBlockWidth(format) - 1) / getFormatBlockWidth(format) * getFormatBlockSize(format);
+		}
+	}
+
+	uint32_t getFormatBlockWidth(Format format) {
+		switch (format) {
+		case Format::BC1_UNORM:
+		case Format::BC1_SRGB:
+		case Format::BC2_UNORM:
+		case Format::BC2_SRGB:
+		case Format::BC3_UNORM:
+		case Format::BC3_SRGB:
+		case Format::BC4_UNORM:
+		case Format::BC4_SNORM:
+		case Format::BC5_UNORM:
+		case Format::BC5_SNORM:
+		case Format::BC6H_UFLOAT:
+		case Format::BC6H_SFLOAT:
+		case Format::BC7_UNORM:
+		case Format::BC7_SRGB:
+		case Format::ASTC_4x4_UNORM:
+		case Format::ASTC_4x4_SRGB:
+		case Format::ETC2_R8G8B8_UNORM:
+		case Format::ETC2_R8G8B8_SRGB:
+		case Format::ETC2_R8G8B8A1_UNORM:
+		case Format::ETC2_R8G8B8A1_SRGB:
+		case Format::ETC2_R8G8B8A8_UNORM:
+		case Format::ETC2_R8G8B8A8_SRGB:
+		case Format::EAC_R11_UNORM:
+		case Format::EAC_R11_SNORM:
+		case Format::EAC_R11G11_UNORM:
+		case Format::EAC_R11G11_SNORM:
+			return 4;
+		case Format::ASTC_5x5_UNORM:
+		case Format::ASTC_5x5_SRGB:
+			return 5;
+		case Format::ASTC_6x6_UNORM:
+		case Format::ASTC_6x6_SRGB:
+			return 6;
+		case Format::ASTC_8x8_UNORM:
+		case Format::ASTC_8x8_SRGB:
+			return 8;
+		case Format::ASTC_10x10_UNORM:
+		case Format::ASTC_10x10_SRGB:
+			return 10;
+		case Format::ASTC_12x12_UNORM:
+		case Format::ASTC_12x12_SRGB:
+			return 12;
+		default:
+			return 1;
+		}
+	}
+
+	uint32_t getFormatBlockHeight(Format format) {
+		// All supported block compressed formats use square blocks
+		return getFormatBlockWidth(format);
+	}
+
+	uint32_t getFormatBlockSize(Format format) {
+		switch (format) {
+		case Format::BC1_UNORM:
+		case Format::BC1_SRGB:
+		case Format::BC4_UNORM:
+		case Format::BC4_SNORM:
+		case Format::ETC2_R8G8B8_UNORM:
+		case Format::ETC2_R8G8B8_SRGB:
+		case Format::ETC2_R8G8B8A1_UNORM:
+		case Format::ETC2_R8G8B8A1_SRGB:
+		case Format::EAC_R11_UNORM:
+		case Format::EAC_R11_SNORM:
+			return 8;
+		case Format::BC2_UNORM:
+		case Format::BC2_SRGB:
+		case Format::BC3_UNORM:
+		case Format::BC3_SRGB:
+		case Format::BC5_UNORM:
+		case Format::BC5_SNORM:
+		case Format::BC6H_UFLOAT:
+		case Format::BC6H_SFLOAT:
+		case Format::BC7_UNORM:
+		case Format::BC7_SRGB:
+		case Format::ASTC_4x4_UNORM:
+		case Format::ASTC_4x4_SRGB:
+		case Format::ASTC_5x5_UNORM:
+		case Format::ASTC_5x5_SRGB:
+		case Format::ASTC_6x6_UNORM:
+		case Format::ASTC_6x6_SRGB:
+		case Format::ASTC_8x8_UNORM:
+		case Format::ASTC_8x8_SRGB:
+		case Format::ASTC_10x10_UNORM:
+		case Format::ASTC_10x10_SRGB:
+		case Format::ASTC_12x12_UNORM:
+		case Format::ASTC_12x12_SRGB:
+		case Format::ETC2_R8G8B8A8_UNORM:
+		case Format::ETC2_R8G8B8A8_SRGB:
+		case Format::EAC_R11G11_UNORM:
+		case Format::EAC_R11G11_SNORM:
+			return 16;
 		default:
-			return 0; // Requires special handling for block compression
+			return getFormatRowPitch(format, 1);
 		}
 	}
+
+	uint32_t getFormatRowCount(Format format, uint32_t height) {
+		return (height + getFormatBlockHeight(format) - 1) / getFormatBlockHeight(format);
+	}
+
+	uint32_t getFormatCopyAlignment(Format format) {
+		// Vulkan wants buffer offsets that are a multiple of both the texel block size and 4
+		const uint32_t blockSize = getFormatBlockSize(format);
+		if (blockSize == 0) {
+			return 4;
+		}
+		return blockSize % 4 == 0 ? blockSize : (blockSize % 2 == 0 ? blockSize * 2 : blockSize * 4);
+	}
+
+	uint32_t getTextureFootprints(const TextureDescription& desc, std::vector<SubresourceFootprint>& footprints) {
+		const uint32_t alignment = getFormatCopyAlignment(desc.format);
+
+		footprints.clear();
+		footprints.reserve((size_t)desc.mipLevels * desc.arraySize);
+
+		uint32_t offset = 0;
+		for (uint32_t slice = 0; slice < desc.arraySize; ++slice) {
+			for (uint32_t mip = 0; mip < desc.mipLevels; ++mip) {
+				SubresourceFootprint footprint;
+				footprint.mipLevel = mip;
+				footprint.arraySlice = slice;
+				footprint.offset = (offset + alignment - 1) / alignment * alignment;
+				footprint.width = std::max(desc.width >> mip, 1u);
+				footprint.height = std::max(desc.height >> mip, 1u);
+				footprint.depth = std::max(desc.depth >> mip, 1u);
+				footprint.rowPitch = getFormatRowPitch(desc.format, footprint.width);
+				footprint.rowCount = getFormatRowCount(desc.format, footprint.height);
+				footprint.size = footprint.rowPitch * footprint.rowCount * footprint.depth;
+
+				offset = footprint.offset + footprint.size;
+				footprints.push_back(footprint);
+			}
+		}
+
+		return offset;
+	}
 }
\ No newline at end of file
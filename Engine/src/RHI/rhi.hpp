@@ -9,6 +9,7 @@
 #include "descriptor.hpp"
 #include "device.hpp"
 #include "heap.hpp"
+#include "query_heap.hpp"
 #include "fence.hpp"
 #include "pipeline.hpp"
 #include "shader.hpp"
@@ -47,4 +48,13 @@ namespace rhi {
 	uint32_t calcSubresource(const TextureDescription& desc, uint32_t mip, uint32_t slice);
 	void decomposeSubresource(const TextureDescription& desc, uint32_t subresource, uint32_t& mip, uint32_t& slice);
 	uint32_t getFormatRowPitch(Format format, uint32_t width);
+	// Texel block dimensions and size in bytes, 1x1 blocks for uncompressed formats
+	uint32_t getFormatBlockWidth(Format format);
+	uint32_t getFormatBlockHeight(Format format);
+	uint32_t getFormatBlockSize(Format format);
+	uint32_t getFormatRowCount(Format format, uint32_t height);
+	// Alignment of buffer offsets in buffer to image copies
+	uint32_t getFormatCopyAlignment(Format format);
+	// Lays out every subresource in subresource order, each offset aligned for buffer to image copies. Returns the total size
+	uint32_t getTextureFootprints(const TextureDescription& desc, std::vector<SubresourceFootprint>& footprints);
 }
\ No newline at end of file
@@ -8,6 +8,12 @@ namespace rhi {
 	public:
 		virtual ~ITexture() = default;
 		const TextureDescription& getDescription() const { return m_Description; };
+
+		// Sparse textures only, residency reflects the tile mappings submitted so far
+		virtual TextureTiling getTiling() const = 0;
+		virtual SubresourceTiling getSubresourceTiling(uint32_t subresource) const = 0;
+		virtual bool isTileResident(uint32_t subresource, uint32_t x, uint32_t y, uint32_t z) const = 0;
+		virtual uint32_t getResidentTileCount() const = 0;
 	protected:
 		TextureDescription m_Description{};
 	};
@@ -19,6 +19,7 @@ namespace rhi {
 	static const uint32_t SE_MAX_UBV_BINDINGS = 3; //push constants in slot 0
 	static const uint32_t SE_MAX_PUSH_CONSTANTS = 8;
 	static const uint32_t RHI_ALL_SUB_RESOURCE = 0xFFFFFFFF;
+	static const uint32_t SE_MAX_MEMORY_HEAPS = 16;
 
 	// Enums
 	enum class RenderBackend {
@@ -234,7 +235,8 @@ namespace rhi {
 		GpuOnly, // Device local only
 		CpuOnly, // Staging buffers
 		CpuToGpu, // Upload heap
-		GpuToCpu // Readback heap
+		GpuToCpu, // Readback heap
+		GpuUpload // Device local and persistently mapped, requires IDevice::isDirectUploadSupported
 	};
 
 	enum class TextureType {
@@ -360,6 +362,17 @@ namespace rhi {
 		PrimitiveType primitiveType = PrimitiveType::TriangleList;
 	};
 
+	struct MeshShadingPipelineDescription {
+		IShader* amplificationShader = nullptr;
+		IShader* meshShader = nullptr;
+		IShader* pixelShader = nullptr;
+		Rasterizer rasterizer;
+		DepthStencil depthStencil;
+		Blend blend[8];
+		Format renderTargetFormat[8] = { Format::Unknown };
+		Format depthStencilFormat = Format::Unknown;
+	};
+
 	struct ComputePipelineDescription {
 		IShader* computeShader = nullptr;
 	};
@@ -371,6 +384,7 @@ namespace rhi {
 		UniformBuffer = 1 << 2,
 		RawBuffer = 1 << 3,
 		ShaderStorageBuffer = 1 << 4,
+		Sparse = 1 << 5, // memory is bound per tile with ICommandList::updateTileMappings
 	};
 
 	inline BufferUsageFlags operator|(BufferUsageFlags a, BufferUsageFlags b) {
@@ -391,7 +405,8 @@ namespace rhi {
 		RenderTarget = 1 << 0,
 		DepthStencil = 1 << 1,
 		ShaderStorage = 1 << 2,
-		Shared = 1 << 3
+		Shared = 1 << 3,
+		Sparse = 1 << 4 // memory is bound per tile with ICommandList::updateTileMappings
 	};
 
 	inline TextureUsageFlags operator|(TextureUsageFlags a, TextureUsageFlags b) {
@@ -428,6 +443,7 @@ namespace rhi {
 		AccelerationStructureRead = 1 << 16,
 		AccelerationStructureStorage = 1 << 17,
 		Discard = 1 << 18, // Aliasing barrier
+		HostRead = 1 << 19, // CPU reads after the GPU work completed
 
 		// Composite flags
 		MaskShaderVS = VertexShaderRead | VertexShaderStorage,
@@ -565,6 +581,18 @@ namespace rhi {
 		float maxLod = FLT_MAX;
 	};
 
+	inline bool operator==(const SamplerDescription& lhs, const SamplerDescription& rhs)
+	{
+		return lhs.filterMode == rhs.filterMode &&
+			lhs.addressU == rhs.addressU &&
+			lhs.addressV == rhs.addressV &&
+			lhs.addressW == rhs.addressW &&
+			lhs.mipLodBias == rhs.mipLodBias &&
+			lhs.maxAnisotropy == rhs.maxAnisotropy &&
+			lhs.minLod == rhs.minLod &&
+			lhs.maxLod == rhs.maxLod;
+	}
+
 	struct BufferDescription {
 		uint64_t size = 0;
 		uint32_t stride = 0;
@@ -589,6 +617,25 @@ namespace rhi {
 		}
 	};
 
+	struct BufferCopyRegion {
+		uint32_t srcOffset = 0;
+		uint32_t dstOffset = 0;
+		uint32_t size = 0;
+	};
+
+	// Placement of one subresource in a linear upload buffer, rows of texel blocks are tightly packed
+	struct SubresourceFootprint {
+		uint32_t mipLevel = 0;
+		uint32_t arraySlice = 0;
+		uint32_t offset = 0;
+		uint32_t width = 1;
+		uint32_t height = 1;
+		uint32_t depth = 1;
+		uint32_t rowPitch = 0;
+		uint32_t rowCount = 0;
+		uint32_t size = 0;
+	};
+
 	struct TextureDescription {
 		uint32_t width = 1;
 		uint32_t height = 1;
@@ -652,10 +699,39 @@ namespace rhi {
 	//	return !(lhs == rhs);
 	//}
 
+	// Resources are grouped into memory pools by usage so similar lifetimes share memory blocks
+	enum class MemoryPoolType {
+		RenderTarget,     // GPU only textures written by the GPU
+		StaticGeometry,   // GPU only buffers
+		StreamingTexture, // GPU only sampled textures
+		Upload,           // CPU only staging buffers
+		Count
+	};
+
+	inline const char* getMemoryPoolName(MemoryPoolType pool)
+	{
+		switch (pool)
+		{
+		case MemoryPoolType::RenderTarget: return "Render targets";
+		case MemoryPoolType::StaticGeometry: return "Static geometry";
+		case MemoryPoolType::StreamingTexture: return "Streaming textures";
+		case MemoryPoolType::Upload: return "Upload";
+		default: return "Unknown";
+		}
+	}
+
 	struct DeviceDescription {
 		void* windowHandle = nullptr;
 		bool enableValidation = true;
+		bool enableSubmissionThread = false; // queue submits and presents run on a dedicated thread
 		RenderBackend backend = RenderBackend::Vulkan;
+		// Size of the memory blocks of each pool, 0 disables the pool
+		uint64_t memoryPoolBlockSize[(uint32_t)MemoryPoolType::Count] = {
+			128ull * 1024 * 1024,
+			64ull * 1024 * 1024,
+			256ull * 1024 * 1024,
+			128ull * 1024 * 1024,
+		};
 	};
 	struct ShaderDescription
 	{
@@ -679,6 +755,236 @@ namespace rhi {
 		MemoryType memoryType = MemoryType::GpuOnly;
 	};
 
+	// A range sub-allocated from an IHeap, resources are placed in it through heap/heapOffset
+	struct HeapAllocation
+	{
+		uint32_t offset = 0;
+		uint32_t size = 0;
+		uint64_t handle = 0;
+
+		bool isValid() const { return handle != 0; }
+	};
+
+	struct MemoryRequirements
+	{
+		uint32_t size = 0;
+		uint32_t alignment = 1;
+	};
+
+	enum class TileMappingType {
+		Map,
+		Unmap
+	};
+
+	// Tile memory comes from an IHeap, heapOffset is counted in tiles.
+	// Standard mips are mapped by a box of tiles, the packed mip tail of a slice and buffers by a linear range of
+	// tileCount tiles starting at x.
+	struct TileMapping
+	{
+		TileMappingType type = TileMappingType::Map;
+		uint32_t subresource = 0;
+		uint32_t x = 0;
+		uint32_t y = 0;
+		uint32_t z = 0;
+		uint32_t width = 1;
+		uint32_t height = 1;
+		uint32_t depth = 1;
+		uint32_t tileCount = 1;
+		uint32_t heapOffset = 0;
+	};
+
+	struct TextureTiling
+	{
+		uint32_t tileSize = 0; // bytes
+		uint32_t tileWidth = 0; // texels
+		uint32_t tileHeight = 0;
+		uint32_t tileDepth = 0;
+		uint32_t tileCount = 0; // including the packed mip tails
+		uint32_t standardMipCount = 0; // mips from here on are packed into the mip tail
+		uint32_t packedMipTileCount = 0; // per mip tail
+	};
+
+	struct SubresourceTiling
+	{
+		uint32_t widthInTiles = 0;
+		uint32_t heightInTiles = 0;
+		uint32_t depthInTiles = 0;
+		uint32_t startTileIndex = 0;
+	};
+
+	enum class QueryType {
+		Timestamp,
+		PipelineStatistics,
+		Occlusion,
+	};
+
+	struct QueryHeapDescription
+	{
+		QueryType type = QueryType::Timestamp;
+		uint32_t queryCount = 1;
+	};
+
+	// Result of a QueryType::PipelineStatistics query, in VkQueryPipelineStatisticFlagBits order.
+	// Task and mesh invocations stay zero on devices without mesh shader queries
+	struct PipelineStatistics
+	{
+		uint64_t inputAssemblyVertices = 0;
+		uint64_t inputAssemblyPrimitives = 0;
+		uint64_t vertexShaderInvocations = 0;
+		uint64_t clippingInvocations = 0;
+		uint64_t clippingPrimitives = 0;
+		uint64_t pixelShaderInvocations = 0;
+		uint64_t computeShaderInvocations = 0;
+		uint64_t taskShaderInvocations = 0;
+		uint64_t meshShaderInvocations = 0;
+	};
+
+	enum class MemoryCategory {
+		Texture,
+		Buffer,
+		StagingBuffer,
+		RenderGraphHeap,
+		Descriptor,
+		ConstantBuffer,
+		Count
+	};
+
+	inline const char* getMemoryCategoryName(MemoryCategory category)
+	{
+		switch (category)
+		{
+		case MemoryCategory::Texture: return "Textures";
+		case MemoryCategory::Buffer: return "Buffers";
+		case MemoryCategory::StagingBuffer: return "Staging";
+		case MemoryCategory::RenderGraphHeap: return "Render graph heaps";
+		case MemoryCategory::Descriptor: return "Descriptors";
+		case MemoryCategory::ConstantBuffer: return "Constant buffers";
+		default: return "Unknown";
+		}
+	}
+
+	struct MemoryCategoryStats
+	{
+		uint64_t allocatedBytes = 0;
+		uint64_t peakBytes = 0;
+		uint32_t allocationCount = 0;
+	};
+
+	// One entry per VkMemoryHeap/DXGI segment, usage covers every allocation of the process
+	struct MemoryHeapStats
+	{
+		uint64_t sizeBytes = 0;
+		uint64_t usageBytes = 0;
+		uint64_t budgetBytes = 0;
+		uint64_t peakUsageBytes = 0;
+		bool deviceLocal = false;
+	};
+
+	struct MemoryPoolStats
+	{
+		uint32_t allocationCount = 0;
+		uint32_t blockCount = 0;
+		uint64_t allocatedBytes = 0;
+		uint64_t blockBytes = 0;
+		float fragmentation = 0.0f; // 1 - largest free range / total free bytes
+	};
+
+	struct MemoryStats
+	{
+		MemoryCategoryStats categories[(uint32_t)MemoryCategory::Count];
+		MemoryPoolStats pools[(uint32_t)MemoryPoolType::Count];
+		MemoryHeapStats heaps[SE_MAX_MEMORY_HEAPS];
+		uint32_t heapCount = 0;
+	};
+
+	// Per-draw constants and their descriptors, the ring is shared by the frames in flight and
+	// overflow blocks are chained while it is full
+	struct ConstantBufferStats
+	{
+		uint32_t ringSize = 0;
+		uint32_t ringUsedSize = 0;
+		uint32_t ringHighWater = 0;
+		uint32_t frameSize = 0; // allocated by the last frame
+		uint32_t frameHighWater = 0;
+		uint32_t overflowBlockCount = 0;
+		uint64_t overflowBlockSize = 0;
+	};
+
+	// Identical samplers and views share one descriptor, requests that found a live one count as hits
+	struct DescriptorCacheStats
+	{
+		uint64_t samplerRequests = 0;
+		uint64_t samplerHits = 0;
+		uint32_t liveSamplers = 0;
+		uint64_t viewRequests = 0;
+		uint64_t viewHits = 0;
+		uint32_t liveViews = 0;
+	};
+
+	// GPU timestamp ticks and CPU time sampled at the same moment.
+	// cpuTimeNs is on the std::chrono::steady_clock timeline.
+	struct CalibratedTimestamp
+	{
+		uint64_t gpuTimestamp = 0;
+		uint64_t cpuTimeNs = 0;
+		uint64_t maxDeviationNs = 0;
+	};
+
+	// Indirect argument layouts, match VkDrawIndirectCommand/VkDrawIndexedIndirectCommand/VkDispatchIndirectCommand
+	struct DrawCommand
+	{
+		uint32_t vertexCount = 0;
+		uint32_t instanceCount = 0;
+		uint32_t firstVertex = 0;
+		uint32_t firstInstance = 0;
+	};
+
+	struct DrawIndexedCommand
+	{
+		uint32_t indexCount = 0;
+		uint32_t instanceCount = 0;
+		uint32_t firstIndex = 0;
+		int32_t vertexOffset = 0;
+		uint32_t firstInstance = 0;
+	};
+
+	struct DispatchCommand
+	{
+		uint32_t groupCountX = 0;
+		uint32_t groupCountY = 0;
+		uint32_t groupCountZ = 0;
+	};
+
+	struct QueueSubmissionStats
+	{
+		uint32_t submitRequests = 0; // ICommandList::submit calls
+		uint32_t queueSubmits = 0;   // actual queue submissions issued to the driver
+		uint32_t commandBuffers = 0;
+		float submitTimeMs = 0.0f;   // time spent in queue submit calls
+		float presentTimeMs = 0.0f;  // time spent in present calls
+	};
+
+	struct CommandListStats
+	{
+		uint32_t pipelineBinds = 0;
+		uint32_t filteredPipelineBinds = 0;
+		uint32_t dynamicStateSets = 0;
+		uint32_t filteredDynamicStateSets = 0;
+		uint32_t constantUploads = 0;
+		uint32_t filteredConstantUploads = 0;
+
+		CommandListStats& operator+=(const CommandListStats& other)
+		{
+			pipelineBinds += other.pipelineBinds;
+			filteredPipelineBinds += other.filteredPipelineBinds;
+			dynamicStateSets += other.dynamicStateSets;
+			filteredDynamicStateSets += other.filteredDynamicStateSets;
+			constantUploads += other.constantUploads;
+			filteredConstantUploads += other.filteredConstantUploads;
+			return *this;
+		}
+	};
+
 	template<typename Enum>
 	inline bool anySet(Enum flags, Enum mask) {
 		using underlying = typename std::underlying_type<Enum>::type;
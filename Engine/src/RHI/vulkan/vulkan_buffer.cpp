@@ -1,6 +1,7 @@
 #pragma once
 #include "vulkan_buffer.hpp"
 #include "vulkan_device.hpp"
+#include <algorithm>
 
 namespace rhi::vulkan {
 	VulkanBuffer::VulkanBuffer(VulkanDevice* device, const BufferDescription& desc, const std::string& name)
@@ -13,55 +14,80 @@ namespace rhi::vulkan {
 	VulkanBuffer::~VulkanBuffer()
 	{
 		unmap();
+		if (m_Allocation) {
+			// The allocation outlives the buffer in the deletion queue, defragmentation must not find it
+			vmaSetAllocationUserData(((VulkanDevice*)m_Device)->getVmaAllocator(), m_Allocation, nullptr);
+		}
+		((VulkanDevice*)m_Device)->untrackAllocation(getMemoryCategory(), m_Allocation);
 		((VulkanDevice*)m_Device)->enqueueDeletion(m_Buffer);
 		((VulkanDevice*)m_Device)->enqueueDeletion(m_Allocation);
 	}
 
 	bool VulkanBuffer::create() {
-		VkBufferCreateInfo bufferInfo = {};
-		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-		bufferInfo.size = m_Description.size;
-		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-		bufferInfo.usage =
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
-			VK_BUFFER_USAGE_TRANSFER_DST_BIT |
-			VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
-			VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
-
-		if (anySet(m_Description.usage, BufferUsageFlags::UniformBuffer))
-		{
-			bufferInfo.usage |= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-		}
+		VkBufferCreateInfo bufferInfo = toBufferCreateInfo(m_Description);
+		VmaAllocator allocator = ((VulkanDevice*)m_Device)->getVmaAllocator();
 
-		if (anySet(m_Description.usage, BufferUsageFlags::StructuredBuffer | BufferUsageFlags::RawBuffer))
+		if (anySet(m_Description.usage, BufferUsageFlags::Sparse))
 		{
-			bufferInfo.usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+			SE_ASSERT(m_Device->isSparseResourceSupported(), "Sparse resources are not supported by the device");
+			SE_ASSERT(!m_Description.heap && !m_Description.mapped && m_Description.memoryType == MemoryType::GpuOnly);
+
+			VkDevice device = ((VulkanDevice*)m_Device)->getDevice();
+			VK_CHECK_RETURN(vkCreateBuffer(device, &bufferInfo, nullptr, &m_Buffer), false, "Sparse buffer creation failed! {}", m_DebugName);
+
+			VkMemoryRequirements requirements;
+			vkGetBufferMemoryRequirements(device, m_Buffer, &requirements);
+			m_TileSize = (uint32_t)requirements.alignment;
+			m_SparseSize = requirements.size;
+			m_SparseMemoryTypeBits = requirements.memoryTypeBits;
+			m_TileResidency.assign((size_t)((m_SparseSize + m_TileSize - 1) / m_TileSize), 0);
+			return true;
 		}
 
-		if (anySet(m_Description.usage, BufferUsageFlags::FormattedBuffer))
+		if (m_Description.heap)
 		{
-			if (anySet(m_Description.usage, BufferUsageFlags::ShaderStorageBuffer))
-			{
-				bufferInfo.usage |= VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT;
-			}
-			else
-			{
-				bufferInfo.usage |= VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT;
-			}
+			SE_ASSERT(!m_Description.mapped, "Placed buffers can not be persistently mapped");
+			SE_ASSERT(m_Description.heapOffset + m_Description.size <= m_Description.heap->getDescription().size);
+
+			VmaAllocation heapAllocation = (VmaAllocation)m_Description.heap->getHandle();
+			VK_CHECK_RETURN(vmaCreateAliasingBuffer2(allocator, heapAllocation, m_Description.heapOffset, &bufferInfo, &m_Buffer), false, "Placed buffer creation failed! {}", m_DebugName);
+			return true;
 		}
 
 		VmaAllocationCreateInfo allocInfo = {};
 		allocInfo.usage = translateMemoryTypeToVMA(m_Description.memoryType);
+		allocInfo.pool = ((VulkanDevice*)m_Device)->getMemoryPool(m_Description);
+		allocInfo.pUserData = this;
+
+		if (m_Description.memoryType == MemoryType::GpuUpload) {
+			SE_ASSERT(m_Device->isDirectUploadSupported(), "GpuUpload memory is not supported by the device");
+			allocInfo.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+			m_Description.mapped = true;
+		}
 
 		if (m_Description.mapped) {
 			allocInfo.flags |= VMA_ALLOCATION_CREATE_MAPPED_BIT;
 		}
 
-		if (vmaCreateBuffer(((VulkanDevice*)m_Device)->getVmaAllocator(), &bufferInfo, &allocInfo,
-			&m_Buffer, &m_Allocation, nullptr) != VK_SUCCESS) {
+		VmaAllocationInfo allocationInfo = {};
+		VkResult result = vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &m_Buffer, &m_Allocation, &allocationInfo);
+		if (result != VK_SUCCESS && allocInfo.pool) {
+			// Too large for a pool block, fall back to the default pools
+			allocInfo.pool = VK_NULL_HANDLE;
+			result = vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &m_Buffer, &m_Allocation, &allocationInfo);
+		}
+
+		if (result != VK_SUCCESS) {
 			return false;
 		}
 
+		if (m_Description.mapped) {
+			m_MappedData = allocationInfo.pMappedData;
+			m_Mapped = true;
+		}
+
+		((VulkanDevice*)m_Device)->trackAllocation(getMemoryCategory(), m_Allocation);
+
 		return true;
 	}
 
@@ -88,6 +114,60 @@ namespace rhi::vulkan {
 		m_Mapped = false;
 	}
 
+	void VulkanBuffer::invalidate(uint64_t offset, uint64_t size) {
+		vmaInvalidateAllocation(((VulkanDevice*)m_Device)->getVmaAllocator(), m_Allocation, offset, size);
+	}
+
+	void VulkanBuffer::flush(uint64_t offset, uint64_t size) {
+		vmaFlushAllocation(((VulkanDevice*)m_Device)->getVmaAllocator(), m_Allocation, offset, size);
+	}
+
+	bool VulkanBuffer::beginRelocation(VmaAllocation destination) {
+		// GPU buffers are referenced by device address and descriptors, only persistently mapped staging memory is moved
+		if (m_Description.memoryType != MemoryType::CpuOnly || !m_Description.mapped) {
+			return false;
+		}
+
+		VulkanDevice* pDevice = (VulkanDevice*)m_Device;
+		VmaAllocator allocator = pDevice->getVmaAllocator();
+
+		// VMA maps the destination of a persistently mapped allocation, the pointer stays valid after the pass ends
+		VmaAllocationInfo destinationInfo;
+		vmaGetAllocationInfo(allocator, destination, &destinationInfo);
+		if (!destinationInfo.pMappedData) {
+			return false;
+		}
+
+		VkBufferCreateInfo bufferInfo = toBufferCreateInfo(m_Description);
+		VkBuffer buffer = VK_NULL_HANDLE;
+		if (vkCreateBuffer(pDevice->getDevice(), &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+			return false;
+		}
+
+		if (vmaBindBufferMemory(allocator, destination, buffer) != VK_SUCCESS) {
+			vkDestroyBuffer(pDevice->getDevice(), buffer, nullptr);
+			return false;
+		}
+
+		// Work already submitted keeps reading the old buffer and memory until the pass retires
+		memcpy(destinationInfo.pMappedData, m_MappedData, m_Description.size);
+		pDevice->enqueueDeletion(m_Buffer);
+		m_Buffer = buffer;
+		m_MappedData = destinationInfo.pMappedData;
+		return true;
+	}
+
+	void VulkanBuffer::updateTileResidency(const TileMapping& mapping) {
+		uint8_t resident = mapping.type == TileMappingType::Map ? 1 : 0;
+		uint32_t end = std::min(mapping.x + mapping.tileCount, (uint32_t)m_TileResidency.size());
+		for (uint32_t tile = mapping.x; tile < end; ++tile) {
+			if (m_TileResidency[tile] != resident) {
+				m_TileResidency[tile] = resident;
+				m_ResidentTileCount += resident ? 1 : -1;
+			}
+		}
+	}
+
 	uint64_t VulkanBuffer::getGpuAddress() const {
 		VkBufferDeviceAddressInfo addressInfo = {};
 		addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
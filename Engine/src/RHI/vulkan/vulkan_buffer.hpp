@@ -1,6 +1,7 @@
 #pragma once
 #include "../buffer.hpp"
 #include"vulkan_core.hpp"
+#include <vector>
 namespace rhi::vulkan {
 	class VulkanDevice;
 
@@ -16,6 +17,11 @@ namespace rhi::vulkan {
 		uint64_t getGpuAddress() const override;
 		void* getCpuAddress() override;
 		bool isMapped() const override { return m_Mapped; }
+		void invalidate(uint64_t offset, uint64_t size) override;
+		void flush(uint64_t offset, uint64_t size) override;
+		uint32_t getTileSize() const override { return m_TileSize; }
+		bool isTileResident(uint32_t tile) const override { return m_TileResidency.empty() || m_TileResidency[tile] != 0; }
+		uint32_t getResidentTileCount() const override { return m_ResidentTileCount; }
 
 		// Resource interface
 		void* getHandle() const override { return m_Buffer; }
@@ -24,11 +30,24 @@ namespace rhi::vulkan {
 		// Vulkan specific
 		VkBuffer getVkBuffer() const { return m_Buffer; }
 		VmaAllocation getAllocation() const { return m_Allocation; }
+		// Defragmentation, binds a new buffer to the destination of a VMA move and copies the contents
+		bool beginRelocation(VmaAllocation destination);
+		uint64_t getSparseSize() const { return m_SparseSize; }
+		uint32_t getSparseMemoryTypeBits() const { return m_SparseMemoryTypeBits; }
+		void updateTileResidency(const TileMapping& mapping);
+		MemoryCategory getMemoryCategory() const { return m_Description.memoryType == MemoryType::CpuOnly ? MemoryCategory::StagingBuffer : MemoryCategory::Buffer; }
 
 	private:
 		VkBuffer m_Buffer = VK_NULL_HANDLE;
 		VmaAllocation m_Allocation = VK_NULL_HANDLE;
 		void* m_MappedData = nullptr;
 		bool m_Mapped = false;
+
+		// Sparse residency
+		uint32_t m_TileSize = 0;
+		uint64_t m_SparseSize = 0;
+		uint32_t m_SparseMemoryTypeBits = 0;
+		std::vector<uint8_t> m_TileResidency;
+		uint32_t m_ResidentTileCount = 0;
 	};
 }
\ No newline at end of file
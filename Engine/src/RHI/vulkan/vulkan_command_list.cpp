@@ -6,8 +6,12 @@
 #include "vulkan_texture.hpp"
 #include "vulkan_descriptor.hpp"
 #include "vulkan_pipeline.hpp"
+#include "vulkan_query_heap.hpp"
+#include "vulkan_heap.hpp"
+#include "vulkan_buffer.hpp"
 #include "../types.hpp"
 #include <RHI\rhi.hpp>
+#include <algorithm>
 
 namespace rhi::vulkan {
 	VulkanCommandList::VulkanCommandList(VulkanDevice* device, CommandType type, const std::string& name)
@@ -30,17 +34,15 @@ namespace rhi::vulkan {
 		switch (m_CommandType) {
 		case CommandType::Graphics:
 			createInfo.queueFamilyIndex = device->getGraphicsQueueIndex();
-			m_Queue = device->getGraphicsQueue();
 			break;
 		case CommandType::Compute:
 			createInfo.queueFamilyIndex = device->getComputeQueueIndex();
-			m_Queue = device->getComputeQueue();
 			break;
 		case CommandType::Copy:
 			createInfo.queueFamilyIndex = device->getCopyQueueIndex();
-			m_Queue = device->getCopyQueue();
 			break;
 		}
+		m_Queue = device->getQueue(m_CommandType);
 
 		VK_CHECK_RETURN(vkCreateCommandPool(device->getDevice(), &createInfo, nullptr, &m_CommandPool), false, "Command pool creation failed!");
 
@@ -75,6 +77,9 @@ namespace rhi::vulkan {
 		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
 		vkBeginCommandBuffer(m_CommandBuffer, &beginInfo);
+
+		m_GraphicsConstants = {};
+		m_ComputeConstants = {};
 		resetState();
 	}
 
@@ -100,88 +105,91 @@ namespace rhi::vulkan {
 
 	void VulkanCommandList::submit()
 	{
-		((VulkanDevice*)m_Device)->flushLayoutTransition(m_CommandType);
-		std::vector<VkSemaphore> waitSemaphores;
-		std::vector<VkSemaphore> signalSemaphores;
-		std::vector<uint64_t> waitValues;
-		std::vector<uint64_t> signalValues;
-		std::vector<VkPipelineStageFlags> waitStages;
+		VulkanDevice* device = (VulkanDevice*)m_Device;
+		std::lock_guard<std::mutex> lock(device->getSubmitMutex());
 
-		for (const auto& wait : m_PendingWaits) {
-			waitSemaphores.push_back(static_cast<VkSemaphore>(wait.first->getHandle()));
-			waitStages.push_back(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
-			waitValues.push_back(wait.second);
+		// Copies never read descriptors, and copy lists may be submitted from upload threads while descriptors are written
+		if (m_CommandType != CommandType::Copy) {
+			device->flushDescriptorWrites();
 		}
-		m_PendingWaits.clear();
+		VkCommandBuffer transitionCommandBuffer = device->flushLayoutTransition(m_CommandType);
 
-		for (const auto& signal : m_PendingSignals) {
-			signalSemaphores.push_back(static_cast<VkSemaphore>(signal.first->getHandle()));
-			signalValues.push_back(signal.second);
+		if (!m_PendingTileMappings.empty()) {
+			device->updateTileMappings(m_Queue, m_PendingTileMappings);
+			m_PendingTileMappings.clear();
 		}
-		m_PendingSignals.clear();
 
-		for (ISwapchain* swapchain : m_PendingSwapchains) {
-			VulkanSwapchain* vulkanSwapchain = static_cast<VulkanSwapchain*>(swapchain);
-
-			waitSemaphores.push_back(vulkanSwapchain->getAcquireSemaphore());
-			waitStages.push_back(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
-			signalSemaphores.push_back(vulkanSwapchain->getPresentSemaphore());
-
-			waitValues.push_back(0);
-			signalValues.push_back(0);
+		for (const auto& wait : m_PendingWaits) {
+			m_Queue->wait(static_cast<VkSemaphore>(wait.first->getHandle()), wait.second);
 		}
+		m_PendingWaits.clear();
 
-		VkTimelineSemaphoreSubmitInfo timelineInfo = { VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
-		timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
-		timelineInfo.pWaitSemaphoreValues = waitValues.data();
-		timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(signalValues.size());
-		timelineInfo.pSignalSemaphoreValues = signalValues.data();
+		for (ISwapchain* swapchain : m_PendingSwapchains) {
+			m_Queue->wait(static_cast<VulkanSwapchain*>(swapchain)->getAcquireSemaphore(), 0);
+		}
 
-		VkSubmitInfo submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO };
-		submitInfo.pNext = &timelineInfo;
-		submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
-		submitInfo.pWaitSemaphores = waitSemaphores.data();
-		submitInfo.pWaitDstStageMask = waitStages.data();
-		submitInfo.signalSemaphoreCount = static_cast<uint32_t>(signalSemaphores.size());
-		submitInfo.pSignalSemaphores = signalSemaphores.data();
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &m_CommandBuffer;
+		// Shares the VkSubmitInfo2 of this command list instead of a submission of its own
+		if (transitionCommandBuffer != VK_NULL_HANDLE) {
+			m_Queue->addCommandBuffer(transitionCommandBuffer);
+		}
+		m_Queue->addCommandBuffer(m_CommandBuffer);
 
-		vkQueueSubmit(m_Queue, 1, &submitInfo, VK_NULL_HANDLE);
+		for (const auto& signal : m_PendingSignals) {
+			m_Queue->signal(static_cast<VkSemaphore>(signal.first->getHandle()), signal.second);
+		}
+		m_PendingSignals.clear();
 
 		for (ISwapchain* swapchain : m_PendingSwapchains) {
-			static_cast<VulkanSwapchain*>(swapchain)->present(m_Queue);
+			VulkanSwapchain* vulkanSwapchain = static_cast<VulkanSwapchain*>(swapchain);
+			m_Queue->signal(vulkanSwapchain->getPresentSemaphore(), 0);
+			m_Queue->present(vulkanSwapchain, vulkanSwapchain->getCurrentImageIndex(), vulkanSwapchain->getPresentSemaphore());
 		}
 		m_PendingSwapchains.clear();
+
+		m_Queue->submit();
 	}
 	void VulkanCommandList::resetState() {
+		// Anything may have been recorded behind our back (e.g. ImGui), so forget the shadow state
+		m_ShadowState = {};
+		m_GraphicsConstants.needsUpdate = true;
+		m_ComputeConstants.needsUpdate = true;
+
 		if (m_CommandType == CommandType::Graphics || m_CommandType == CommandType::Compute) {
-			auto device = (VulkanDevice*)m_Device;
-			VkDescriptorBufferBindingInfoEXT descriptorBuffer[3] = {};
-			descriptorBuffer[0].sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT;
-			descriptorBuffer[0].address = device->getConstantBufferAllocator()->getGpuAddress();
-			descriptorBuffer[0].usage = VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT;
+			bindDescriptorBuffers(((VulkanDevice*)m_Device)->getConstantBufferAllocator()->getGpuAddress());
+		}
+	}
 
-			descriptorBuffer[1].sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT;
-			descriptorBuffer[1].address = device->getResourceDescriptorAllocator()->getGpuAddress();
-			descriptorBuffer[1].usage = VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT;
+	void VulkanCommandList::bindDescriptorBuffers(VkDeviceAddress constantBufferAddress) {
+		auto device = (VulkanDevice*)m_Device;
+		VkDescriptorBufferBindingInfoEXT descriptorBuffer[3] = {};
+		descriptorBuffer[0].sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT;
+		descriptorBuffer[0].address = constantBufferAddress;
+		descriptorBuffer[0].usage = VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT;
 
-			descriptorBuffer[2].sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT;
-			descriptorBuffer[2].address = device->getSamplerDescriptorAllocator()->getGpuAddress();
-			descriptorBuffer[2].usage = VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT;
+		descriptorBuffer[1].sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT;
+		descriptorBuffer[1].address = device->getResourceDescriptorAllocator()->getGpuAddress();
+		descriptorBuffer[1].usage = VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT;
 
-			vkCmdBindDescriptorBuffersEXT(m_CommandBuffer, 3, descriptorBuffer);
+		descriptorBuffer[2].sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT;
+		descriptorBuffer[2].address = device->getSamplerDescriptorAllocator()->getGpuAddress();
+		descriptorBuffer[2].usage = VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT;
 
-			uint32_t bufferIndices[] = { 1, 2 };
-			VkDeviceSize offsets[] = { 0, 0 };
+		vkCmdBindDescriptorBuffersEXT(m_CommandBuffer, 3, descriptorBuffer);
 
-			//vkCmdSetDescriptorBufferOffsetsEXT(m_CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, device->getPipelineLayout(), 1, 2, bufferIndices, offsets);
+		uint32_t bufferIndices[] = { 1, 2 };
+		VkDeviceSize offsets[] = { 0, 0 };
 
-			if (m_CommandType == CommandType::Graphics)
-			{
-				vkCmdSetDescriptorBufferOffsetsEXT(m_CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, device->getPipelineLayout(), 1, 2, bufferIndices, offsets);
-			}
+		//vkCmdSetDescriptorBufferOffsetsEXT(m_CommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, device->getPipelineLayout(), 1, 2, bufferIndices, offsets);
+
+		if (m_CommandType == CommandType::Graphics)
+		{
+			vkCmdSetDescriptorBufferOffsetsEXT(m_CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, device->getPipelineLayout(), 1, 2, bufferIndices, offsets);
 		}
+
+		// Set 0 of both bind points pointed into the previous constant buffer block
+		m_ConstantBufferAddress = constantBufferAddress;
+		m_GraphicsConstants.needsUpdate = true;
+		m_ComputeConstants.needsUpdate = true;
 	}
 
 	void VulkanCommandList::copyBufferToTexture(ITexture* dstTexture, uint32_t mipLevel, uint32_t arraySlice, IBuffer* srcBuffer, uint32_t offset) {
@@ -209,6 +217,38 @@ namespace rhi::vulkan {
 		vkCmdCopyBufferToImage2(m_CommandBuffer, &info);
 	}
 
+	void VulkanCommandList::copyBufferToTexture(ITexture* dstTexture, IBuffer* srcBuffer, uint32_t offset, uint32_t footprintCount, const SubresourceFootprint* footprints) {
+		flushBarriers();
+
+		const TextureDescription& desc = dstTexture->getDescription();
+
+		m_CopyRegions.resize(footprintCount);
+		for (uint32_t i = 0; i < footprintCount; ++i) {
+			const SubresourceFootprint& footprint = footprints[i];
+
+			// Rows are tightly packed, so buffer row length and image height stay 0
+			VkBufferImageCopy2& copy = m_CopyRegions[i];
+			copy = { VK_STRUCTURE_TYPE_BUFFER_IMAGE_COPY_2 };
+			copy.bufferOffset = (VkDeviceSize)offset + footprint.offset;
+			copy.imageSubresource.aspectMask = getVkAspectMask(desc.format);
+			copy.imageSubresource.mipLevel = footprint.mipLevel;
+			copy.imageSubresource.baseArrayLayer = footprint.arraySlice;
+			copy.imageSubresource.layerCount = 1;
+			copy.imageExtent.width = footprint.width;
+			copy.imageExtent.height = footprint.height;
+			copy.imageExtent.depth = footprint.depth;
+		}
+
+		VkCopyBufferToImageInfo2 info = { VK_STRUCTURE_TYPE_COPY_BUFFER_TO_IMAGE_INFO_2 };
+		info.srcBuffer = static_cast<VkBuffer>(srcBuffer->getHandle());
+		info.dstImage = static_cast<VkImage>(dstTexture->getHandle());
+		info.dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		info.regionCount = footprintCount;
+		info.pRegions = m_CopyRegions.data();
+
+		vkCmdCopyBufferToImage2(m_CommandBuffer, &info);
+	}
+
 	void VulkanCommandList::copyTextureToBuffer(IBuffer* dstBuffer, uint32_t offset, ITexture* srcTexture, uint32_t mipLevel, uint32_t arraySlice) {
 		flushBarriers();
 
@@ -251,6 +291,27 @@ namespace rhi::vulkan {
 		vkCmdCopyBuffer2(m_CommandBuffer, &info);
 	}
 
+	void VulkanCommandList::copyBuffer(IBuffer* dstBuffer, IBuffer* srcBuffer, uint32_t regionCount, const BufferCopyRegion* regions) {
+		flushBarriers();
+
+		m_BufferCopyRegions.resize(regionCount);
+		for (uint32_t i = 0; i < regionCount; ++i) {
+			VkBufferCopy2& copy = m_BufferCopyRegions[i];
+			copy = { VK_STRUCTURE_TYPE_BUFFER_COPY_2 };
+			copy.srcOffset = regions[i].srcOffset;
+			copy.dstOffset = regions[i].dstOffset;
+			copy.size = regions[i].size;
+		}
+
+		VkCopyBufferInfo2 info = { VK_STRUCTURE_TYPE_COPY_BUFFER_INFO_2 };
+		info.srcBuffer = static_cast<VkBuffer>(srcBuffer->getHandle());
+		info.dstBuffer = static_cast<VkBuffer>(dstBuffer->getHandle());
+		info.regionCount = regionCount;
+		info.pRegions = m_BufferCopyRegions.data();
+
+		vkCmdCopyBuffer2(m_CommandBuffer, &info);
+	}
+
 	void VulkanCommandList::copyTexture(ITexture* dstTexture, uint32_t dstMip, uint32_t dstArray, ITexture* srcTexture, uint32_t srcMip, uint32_t srcArray)
 	{
 		flushBarriers();
@@ -374,6 +435,54 @@ namespace rhi::vulkan {
 		}
 	}
 
+	void VulkanCommandList::beginQuery(IQueryHeap* heap, uint32_t index) {
+		QueryType type = heap->getDescription().type;
+		SE_ASSERT(type != QueryType::Timestamp, "Timestamps are written with writeTimestamp");
+		SE_ASSERT(type != QueryType::PipelineStatistics || m_CommandType == CommandType::Graphics, "Pipeline statistics need a graphics queue");
+
+		VkQueryControlFlags flags = type == QueryType::Occlusion ? VK_QUERY_CONTROL_PRECISE_BIT : 0;
+		vkCmdBeginQuery(m_CommandBuffer, static_cast<VkQueryPool>(heap->getHandle()), index, flags);
+	}
+
+	void VulkanCommandList::endQuery(IQueryHeap* heap, uint32_t index) {
+		vkCmdEndQuery(m_CommandBuffer, static_cast<VkQueryPool>(heap->getHandle()), index);
+	}
+
+	void VulkanCommandList::writeTimestamp(IQueryHeap* heap, uint32_t index) {
+		SE_ASSERT(heap->getDescription().type == QueryType::Timestamp, "Query heap is not a timestamp heap");
+		vkCmdWriteTimestamp2(m_CommandBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, static_cast<VkQueryPool>(heap->getHandle()), index);
+	}
+
+	void VulkanCommandList::resolveQueries(IQueryHeap* heap, uint32_t startIndex, uint32_t count) {
+		VulkanQueryHeap* queryHeap = (VulkanQueryHeap*)heap;
+		VkQueryPool queryPool = static_cast<VkQueryPool>(heap->getHandle());
+		uint32_t resultSize = getQueryResultSize(heap->getDescription().type);
+
+		flushBarriers();
+		vkCmdCopyQueryPoolResults(m_CommandBuffer, queryPool, startIndex, count,
+			static_cast<VkBuffer>(queryHeap->getReadbackBuffer()->getHandle()), (VkDeviceSize)startIndex * resultSize, resultSize,
+			VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+		// The copy has to read the queries before the reset clears them
+		VkMemoryBarrier2 resetBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
+		resetBarrier.srcStageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+		resetBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		resetBarrier.dstStageMask = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+		resetBarrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		m_MemoryBarriers.push_back(resetBarrier);
+		flushBarriers();
+		vkCmdResetQueryPool(m_CommandBuffer, queryPool, startIndex, count);
+
+		VkMemoryBarrier2 barrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER_2 };
+		barrier.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+		barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		barrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+		barrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+		m_MemoryBarriers.push_back(barrier);
+
+		queryHeap->markResolved();
+	}
+
 	void VulkanCommandList::beginRenderPass(const RenderPassDescription& renderPass) {
 		flushBarriers();
 
@@ -459,21 +568,58 @@ namespace rhi::vulkan {
 	}
 
 	void VulkanCommandList::bindPipeline(IPipelineState* pipeline) {
-		VkPipelineBindPoint bindPoint = pipeline->getType() == PipelineType::Compute ? VK_PIPELINE_BIND_POINT_COMPUTE : VK_PIPELINE_BIND_POINT_GRAPHICS;
-		vkCmdBindPipeline(m_CommandBuffer, bindPoint, static_cast<VkPipeline>(pipeline->getHandle()));
+		VkPipeline handle = static_cast<VkPipeline>(pipeline->getHandle());
+		bool isCompute = pipeline->getType() == PipelineType::Compute;
+		VkPipeline& current = isCompute ? m_ShadowState.computePipeline : m_ShadowState.graphicsPipeline;
+
+		if (current == handle) {
+			++m_Stats.filteredPipelineBinds;
+			return;
+		}
+
+		current = handle;
+		++m_Stats.pipelineBinds;
+		vkCmdBindPipeline(m_CommandBuffer, isCompute ? VK_PIPELINE_BIND_POINT_COMPUTE : VK_PIPELINE_BIND_POINT_GRAPHICS, handle);
 	}
 
 	void VulkanCommandList::setStencilReference(uint8_t reference) {
+		if (m_ShadowState.stencilReferenceValid && m_ShadowState.stencilReference == reference) {
+			++m_Stats.filteredDynamicStateSets;
+			return;
+		}
+
+		m_ShadowState.stencilReference = reference;
+		m_ShadowState.stencilReferenceValid = true;
+		++m_Stats.dynamicStateSets;
 		vkCmdSetStencilReference(m_CommandBuffer, VK_STENCIL_FACE_FRONT_AND_BACK, reference);
 	}
 
 	void VulkanCommandList::setBlendFactor(const float* blendFactor) {
+		if (m_ShadowState.blendFactorValid && memcmp(m_ShadowState.blendFactor, blendFactor, sizeof(float) * 4) == 0) {
+			++m_Stats.filteredDynamicStateSets;
+			return;
+		}
+
+		memcpy(m_ShadowState.blendFactor, blendFactor, sizeof(float) * 4);
+		m_ShadowState.blendFactorValid = true;
+		++m_Stats.dynamicStateSets;
 		vkCmdSetBlendConstants(m_CommandBuffer, blendFactor);
 	}
 
 	void VulkanCommandList::setIndexBuffer(IBuffer* buffer, uint32_t offset, Format format) {
+		VkBuffer handle = static_cast<VkBuffer>(buffer->getHandle());
 		VkIndexType indexType = (format == Format::R16_UINT) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
-		vkCmdBindIndexBuffer(m_CommandBuffer, static_cast<VkBuffer>(buffer->getHandle()), offset, indexType);
+
+		if (m_ShadowState.indexBuffer == handle && m_ShadowState.indexOffset == offset && m_ShadowState.indexType == indexType) {
+			++m_Stats.filteredDynamicStateSets;
+			return;
+		}
+
+		m_ShadowState.indexBuffer = handle;
+		m_ShadowState.indexOffset = offset;
+		m_ShadowState.indexType = indexType;
+		++m_Stats.dynamicStateSets;
+		vkCmdBindIndexBuffer(m_CommandBuffer, handle, offset, indexType);
 	}
 
 	void VulkanCommandList::setViewport(uint32_t x, uint32_t y, uint32_t width, uint32_t height) {
@@ -485,7 +631,16 @@ namespace rhi::vulkan {
 		viewport.minDepth = 0.0f;
 		viewport.maxDepth = 1.0f;
 
-		vkCmdSetViewport(m_CommandBuffer, 0, 1, &viewport);
+		if (m_ShadowState.viewportValid && memcmp(&m_ShadowState.viewport, &viewport, sizeof(VkViewport)) == 0) {
+			++m_Stats.filteredDynamicStateSets;
+		}
+		else {
+			m_ShadowState.viewport = viewport;
+			m_ShadowState.viewportValid = true;
+			++m_Stats.dynamicStateSets;
+			vkCmdSetViewport(m_CommandBuffer, 0, 1, &viewport);
+		}
+
 		setScissorRect(x, y, width, height);
 	}
 
@@ -496,61 +651,58 @@ namespace rhi::vulkan {
 		scissor.extent.width = width;
 		scissor.extent.height = height;
 
+		if (m_ShadowState.scissorValid && memcmp(&m_ShadowState.scissor, &scissor, sizeof(VkRect2D)) == 0) {
+			++m_Stats.filteredDynamicStateSets;
+			return;
+		}
+
+		m_ShadowState.scissor = scissor;
+		m_ShadowState.scissorValid = true;
+		++m_Stats.dynamicStateSets;
 		vkCmdSetScissor(m_CommandBuffer, 0, 1, &scissor);
 	}
 
 	void VulkanCommandList::setGraphicsConstants(uint32_t slot, const void* data, size_t dataSize)
 	{
-		if (slot == 0)
-		{
-			SE_ASSERT_NOMSG(dataSize <= SE_MAX_PUSH_CONSTANTS * sizeof(uint32_t));
-			memcpy(m_GraphicsConstants.ubv0, data, dataSize);
-		}
-		else
-		{
-			SE_ASSERT_NOMSG(slot < SE_MAX_UBV_BINDINGS);
-			VkDeviceAddress gpuAddress = ((VulkanDevice*)m_Device)->allocateUniformBuffer(data, dataSize);
-
-			if (slot == 1)
-			{
-				m_GraphicsConstants.ubv1.address = gpuAddress;
-				m_GraphicsConstants.ubv1.range = dataSize;
-			}
-			else
-			{
-				m_GraphicsConstants.ubv2.address = gpuAddress;
-				m_GraphicsConstants.ubv2.range = dataSize;
-			}
-		}
-
-		m_GraphicsConstants.needsUpdate = true;
+		setConstants(m_GraphicsConstants, slot, data, dataSize);
 	}
 
 	void VulkanCommandList::setComputeConstants(uint32_t slot, const void* data, size_t dataSize)
 	{
+		setConstants(m_ComputeConstants, slot, data, dataSize);
+	}
+
+	void VulkanCommandList::setConstants(ConstantData& constants, uint32_t slot, const void* data, size_t dataSize)
+	{
+		SE_ASSERT_NOMSG(slot < SE_MAX_UBV_BINDINGS);
+
+		uint64_t hash = XXH3_64bits(data, dataSize);
+		if (constants.valid[slot] && constants.size[slot] == dataSize && constants.hash[slot] == hash)
+		{
+			++m_Stats.filteredConstantUploads;
+			return;
+		}
+
+		constants.hash[slot] = hash;
+		constants.size[slot] = dataSize;
+		constants.valid[slot] = true;
+		++m_Stats.constantUploads;
+
 		if (slot == 0)
 		{
 			SE_ASSERT_NOMSG(dataSize <= SE_MAX_PUSH_CONSTANTS * sizeof(uint32_t));
-			memcpy(m_ComputeConstants.ubv0, data, dataSize);
+			memcpy(constants.ubv0, data, dataSize);
 		}
 		else
 		{
-			SE_ASSERT_NOMSG(slot < SE_MAX_UBV_BINDINGS);
 			VkDeviceAddress gpuAddress = ((VulkanDevice*)m_Device)->allocateUniformBuffer(data, dataSize);
 
-			if (slot == 1)
-			{
-				m_ComputeConstants.ubv1.address = gpuAddress;
-				m_ComputeConstants.ubv1.range = dataSize;
-			}
-			else
-			{
-				m_ComputeConstants.ubv2.address = gpuAddress;
-				m_ComputeConstants.ubv2.range = dataSize;
-			}
+			VkDescriptorAddressInfoEXT& ubv = (slot == 1) ? constants.ubv1 : constants.ubv2;
+			ubv.address = gpuAddress;
+			ubv.range = dataSize;
 		}
 
-		m_GraphicsConstants.needsUpdate = true;
+		constants.needsUpdate = true;
 	}
 
 	void VulkanCommandList::draw(uint32_t vertexCount, uint32_t instanceCount) {
@@ -574,7 +726,12 @@ namespace rhi::vulkan {
 		if (m_GraphicsConstants.needsUpdate)
 		{
 			VulkanDevice* device = (VulkanDevice*)m_Device;
-			VkDeviceSize cbvDescriptorOffset = device->allocateUniformBufferDescriptor(m_GraphicsConstants.ubv0, m_GraphicsConstants.ubv1, m_GraphicsConstants.ubv2);
+			VkDeviceAddress descriptorBufferAddress = 0;
+			VkDeviceSize cbvDescriptorOffset = device->allocateUniformBufferDescriptor(m_GraphicsConstants.ubv0, m_GraphicsConstants.ubv1, m_GraphicsConstants.ubv2, descriptorBufferAddress);
+			if (descriptorBufferAddress != m_ConstantBufferAddress)
+			{
+				bindDescriptorBuffers(descriptorBufferAddress);
+			}
 
 			uint32_t bufferIndices[] = { 0 };
 			VkDeviceSize offsets[] = { cbvDescriptorOffset };
@@ -590,7 +747,12 @@ namespace rhi::vulkan {
 		if (m_ComputeConstants.needsUpdate)
 		{
 			VulkanDevice* device = (VulkanDevice*)m_Device;
-			VkDeviceSize cbvDescriptorOffset = device->allocateUniformBufferDescriptor(m_ComputeConstants.ubv0, m_ComputeConstants.ubv1, m_ComputeConstants.ubv2);
+			VkDeviceAddress descriptorBufferAddress = 0;
+			VkDeviceSize cbvDescriptorOffset = device->allocateUniformBufferDescriptor(m_ComputeConstants.ubv0, m_ComputeConstants.ubv1, m_ComputeConstants.ubv2, descriptorBufferAddress);
+			if (descriptorBufferAddress != m_ConstantBufferAddress)
+			{
+				bindDescriptorBuffers(descriptorBufferAddress);
+			}
 
 			uint32_t bufferIndices[] = { 0 };
 			VkDeviceSize offsets[] = { cbvDescriptorOffset };
@@ -601,43 +763,64 @@ namespace rhi::vulkan {
 		}
 	}
 
-	//void VulkanCommandList::drawIndirect(Buffer* buffer, uint32_t offset) {
-	//	updateGraphicsDescriptorBuffer();
-	//	vkCmdDrawIndirect(m_CommandBuffer, static_cast<VkBuffer>(buffer->getHandle()), offset, 1, 0);
-	//}
+	void VulkanCommandList::drawIndirect(IBuffer* buffer, uint32_t offset) {
+		updateGraphicsDescriptorBuffer();
+		vkCmdDrawIndirect(m_CommandBuffer, static_cast<VkBuffer>(buffer->getHandle()), offset, 1, sizeof(DrawCommand));
+	}
 
-	//void VulkanCommandList::drawIndexedIndirect(Buffer* buffer, uint32_t offset) {
-	//	updateGraphicsDescriptorBuffer();
-	//	vkCmdDrawIndexedIndirect(m_CommandBuffer, static_cast<VkBuffer>(buffer->getHandle()), offset, 1, 0);
-	//}
+	void VulkanCommandList::drawIndexedIndirect(IBuffer* buffer, uint32_t offset) {
+		updateGraphicsDescriptorBuffer();
+		vkCmdDrawIndexedIndirect(m_CommandBuffer, static_cast<VkBuffer>(buffer->getHandle()), offset, 1, sizeof(DrawIndexedCommand));
+	}
 
-	//void VulkanCommandList::dispatchIndirect(Buffer* buffer, uint32_t offset) {
-	//	flushBarriers();
-	//	updateComputeDescriptorBuffer();
-	//	vkCmdDispatchIndirect(m_CommandBuffer, static_cast<VkBuffer>(buffer->getHandle()), offset);
-	//}
+	void VulkanCommandList::dispatchIndirect(IBuffer* buffer, uint32_t offset) {
+		flushBarriers();
+		updateComputeDescriptorBuffer();
+		vkCmdDispatchIndirect(m_CommandBuffer, static_cast<VkBuffer>(buffer->getHandle()), offset);
+	}
 
-	//void VulkanCommandList::dispatchMesh(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) {
-	//	updateGraphicsDescriptorBuffer();
-	//	vkCmdDrawMeshTasksEXT(m_CommandBuffer, groupCountX, groupCountY, groupCountZ);
-	//}
+	void VulkanCommandList::dispatchMesh(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) {
+		updateGraphicsDescriptorBuffer();
+		vkCmdDrawMeshTasksEXT(m_CommandBuffer, groupCountX, groupCountY, groupCountZ);
+	}
 
-	//void VulkanCommandList::dispatchMeshIndirect(Buffer* buffer, uint32_t offset) {
-	//	updateGraphicsDescriptorBuffer();
-	//	vkCmdDrawMeshTasksIndirectEXT(m_CommandBuffer, static_cast<VkBuffer>(buffer->getHandle()), offset, 1, 0);
-	//}
+	void VulkanCommandList::dispatchMeshIndirect(IBuffer* buffer, uint32_t offset) {
+		updateGraphicsDescriptorBuffer();
+		vkCmdDrawMeshTasksIndirectEXT(m_CommandBuffer, static_cast<VkBuffer>(buffer->getHandle()), offset, 1, sizeof(DispatchCommand));
+	}
 
-	//void VulkanCommandList::multiDrawIndirect(uint32_t maxCount, Buffer* argsBuffer, uint32_t argsBufferOffset, Buffer* countBuffer, uint32_t countBufferOffset) {
-	//	updateGraphicsDescriptorBuffer();
-	//	vkCmdDrawIndirectCount(m_CommandBuffer, static_cast<VkBuffer>(argsBuffer->getHandle()), argsBufferOffset,
-	//		static_cast<VkBuffer>(countBuffer->getHandle()), countBufferOffset, maxCount, sizeof(DrawCommand));
-	//}
+	void VulkanCommandList::multiDrawIndirect(uint32_t maxCount, IBuffer* argsBuffer, uint32_t argsBufferOffset, IBuffer* countBuffer, uint32_t countBufferOffset) {
+		updateGraphicsDescriptorBuffer();
+		if (countBuffer) {
+			vkCmdDrawIndirectCount(m_CommandBuffer, static_cast<VkBuffer>(argsBuffer->getHandle()), argsBufferOffset,
+				static_cast<VkBuffer>(countBuffer->getHandle()), countBufferOffset, maxCount, sizeof(DrawCommand));
+		}
+		else {
+			vkCmdDrawIndirect(m_CommandBuffer, static_cast<VkBuffer>(argsBuffer->getHandle()), argsBufferOffset, maxCount, sizeof(DrawCommand));
+		}
+	}
 
-	//void VulkanCommandList::multiDrawIndexedIndirect(uint32_t maxCount, Buffer* argsBuffer, uint32_t argsBufferOffset, Buffer* countBuffer, uint32_t countBufferOffset) {
-	//	updateGraphicsDescriptorBuffer();
-	//	vkCmdDrawIndexedIndirectCount(m_CommandBuffer, static_cast<VkBuffer>(argsBuffer->getHandle()), argsBufferOffset,
-	//		static_cast<VkBuffer>(countBuffer->getHandle()), countBufferOffset, maxCount, sizeof(DrawIndexedCommand));
-	//}
+	void VulkanCommandList::multiDrawIndexedIndirect(uint32_t maxCount, IBuffer* argsBuffer, uint32_t argsBufferOffset, IBuffer* countBuffer, uint32_t countBufferOffset) {
+		updateGraphicsDescriptorBuffer();
+		if (countBuffer) {
+			vkCmdDrawIndexedIndirectCount(m_CommandBuffer, static_cast<VkBuffer>(argsBuffer->getHandle()), argsBufferOffset,
+				static_cast<VkBuffer>(countBuffer->getHandle()), countBufferOffset, maxCount, sizeof(DrawIndexedCommand));
+		}
+		else {
+			vkCmdDrawIndexedIndirect(m_CommandBuffer, static_cast<VkBuffer>(argsBuffer->getHandle()), argsBufferOffset, maxCount, sizeof(DrawIndexedCommand));
+		}
+	}
+
+	void VulkanCommandList::multiDispatchMeshIndirect(uint32_t maxCount, IBuffer* argsBuffer, uint32_t argsBufferOffset, IBuffer* countBuffer, uint32_t countBufferOffset) {
+		updateGraphicsDescriptorBuffer();
+		if (countBuffer) {
+			vkCmdDrawMeshTasksIndirectCountEXT(m_CommandBuffer, static_cast<VkBuffer>(argsBuffer->getHandle()), argsBufferOffset,
+				static_cast<VkBuffer>(countBuffer->getHandle()), countBufferOffset, maxCount, sizeof(DispatchCommand));
+		}
+		else {
+			vkCmdDrawMeshTasksIndirectEXT(m_CommandBuffer, static_cast<VkBuffer>(argsBuffer->getHandle()), argsBufferOffset, maxCount, sizeof(DispatchCommand));
+		}
+	}
 
 	//void VulkanCommandList::clearStorageBuffer(Resource* resource, DescriptorSet* uav, const float* clearValue) {
 	//	const UnorderedAccessDescriptorDesc& desc = static_cast<VulkanUnorderedAccessDescriptor*>(uav)->getDesc();
@@ -654,6 +837,34 @@ namespace rhi::vulkan {
 		vkCmdUpdateBuffer(m_CommandBuffer, static_cast<VkBuffer>(buffer->getHandle()), offset, sizeof(uint32_t), &data);
 	}
 
+	static bool isHeapCompatible(IHeap* heap, uint32_t memoryTypeBits, uint32_t mappingCount, const TileMapping* mappings) {
+		bool maps = std::any_of(mappings, mappings + mappingCount, [](const TileMapping& mapping) { return mapping.type == TileMappingType::Map; });
+		return !maps || (heap && (memoryTypeBits & (1u << ((VulkanHeap*)heap)->getMemoryTypeIndex())) != 0);
+	}
+
+	void VulkanCommandList::updateTileMappings(ITexture* texture, IHeap* heap, uint32_t mappingCount, const TileMapping* mappings) {
+		SE_ASSERT(anySet(texture->getDescription().usage, TextureUsageFlags::Sparse), "Tile mappings need a sparse texture");
+		// Binding memory of a type the image does not accept is invalid and may lose the device
+		if (!isHeapCompatible(heap, ((VulkanTexture*)texture)->getSparseMemoryTypeBits(), mappingCount, mappings)) {
+			SE::LogError("Heap memory type is not compatible with sparse texture {}, mappings rejected", texture->getDebugName());
+			return;
+		}
+		for (uint32_t i = 0; i < mappingCount; ++i) {
+			m_PendingTileMappings.push_back({ texture, heap, mappings[i] });
+		}
+	}
+
+	void VulkanCommandList::updateTileMappings(IBuffer* buffer, IHeap* heap, uint32_t mappingCount, const TileMapping* mappings) {
+		SE_ASSERT(anySet(buffer->getDescription().usage, BufferUsageFlags::Sparse), "Tile mappings need a sparse buffer");
+		if (!isHeapCompatible(heap, ((VulkanBuffer*)buffer)->getSparseMemoryTypeBits(), mappingCount, mappings)) {
+			SE::LogError("Heap memory type is not compatible with sparse buffer {}, mappings rejected", buffer->getDebugName());
+			return;
+		}
+		for (uint32_t i = 0; i < mappingCount; ++i) {
+			m_PendingTileMappings.push_back({ buffer, heap, mappings[i] });
+		}
+	}
+
 	//void VulkanCommandList::beginEvent(const std::string& eventName) {
 	//	VkDebugUtilsLabelEXT labelInfo = { VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT };
 	//	labelInfo.pLabelName = eventName.c_str();
@@ -5,6 +5,15 @@
 namespace rhi::vulkan
 {
 	class VulkanDevice;
+	class VulkanQueue;
+
+	struct VulkanTileMappingUpdate
+	{
+		IResource* resource = nullptr;
+		IHeap* heap = nullptr;
+		TileMapping mapping;
+	};
+
 	class VulkanCommandList : public ICommandList {
 	public:
 		VulkanCommandList(VulkanDevice* device, CommandType type, const std::string& name);
@@ -25,13 +34,16 @@ namespace rhi::vulkan
 
 		// Resource operations
 		void copyBufferToTexture(ITexture* dstTexture, uint32_t mipLevel, uint32_t arraySlice, IBuffer* srcBuffer, uint32_t offset) override;
+		void copyBufferToTexture(ITexture* dstTexture, IBuffer* srcBuffer, uint32_t offset, uint32_t footprintCount, const SubresourceFootprint* footprints) override;
 		void copyTextureToBuffer(IBuffer* dstBuffer, uint32_t offset, ITexture* srcTexture, uint32_t mipLevel, uint32_t arraySlice) override;
 		void copyBuffer(IBuffer* dstBuffer, uint32_t dstOffset, IBuffer* srcBuffer, uint32_t srcOffset, uint32_t size) override;
+		void copyBuffer(IBuffer* dstBuffer, IBuffer* srcBuffer, uint32_t regionCount, const BufferCopyRegion* regions) override;
 		void copyTexture(ITexture* dstTexture, uint32_t dstMip, uint32_t dstArray, ITexture* srcTexture, uint32_t srcMip, uint32_t srcArray) override;
 		void clearStorageBuffer(IResource* resource, IDescriptor* storage, const float* clearValue) override;
 		void clearStorageBuffer(IResource* resource, IDescriptor* storage, const uint32_t* clearValue) override;
 		void writeBuffer(IBuffer* dstBuffer, uint32_t offset, uint32_t data) override;
-		//void updateTileMappings(Texture* texture, Heap* heap, uint32_t mappingCount, const TileMapping* mappings) override;
+		void updateTileMappings(ITexture* texture, IHeap* heap, uint32_t mappingCount, const TileMapping* mappings) override;
+		void updateTileMappings(IBuffer* buffer, IHeap* heap, uint32_t mappingCount, const TileMapping* mappings) override;
 
 		// Barriers
 
@@ -41,6 +53,11 @@ namespace rhi::vulkan
 		void globalBarrier(ResourceAccessFlags accessBefore, ResourceAccessFlags accessAfter) override;
 		void flushBarriers() override;
 
+		void beginQuery(IQueryHeap* heap, uint32_t index) override;
+		void endQuery(IQueryHeap* heap, uint32_t index) override;
+		void writeTimestamp(IQueryHeap* heap, uint32_t index) override;
+		void resolveQueries(IQueryHeap* heap, uint32_t startIndex, uint32_t count) override;
+
 		// Render state
 		void beginRenderPass(const RenderPassDescription& renderPass) override;
 		void endRenderPass() override;
@@ -57,26 +74,30 @@ namespace rhi::vulkan
 		void draw(uint32_t vertexCount, uint32_t instanceCount = 1) override;
 		void drawIndexed(uint32_t indexCount, uint32_t instanceCount = 1, uint32_t indexOffset = 0) override;
 		void dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) override;
-		//void dispatchMesh(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) override;
-
-		//// Indirect commands
-		//void drawIndirect(Buffer* buffer, uint32_t offset) override;
-		//void drawIndexedIndirect(Buffer* buffer, uint32_t offset) override;
-		//void dispatchIndirect(Buffer* buffer, uint32_t offset) override;
-		//void dispatchMeshIndirect(Buffer* buffer, uint32_t offset) override;
-
-		//// Multi-draw indirect
-		//void multiDrawIndirect(uint32_t maxCount, Buffer* argsBuffer, uint32_t argsOffset, Buffer* countBuffer, uint32_t countOffset) override;
-		//void multiDrawIndexedIndirect(uint32_t maxCount, Buffer* argsBuffer, uint32_t argsOffset, Buffer* countBuffer, uint32_t countOffset) override;
+		void dispatchMesh(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) override;
+
+		// Indirect commands
+		void drawIndirect(IBuffer* buffer, uint32_t offset) override;
+		void drawIndexedIndirect(IBuffer* buffer, uint32_t offset) override;
+		void dispatchIndirect(IBuffer* buffer, uint32_t offset) override;
+		void dispatchMeshIndirect(IBuffer* buffer, uint32_t offset) override;
+
+		// Multi-draw indirect
+		void multiDrawIndirect(uint32_t maxCount, IBuffer* argsBuffer, uint32_t argsOffset, IBuffer* countBuffer, uint32_t countOffset) override;
+		void multiDrawIndexedIndirect(uint32_t maxCount, IBuffer* argsBuffer, uint32_t argsOffset, IBuffer* countBuffer, uint32_t countOffset) override;
+		void multiDispatchMeshIndirect(uint32_t maxCount, IBuffer* argsBuffer, uint32_t argsOffset, IBuffer* countBuffer, uint32_t countOffset) override;
 		//void multiDispatchIndirect(uint32_t maxCount, Buffer* argsBuffer, uint32_t argsOffset, Buffer* countBuffer, uint32_t countOffset) override;
-		//void multiDispatchMeshIndirect(uint32_t maxCount, Buffer* argsBuffer, uint32_t argsOffset, Buffer* countBuffer, uint32_t countOffset) override;
 
 	private:
+		struct ConstantData;
+		void setConstants(ConstantData& constants, uint32_t slot, const void* data, size_t dataSize);
 		void updateGraphicsDescriptorBuffer();
 		void updateComputeDescriptorBuffer();
+		// Constants live in the ring or in an overflow block, the descriptor buffer binding follows the block in use
+		void bindDescriptorBuffers(VkDeviceAddress constantBufferAddress);
 
 	private:
-		VkQueue m_Queue = VK_NULL_HANDLE;
+		VulkanQueue* m_Queue = nullptr;
 		VkCommandPool m_CommandPool = VK_NULL_HANDLE;
 		VkCommandBuffer m_CommandBuffer = VK_NULL_HANDLE;
 
@@ -86,8 +107,11 @@ namespace rhi::vulkan
 		std::vector<VkMemoryBarrier2> m_MemoryBarriers;
 		std::vector<VkBufferMemoryBarrier2> m_BufferBarriers;
 		std::vector<VkImageMemoryBarrier2> m_ImageBarriers;
+		std::vector<VkBufferImageCopy2> m_CopyRegions;
+		std::vector<VkBufferCopy2> m_BufferCopyRegions;
 
 		std::vector<std::pair<IFence*, uint64_t>> m_PendingWaits;
+		std::vector<VulkanTileMappingUpdate> m_PendingTileMappings;
 		std::vector<std::pair<IFence*, uint64_t>> m_PendingSignals;
 		std::vector<ISwapchain*> m_PendingSwapchains;
 
@@ -96,10 +120,34 @@ namespace rhi::vulkan
 			uint32_t ubv0[SE_MAX_PUSH_CONSTANTS] = {};
 			VkDescriptorAddressInfoEXT ubv1 = { VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT };
 			VkDescriptorAddressInfoEXT ubv2 = { VK_STRUCTURE_TYPE_DESCRIPTOR_ADDRESS_INFO_EXT };
+			uint64_t hash[SE_MAX_UBV_BINDINGS] = {};
+			size_t size[SE_MAX_UBV_BINDINGS] = {}; // compared with the hash, it is also the bound range
+			bool valid[SE_MAX_UBV_BINDINGS] = {};
 			bool needsUpdate = false;
 		};
 
 		ConstantData m_GraphicsConstants;
 		ConstantData m_ComputeConstants;
+
+		// Shadow of the state recorded into the current command buffer, used to drop redundant calls
+		struct ShadowState
+		{
+			VkPipeline graphicsPipeline = VK_NULL_HANDLE;
+			VkPipeline computePipeline = VK_NULL_HANDLE;
+			VkViewport viewport = {};
+			VkRect2D scissor = {};
+			float blendFactor[4] = {};
+			VkBuffer indexBuffer = VK_NULL_HANDLE;
+			VkDeviceSize indexOffset = 0;
+			VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+			uint8_t stencilReference = 0;
+			bool viewportValid = false;
+			bool scissorValid = false;
+			bool blendFactorValid = false;
+			bool stencilReferenceValid = false;
+		};
+
+		ShadowState m_ShadowState;
+		VkDeviceAddress m_ConstantBufferAddress = 0;
 	};
 }
\ No newline at end of file
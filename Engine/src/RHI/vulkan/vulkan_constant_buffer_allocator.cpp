@@ -1,49 +1,217 @@
 #include "vulkan_constant_buffer_allocator.hpp"
 #include "vulkan_device.hpp"
+#include <algorithm>
 
 namespace rhi::vulkan {
-	VulkanConstantBufferAllocator::VulkanConstantBufferAllocator(VulkanDevice* device, uint32_t bufferSize)
+	static const uint32_t CONSTANT_ALIGNMENT = 256;
+	// Overflow blocks that stayed unused for this many frames are released
+	static const uint64_t OVERFLOW_BLOCK_IDLE_FRAMES = 64;
+
+	VulkanConstantBufferAllocator::VulkanConstantBufferAllocator(VulkanDevice* device, uint32_t ringSize, uint32_t overflowBlockSize)
 	{
 		m_Device = device;
-		m_BufferSize = bufferSize;
+		m_OverflowBlockSize = overflowBlockSize;
+
+		createBlock(ringSize, m_Ring);
+		m_Stats.ringSize = ringSize;
+	}
+
+	VulkanConstantBufferAllocator::~VulkanConstantBufferAllocator()
+	{
+		destroyBlock(m_Ring);
+		for (Block& block : m_OverflowBlocks)
+		{
+			destroyBlock(block);
+		}
+	}
 
+	bool VulkanConstantBufferAllocator::createBlock(uint32_t size, Block& block)
+	{
 		VkBufferCreateInfo createInfo{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
-		createInfo.size = bufferSize;
+		createInfo.size = size;
 		createInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
 			VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT |
 			VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
 
 		VmaAllocationCreateInfo allocInfo{};
 		allocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
-		allocInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT |
-			VMA_ALLOCATION_CREATE_MAPPED_BIT;
+		allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
 
 		VmaAllocationInfo allocatedInfo;
-		vmaCreateBuffer(device->getVmaAllocator(), &createInfo, &allocInfo,
-			&m_Buffer, &m_Allocation, &allocatedInfo);
+		VK_CHECK_RETURN(vmaCreateBuffer(m_Device->getVmaAllocator(), &createInfo, &allocInfo, &block.buffer, &block.allocation, &allocatedInfo),
+			false, "Constant buffer block creation failed! {} bytes", size);
 
-		m_CpuAddress = allocatedInfo.pMappedData;
+		block.cpuAddress = allocatedInfo.pMappedData;
+		block.size = size;
+		m_Device->trackAllocation(MemoryCategory::ConstantBuffer, block.allocation);
 
 		VkBufferDeviceAddressInfo addressInfo{ VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO };
-		addressInfo.buffer = m_Buffer;
-		m_GpuAddress = vkGetBufferDeviceAddress(device->getDevice(), &addressInfo);
+		addressInfo.buffer = block.buffer;
+		block.gpuAddress = vkGetBufferDeviceAddress(m_Device->getDevice(), &addressInfo);
+		return true;
 	}
 
-	VulkanConstantBufferAllocator::~VulkanConstantBufferAllocator()
+	void VulkanConstantBufferAllocator::destroyBlock(Block& block)
+	{
+		m_Device->untrackAllocation(MemoryCategory::ConstantBuffer, block.allocation);
+		vmaDestroyBuffer(m_Device->getVmaAllocator(), block.buffer, block.allocation);
+		block = {};
+	}
+
+	VkDeviceAddress VulkanConstantBufferAllocator::allocate(uint32_t size, void** cpuAddress, VkDeviceAddress* gpuAddress)
 	{
-		vmaDestroyBuffer(m_Device->getVmaAllocator(), m_Buffer, m_Allocation);
+		size = SE::alignToPowerOfTwo<uint32_t>(size, CONSTANT_ALIGNMENT);
+
+		uint32_t offset = 0;
+		if (allocateFromRing(size, offset))
+		{
+			*cpuAddress = static_cast<char*>(m_Ring.cpuAddress) + offset;
+			*gpuAddress = m_Ring.gpuAddress + offset;
+			return m_Ring.gpuAddress;
+		}
+
+		// The ring is full of frames still in flight
+		Block* block = getOverflowBlock(size);
+		SE_ASSERT(block, "Out of memory for constant buffers");
+
+		*cpuAddress = static_cast<char*>(block->cpuAddress) + block->offset;
+		*gpuAddress = block->gpuAddress + block->offset;
+		block->offset += size;
+		block->usedThisFrame = true;
+		m_FrameOverflowSize += size;
+		return block->gpuAddress;
 	}
 
-	void VulkanConstantBufferAllocator::allocate(uint32_t size, void** cpuAddress, VkDeviceAddress* gpuAddress)
+	bool VulkanConstantBufferAllocator::allocateFromRing(uint32_t size, uint32_t& offset)
 	{
-		SE_ASSERT_NOMSG(m_AllocatedSize + size <= m_BufferSize);
-		*cpuAddress = static_cast<char*>(m_CpuAddress) + m_AllocatedSize;
-		*gpuAddress = m_GpuAddress + m_AllocatedSize;
-		m_AllocatedSize += SE::alignToPowerOfTwo<uint32_t>(size, 256);
+		if (m_UsedSize == 0)
+		{
+			m_Head = 0;
+			m_Tail = 0;
+		}
+		else if (m_UsedSize == m_Ring.size)
+		{
+			return false;
+		}
+
+		uint32_t allocatedSize = size;
+		if (m_Head >= m_Tail)
+		{
+			if (m_Head + size <= m_Ring.size)
+			{
+				offset = m_Head;
+			}
+			else if (size <= m_Tail)
+			{
+				// Wrap around, the end of the ring stays unused until this frame retires
+				allocatedSize += m_Ring.size - m_Head;
+				offset = 0;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		else if (m_Head + size <= m_Tail)
+		{
+			offset = m_Head;
+		}
+		else
+		{
+			return false;
+		}
+
+		m_Head = offset + size;
+		m_UsedSize += allocatedSize;
+		m_FrameRingSize += allocatedSize;
+		m_Stats.ringHighWater = std::max(m_Stats.ringHighWater, m_UsedSize);
+		return true;
+	}
+
+	VulkanConstantBufferAllocator::Block* VulkanConstantBufferAllocator::getOverflowBlock(uint32_t size)
+	{
+		for (Block& block : m_OverflowBlocks)
+		{
+			if (block.usedThisFrame && block.offset + size <= block.size)
+			{
+				return &block;
+			}
+		}
+
+		for (Block& block : m_OverflowBlocks)
+		{
+			if (!block.usedThisFrame && block.offset == 0 && size <= block.size)
+			{
+				return &block;
+			}
+		}
+
+		Block block;
+		if (!createBlock(std::max(size, m_OverflowBlockSize), block))
+		{
+			return nullptr;
+		}
+		m_OverflowBlocks.push_back(block);
+		return &m_OverflowBlocks.back();
+	}
+
+	void VulkanConstantBufferAllocator::endFrame(uint64_t fenceValue)
+	{
+		if (m_FrameRingSize > 0)
+		{
+			m_Frames.push_back({ fenceValue, m_Head, m_FrameRingSize });
+		}
+
+		for (Block& block : m_OverflowBlocks)
+		{
+			if (block.usedThisFrame)
+			{
+				block.fenceValue = fenceValue;
+				block.usedThisFrame = false;
+			}
+		}
+
+		m_Stats.frameSize = m_FrameRingSize + m_FrameOverflowSize;
+		m_Stats.frameHighWater = std::max(m_Stats.frameHighWater, m_Stats.frameSize);
+		m_FrameRingSize = 0;
+		m_FrameOverflowSize = 0;
+	}
+
+	void VulkanConstantBufferAllocator::retire(uint64_t completedFenceValue)
+	{
+		while (!m_Frames.empty() && m_Frames.front().fenceValue <= completedFenceValue)
+		{
+			m_Tail = m_Frames.front().end;
+			m_UsedSize -= m_Frames.front().size;
+			m_Frames.pop_front();
+		}
+
+		for (size_t i = 0; i < m_OverflowBlocks.size();)
+		{
+			Block& block = m_OverflowBlocks[i];
+			if (!block.usedThisFrame && block.fenceValue <= completedFenceValue)
+			{
+				block.offset = 0;
+				if (completedFenceValue - block.fenceValue > OVERFLOW_BLOCK_IDLE_FRAMES)
+				{
+					destroyBlock(block);
+					m_OverflowBlocks.erase(m_OverflowBlocks.begin() + i);
+					continue;
+				}
+			}
+			++i;
+		}
 	}
 
-	void VulkanConstantBufferAllocator::reset()
+	ConstantBufferStats VulkanConstantBufferAllocator::getStats() const
 	{
-		m_AllocatedSize = 0;
+		ConstantBufferStats stats = m_Stats;
+		stats.ringUsedSize = m_UsedSize;
+		stats.overflowBlockCount = (uint32_t)m_OverflowBlocks.size();
+		for (const Block& block : m_OverflowBlocks)
+		{
+			stats.overflowBlockSize += block.size;
+		}
+		return stats;
 	}
-}
\ No newline at end of file
+}
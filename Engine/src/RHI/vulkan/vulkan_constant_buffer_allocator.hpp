@@ -1,26 +1,66 @@
 #pragma once
 #include "vulkan_core.hpp"
+#include <deque>
+#include <vector>
 
 namespace rhi::vulkan
 {
 	class VulkanDevice;
 
+	// Ring over a persistently mapped buffer shared by all frames in flight. Frames are retired by the value their
+	// fence is signaled with; while the ring is full of in-flight frames, overflow blocks are chained and reused later.
 	class VulkanConstantBufferAllocator {
 	public:
-		VulkanConstantBufferAllocator(VulkanDevice* device, uint32_t bufferSize);
+		VulkanConstantBufferAllocator(VulkanDevice* device, uint32_t ringSize, uint32_t overflowBlockSize);
 		~VulkanConstantBufferAllocator();
 
-		void allocate(uint32_t size, void** cpuAddress, VkDeviceAddress* gpuAddress);
-		void reset();
-		VkDeviceAddress getGpuAddress() const { return m_GpuAddress; }
+		// Returns the address of the block the allocation lives in, descriptors have to be bound relative to it
+		VkDeviceAddress allocate(uint32_t size, void** cpuAddress, VkDeviceAddress* gpuAddress);
+		// Allocations made since the previous call are released once the fence reaches fenceValue
+		void endFrame(uint64_t fenceValue);
+		void retire(uint64_t completedFenceValue);
+		VkDeviceAddress getGpuAddress() const { return m_Ring.gpuAddress; }
+		ConstantBufferStats getStats() const;
+
+	private:
+		struct Block
+		{
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VmaAllocation allocation = VK_NULL_HANDLE;
+			void* cpuAddress = nullptr;
+			VkDeviceAddress gpuAddress = 0;
+			uint32_t size = 0;
+			uint32_t offset = 0;
+			uint64_t fenceValue = 0;
+			bool usedThisFrame = false;
+		};
+
+		struct Frame
+		{
+			uint64_t fenceValue = 0;
+			uint32_t end = 0;
+			uint32_t size = 0;
+		};
+
+		bool createBlock(uint32_t size, Block& block);
+		void destroyBlock(Block& block);
+		bool allocateFromRing(uint32_t size, uint32_t& offset);
+		Block* getOverflowBlock(uint32_t size);
 
 	private:
 		VulkanDevice* m_Device{ nullptr };
-		VkBuffer m_Buffer{ VK_NULL_HANDLE };
-		VmaAllocation m_Allocation{ VK_NULL_HANDLE };
-		VkDeviceAddress m_GpuAddress{ 0 };
-		void* m_CpuAddress{ nullptr };
-		uint32_t m_BufferSize{ 0 };
-		uint32_t m_AllocatedSize{ 0 };
+
+		Block m_Ring;
+		uint32_t m_Head{ 0 };
+		uint32_t m_Tail{ 0 };
+		uint32_t m_UsedSize{ 0 };
+		uint32_t m_FrameRingSize{ 0 };
+		std::deque<Frame> m_Frames;
+
+		uint32_t m_OverflowBlockSize{ 0 };
+		std::vector<Block> m_OverflowBlocks;
+		uint32_t m_FrameOverflowSize{ 0 };
+
+		ConstantBufferStats m_Stats;
 	};
-}
\ No newline at end of file
+}
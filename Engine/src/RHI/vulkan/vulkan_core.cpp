@@ -23,6 +23,8 @@ namespace rhi::vulkan
 			return VMA_MEMORY_USAGE_CPU_TO_GPU;
 		case MemoryType::GpuToCpu:
 			return VMA_MEMORY_USAGE_GPU_TO_CPU;
+		case MemoryType::GpuUpload:
+			return VMA_MEMORY_USAGE_CPU_TO_GPU; // DEVICE_LOCAL is required at allocation
 		case MemoryType::CpuOnly:
 			return VMA_MEMORY_USAGE_CPU_ONLY;
 		default:
@@ -388,8 +390,9 @@ namespace rhi::vulkan
 		if (anySet(flags, ResourceAccessFlags::DepthStencilStorage | ResourceAccessFlags::DepthStencilRead))
 			stage |= VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
 
+		// Also covers task and mesh shaders, which read scene data the same way
 		if (anySet(flags, ResourceAccessFlags::VertexShaderRead | ResourceAccessFlags::VertexShaderStorage))
-			stage |= VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT;
+			stage |= VK_PIPELINE_STAGE_2_PRE_RASTERIZATION_SHADERS_BIT;
 
 		if (anySet(flags, ResourceAccessFlags::PixelShaderRead | ResourceAccessFlags::PixelShaderStorage))
 			stage |= VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
@@ -418,6 +421,9 @@ namespace rhi::vulkan
 		if (anySet(flags, ResourceAccessFlags::Discard))
 			stage |= VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
 
+		if (anySet(flags, ResourceAccessFlags::HostRead))
+			stage |= VK_PIPELINE_STAGE_2_HOST_BIT;
+
 		if (stage == VK_PIPELINE_STAGE_2_NONE)
 		{
 			stage = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
@@ -550,6 +556,9 @@ namespace rhi::vulkan
 		if (anySet(flags, ResourceAccessFlags::AccelerationStructureStorage))
 			access |= VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
 
+		if (anySet(flags, ResourceAccessFlags::HostRead))
+			access |= VK_ACCESS_2_HOST_READ_BIT;
+
 		if (access == VK_ACCESS_2_NONE && !anySet(flags, ResourceAccessFlags::Present))
 		{
 			SE::LogWarn("VK_ACCESS IS EMPTY. Possible undefined resource access");
@@ -579,6 +588,33 @@ namespace rhi::vulkan
 		return info;
 	}
 
+	VkBufferCreateInfo toBufferCreateInfo(const BufferDescription& desc) {
+		VkBufferCreateInfo info{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+		info.size = desc.size;
+		info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		info.usage =
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+			VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+			VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT;
+
+		if (anySet(desc.usage, BufferUsageFlags::UniformBuffer))
+			info.usage |= VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+		if (anySet(desc.usage, BufferUsageFlags::StructuredBuffer | BufferUsageFlags::RawBuffer))
+			info.usage |= VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+		if (anySet(desc.usage, BufferUsageFlags::FormattedBuffer)) {
+			if (anySet(desc.usage, BufferUsageFlags::ShaderStorageBuffer))
+				info.usage |= VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT;
+			else
+				info.usage |= VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT;
+		}
+		if (anySet(desc.usage, BufferUsageFlags::Sparse))
+			info.flags |= VK_BUFFER_CREATE_SPARSE_BINDING_BIT | VK_BUFFER_CREATE_SPARSE_RESIDENCY_BIT;
+
+		return info;
+	}
+
 	VkImageCreateInfo toImageCreateInfo(const TextureDescription& desc) {
 		VkImageCreateInfo info{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
 
@@ -610,6 +646,8 @@ namespace rhi::vulkan
 			info.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
 		if (anySet(desc.usage, TextureUsageFlags::ShaderStorage))
 			info.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+		if (anySet(desc.usage, TextureUsageFlags::Sparse))
+			info.flags |= VK_IMAGE_CREATE_SPARSE_BINDING_BIT | VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT;
 
 		if (desc.type == TextureType::TextureCube ||
 			desc.type == TextureType::TextureCubeArray) {
@@ -864,19 +902,19 @@ namespace rhi::vulkan
 		return range;
 	}
 
-	VkPipelineRenderingCreateInfo toVkPipelineRenderingCreateInfo(const GraphicsPipelineDescription& pipelineDesc, VkFormat* colorFormats)
+	static VkPipelineRenderingCreateInfo toVkPipelineRenderingCreateInfo(const Format* renderTargetFormats, Format depthStencilFormat, VkFormat* colorFormats)
 	{
 		for (uint32_t i = 0; i < 8; ++i)
 		{
-			colorFormats[i] = toVkFormat(pipelineDesc.renderTargetFormat[i], true);
+			colorFormats[i] = toVkFormat(renderTargetFormats[i], true);
 		}
 
 		VkPipelineRenderingCreateInfo createInfo = { VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO };
 		createInfo.colorAttachmentCount = 1;
 		createInfo.pColorAttachmentFormats = colorFormats;
-		createInfo.depthAttachmentFormat = toVkFormat(pipelineDesc.depthStencilFormat);
+		createInfo.depthAttachmentFormat = toVkFormat(depthStencilFormat);
 
-		if (pipelineDesc.depthStencilFormat == Format::D32_SFLOAT_S8_UINT)
+		if (depthStencilFormat == Format::D32_SFLOAT_S8_UINT)
 		{
 			createInfo.stencilAttachmentFormat = createInfo.depthAttachmentFormat;
 		}
@@ -884,6 +922,16 @@ namespace rhi::vulkan
 		return createInfo;
 	}
 
+	VkPipelineRenderingCreateInfo toVkPipelineRenderingCreateInfo(const GraphicsPipelineDescription& pipelineDesc, VkFormat* colorFormats)
+	{
+		return toVkPipelineRenderingCreateInfo(pipelineDesc.renderTargetFormat, pipelineDesc.depthStencilFormat, colorFormats);
+	}
+
+	VkPipelineRenderingCreateInfo toVkPipelineRenderingCreateInfo(const MeshShadingPipelineDescription& pipelineDesc, VkFormat* colorFormats)
+	{
+		return toVkPipelineRenderingCreateInfo(pipelineDesc.renderTargetFormat, pipelineDesc.depthStencilFormat, colorFormats);
+	}
+
 	VkComponentMapping getVkComponentMapping(bool swizzleRGB) {
 		if (swizzleRGB) {
 			return { VK_COMPONENT_SWIZZLE_B, VK_COMPONENT_SWIZZLE_G,
@@ -56,6 +56,8 @@ namespace rhi::vulkan
 	VkSamplerAddressMode toVkAddressMode(AddressMode mode);
 	VkFilter toVkFilter(FilterMode filter);
 
+	VkBufferCreateInfo toBufferCreateInfo(const BufferDescription& desc);
+
 	// Image related functions
 	VkImageCreateInfo toImageCreateInfo(const TextureDescription& desc);
 	VkImageViewCreateInfo imageViewCreateInfo();
@@ -72,4 +74,5 @@ namespace rhi::vulkan
 	VkComponentMapping getVkComponentMapping(bool swizzleRGB = false);
 
 	VkPipelineRenderingCreateInfo toVkPipelineRenderingCreateInfo(const GraphicsPipelineDescription& pipelineDesc, VkFormat* colorFormats);
+	VkPipelineRenderingCreateInfo toVkPipelineRenderingCreateInfo(const MeshShadingPipelineDescription& pipelineDesc, VkFormat* colorFormats);
 }
\ No newline at end of file
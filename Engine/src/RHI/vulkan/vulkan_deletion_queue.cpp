@@ -14,7 +14,10 @@ namespace rhi::vulkan
 
 	void VulkanDeletionQueue::flush(bool forceDelete)
 	{
-		uint64_t frameID = m_Device->getFrameID();
+		// Entries are tagged with the unwrapped frame counter, the frame-in-flight index would never pass them
+		uint64_t frameID = m_Device->getFrameCount();
+		SE_ASSERT(frameID >= m_LastFlushFrame, "Deletion queue flushed with a frame counter that went backwards");
+		m_LastFlushFrame = frameID;
 		VkInstance instance = m_Device->getInstance();
 		VkDevice device = m_Device->getDevice();
 		VmaAllocator allocator = m_Device->getVmaAllocator();
@@ -39,6 +42,7 @@ namespace rhi::vulkan
 		processQueue(m_SemaphoreQueue, vkDestroySemaphore);
 		processQueue(m_SwapchainQueue, vkDestroySwapchainKHR);
 		processQueue(m_CommandPoolQueue, vkDestroyCommandPool);
+		processQueue(m_QueryPoolQueue, vkDestroyQueryPool);
 
 		// Surface deletion
 		while (!m_SurfaceQueue.empty()) {
@@ -83,6 +87,7 @@ namespace rhi::vulkan
 
 	void VulkanDeletionQueue::freeResourceDescriptor(uint32_t index, uint64_t frameID)
 	{
+		// The slot is handed out again by the first flush of frame frameID + SE_MAX_FRAMES_IN_FLIGHT
 		m_ResourceDescriptorQueue.push(std::make_pair(index, frameID));
 	}
 
@@ -156,4 +161,10 @@ namespace rhi::vulkan
 	{
 		m_CommandPoolQueue.push(std::make_pair(object, frameID));
 	}
+
+	template<>
+	void VulkanDeletionQueue::enqueue(VkQueryPool object, uint64_t frameID)
+	{
+		m_QueryPoolQueue.push(std::make_pair(object, frameID));
+	}
 }
\ No newline at end of file
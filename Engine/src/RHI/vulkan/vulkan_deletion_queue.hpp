@@ -22,6 +22,7 @@ namespace rhi::vulkan
 
 	private:
 		VulkanDevice* m_Device = nullptr;
+		uint64_t m_LastFlushFrame = 0;
 		std::queue<std::pair<VkImage, uint64_t>> m_ImageQueue;
 		std::queue<std::pair<VkBuffer, uint64_t>> m_BufferQueue;
 		std::queue<std::pair<VmaAllocation, uint64_t>> m_AllocationQueue;
@@ -33,6 +34,7 @@ namespace rhi::vulkan
 		std::queue<std::pair<VkSwapchainKHR, uint64_t>> m_SwapchainQueue;
 		std::queue<std::pair<VkSurfaceKHR, uint64_t>> m_SurfaceQueue;
 		std::queue<std::pair<VkCommandPool, uint64_t>> m_CommandPoolQueue;
+		std::queue<std::pair<VkQueryPool, uint64_t>> m_QueryPoolQueue;
 		std::queue<std::pair<uint32_t, uint64_t>> m_ResourceDescriptorQueue;
 		std::queue<std::pair<uint32_t, uint64_t>> m_SamplerDescriptorQueue;
 	};
@@ -56,4 +58,5 @@ namespace rhi::vulkan
 	template<> void VulkanDeletionQueue::enqueue<VkSwapchainKHR>(VkSwapchainKHR object, uint64_t frameID);
 	template<> void VulkanDeletionQueue::enqueue<VkSurfaceKHR>(VkSurfaceKHR object, uint64_t frameID);
 	template<> void VulkanDeletionQueue::enqueue<VkCommandPool>(VkCommandPool object, uint64_t frameID);
+	template<> void VulkanDeletionQueue::enqueue<VkQueryPool>(VkQueryPool object, uint64_t frameID);
 }
\ No newline at end of file
@@ -8,6 +8,7 @@ namespace rhi::vulkan
 		m_Device = device;
 		m_DebugName = name;
 		m_Resource = resource;
+		m_ResourceID = resource->getUniqueID();
 		m_Description = desc;
 	}
 
@@ -141,6 +142,7 @@ namespace rhi::vulkan
 		m_Device = device;
 		m_DebugName = name;
 		m_Resource = resource;
+		m_ResourceID = resource->getUniqueID();
 		m_Description = desc;
 	}
 
@@ -365,4 +367,15 @@ namespace rhi::vulkan
 
 		return true;
 	}
-}
\ No newline at end of file
+
+	VulkanCachedDescriptor::VulkanCachedDescriptor(VulkanDevice* device, CachedDescriptorType type, IDescriptor* descriptor, const std::string& name) {
+		m_Device = device;
+		m_DebugName = name;
+		m_Type = type;
+		m_Descriptor = descriptor;
+	}
+
+	VulkanCachedDescriptor::~VulkanCachedDescriptor() {
+		((VulkanDevice*)m_Device)->releaseCachedDescriptor(m_Type, m_Descriptor);
+	}
+}
@@ -14,11 +14,15 @@ namespace rhi::vulkan {
 		VulkanShaderResourceViewDescriptor(VulkanDevice* device, IResource* resource, const ShaderResourceViewDescriptorDescription& desc, const std::string& name);
 		~VulkanShaderResourceViewDescriptor();
 		bool create();
+		IResource* getResource() const { return m_Resource; }
+		uint64_t getResourceID() const { return m_ResourceID; } // valid after the resource was destroyed
+		const ShaderResourceViewDescriptorDescription& getDescription() const { return m_Description; }
 		virtual void* getHandle() const override { return m_Resource->getHandle(); }
 		virtual uint32_t getDescriptorArrayIndex() const override { return m_HeapIndex; }
 
 	private:
 		IResource* m_Resource = nullptr;
+		uint64_t m_ResourceID = 0;
 		ShaderResourceViewDescriptorDescription m_Description = {};
 		VkImageView m_ImageView = VK_NULL_HANDLE;
 		uint32_t m_HeapIndex = RHI_INVALID_RESOURCE;
@@ -29,12 +33,15 @@ namespace rhi::vulkan {
 		VulkanUnorderedAccessDescriptor(VulkanDevice* device, IResource* resource, const UnorderedAccessDescriptorDescription& desc, const std::string& name);
 		~VulkanUnorderedAccessDescriptor();
 		bool create();
+		IResource* getResource() const { return m_Resource; }
+		uint64_t getResourceID() const { return m_ResourceID; } // valid after the resource was destroyed
 		const UnorderedAccessDescriptorDescription& getDescription() const { return m_Description; }
 		virtual void* getHandle() const override { return m_Resource->getHandle(); }
 		virtual uint32_t getDescriptorArrayIndex() const override { return m_HeapIndex; }
 
 	private:
 		IResource* m_Resource = nullptr;
+		uint64_t m_ResourceID = 0;
 		UnorderedAccessDescriptorDescription m_Description = {};
 		VkImageView m_ImageView = VK_NULL_HANDLE;
 		VkBufferView m_BufferView = VK_NULL_HANDLE; // For storage buffers.
@@ -65,6 +72,7 @@ namespace rhi::vulkan {
 
 		bool create();
 
+		const SamplerDescription& getDescription() const { return m_Description; }
 		void* getHandle() const override { return m_VkSampler; }
 		uint32_t getDescriptorArrayIndex() const override { return m_HeapIndex; }
 
@@ -73,4 +81,25 @@ namespace rhi::vulkan {
 		VkSampler m_VkSampler = VK_NULL_HANDLE;
 		uint32_t m_HeapIndex = RHI_INVALID_RESOURCE;
 	};
+
+	enum class CachedDescriptorType {
+		Sampler,
+		ShaderResourceView,
+		UnorderedAccess
+	};
+
+	// Handle to a descriptor shared through the device caches, deleting it releases one reference
+	class VulkanCachedDescriptor final : public IDescriptor {
+	public:
+		VulkanCachedDescriptor(VulkanDevice* device, CachedDescriptorType type, IDescriptor* descriptor, const std::string& name);
+		~VulkanCachedDescriptor();
+
+		IDescriptor* getDescriptor() const { return m_Descriptor; }
+		void* getHandle() const override { return m_Descriptor->getHandle(); }
+		uint32_t getDescriptorArrayIndex() const override { return m_Descriptor->getDescriptorArrayIndex(); }
+
+	private:
+		CachedDescriptorType m_Type;
+		IDescriptor* m_Descriptor = nullptr;
+	};
 }
\ No newline at end of file
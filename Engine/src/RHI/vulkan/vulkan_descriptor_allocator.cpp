@@ -17,8 +17,7 @@ namespace rhi::vulkan {
 
 		VmaAllocationCreateInfo allocationCreateInfo = {};
 		allocationCreateInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
-		allocationCreateInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT |
-			VMA_ALLOCATION_CREATE_MAPPED_BIT;
+		allocationCreateInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
 
 		VmaAllocationInfo allocationInfo;
 		vmaCreateBuffer(((VulkanDevice*)device)->getVmaAllocator(),
@@ -29,13 +28,18 @@ namespace rhi::vulkan {
 			&allocationInfo);
 
 		m_CpuAddress = allocationInfo.pMappedData;
+		device->trackAllocation(MemoryCategory::Descriptor, m_Allocation);
 
 		VkBufferDeviceAddressInfo info = { VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO };
 		info.buffer = m_Buffer;
 		m_GpuAddress = vkGetBufferDeviceAddress(device->getDevice(), &info);
+
+		m_StagingData.resize((size_t)descriptorSize * MAX_STAGED_DESCRIPTORS);
+		m_StagedIndices.reserve(MAX_STAGED_DESCRIPTORS);
 	}
 
 	VulkanDescriptorAllocator::~VulkanDescriptorAllocator() {
+		m_Device->untrackAllocation(MemoryCategory::Descriptor, m_Allocation);
 		vmaDestroyBuffer(m_Device->getVmaAllocator(), m_Buffer, m_Allocation);
 	}
 
@@ -53,11 +57,35 @@ namespace rhi::vulkan {
 			++m_AllocatedCount;
 		}
 
-		*descriptor = static_cast<char*>(m_CpuAddress) + m_DescriptorSize * index;
+		if (m_StagedIndices.size() == MAX_STAGED_DESCRIPTORS) {
+			flush();
+		}
+
+		*descriptor = m_StagingData.data() + (size_t)m_DescriptorSize * m_StagedIndices.size();
+		m_StagedIndices.push_back(index);
 		return index;
 	}
 
 	void VulkanDescriptorAllocator::free(uint32_t index) {
 		m_FreeDescriptors.push_back(index);
 	}
+
+	void VulkanDescriptorAllocator::flush() {
+		const size_t count = m_StagedIndices.size();
+		size_t first = 0;
+
+		for (size_t i = 1; i <= count; ++i) {
+			if (i < count && m_StagedIndices[i] == m_StagedIndices[i - 1] + 1) {
+				continue;
+			}
+
+			VkDeviceSize offset = (VkDeviceSize)m_DescriptorSize * m_StagedIndices[first];
+			VkDeviceSize size = (VkDeviceSize)m_DescriptorSize * (i - first);
+			memcpy(static_cast<char*>(m_CpuAddress) + offset, m_StagingData.data() + (size_t)m_DescriptorSize * first, size);
+			vmaFlushAllocation(m_Device->getVmaAllocator(), m_Allocation, offset, size);
+			first = i;
+		}
+
+		m_StagedIndices.clear();
+	}
 }
\ No newline at end of file
@@ -13,8 +13,11 @@ namespace rhi::vulkan
 			VkBufferUsageFlags usage);
 		~VulkanDescriptorAllocator();
 
+		// The returned pointer is CPU side staging memory, it reaches the descriptor buffer on the next flush()
 		uint32_t allocate(void** descriptor);
 		void free(uint32_t index);
+		// Copies staged descriptors into the descriptor buffer, consecutive slots are written with a single copy
+		void flush();
 		VkDeviceAddress getGpuAddress() const { return m_GpuAddress; }
 
 	private:
@@ -27,5 +30,9 @@ namespace rhi::vulkan
 		uint32_t m_DescriptorCount = 0;
 		uint32_t m_AllocatedCount = 0;
 		std::vector<uint32_t> m_FreeDescriptors;
+
+		static const uint32_t MAX_STAGED_DESCRIPTORS = 1024;
+		std::vector<char> m_StagingData;
+		std::vector<uint32_t> m_StagedIndices;
 	};
 }
\ No newline at end of file
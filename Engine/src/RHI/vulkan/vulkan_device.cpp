@@ -8,10 +8,14 @@
 #include "vulkan_shader.hpp"
 #include "vulkan_deletion_queue.hpp"
 #include "vulkan_pipeline.hpp"
+#include "vulkan_query_heap.hpp"
 #include "vulkan_command_list.hpp"
 #include "vulkan_descriptor.hpp"
 #include "vulkan_heap.hpp"
 #include <VkBootstrap.h>
+#ifdef _WIN32
+#include <windows.h>
+#endif
 namespace rhi::vulkan {
 	namespace
 	{
@@ -115,12 +119,12 @@ namespace rhi::vulkan {
 
 	VulkanConstantBufferAllocator* VulkanDevice::getConstantBufferAllocator() const
 	{
-		uint32_t index = m_FrameID % SE::SE_MAX_FRAMES_IN_FLIGHT;
-		return m_ConstantBufferAllocators[index].get();
+		return m_ConstantBufferAllocator.get();
 	}
 
 	void VulkanDevice::enqueueDefaultLayoutTransition(ITexture* texture) {
 		const TextureDescription& desc = texture->getDescription();
+		std::lock_guard<std::mutex> lock(m_SubmitMutex);
 
 		ResourceAccessFlags accessFlags = ResourceAccessFlags::None;
 
@@ -158,6 +162,7 @@ namespace rhi::vulkan {
 	}
 
 	void VulkanDevice::cancelLayoutTransition(ITexture* texture) {
+		std::lock_guard<std::mutex> lock(m_SubmitMutex);
 		auto removeTransition = [texture](std::vector<std::pair<ITexture*, ResourceAccessFlags>>& transitions) {
 			transitions.erase(std::remove_if(transitions.begin(), transitions.end(),
 				[texture](const auto& pair) { return pair.first == texture; }), transitions.end());
@@ -167,44 +172,58 @@ namespace rhi::vulkan {
 		removeTransition(m_PendingCopyTransitions);
 	}
 
-	void VulkanDevice::flushLayoutTransition(CommandType transitionType) {
-		const uint32_t frameIndex = m_FrameID % SE::SE_MAX_FRAMES_IN_FLIGHT;
-
+	VkCommandBuffer VulkanDevice::flushLayoutTransition(CommandType transitionType) {
+		std::vector<std::pair<ITexture*, ResourceAccessFlags>>* transitions = nullptr;
+		const char* name = nullptr;
 		if (transitionType == CommandType::Graphics) {
-			if (!m_PendingGraphicsTransitions.empty()) {
-				auto cmdList = m_TransitionGraphicsCommandList[frameIndex].get();
-				cmdList->begin();
-
-				// Process graphics transitions
-				for (const auto& [texture, accessFlags] : m_PendingGraphicsTransitions) {
-					cmdList->textureBarrier(texture,
-						ResourceAccessFlags::Discard, accessFlags);
-				}
-				m_PendingGraphicsTransitions.clear();
-
-				cmdList->end();
-				cmdList->submit();
-			}
+			transitions = &m_PendingGraphicsTransitions;
+			name = "Transition CommandList[Graphics]";
 		}
 		else if (transitionType == CommandType::Copy) {
-			if (!m_PendingCopyTransitions.empty()) {
-				auto cmdList = m_TransitionCopyCommandList[frameIndex].get();
-				cmdList->begin();
-
-				// Process copy transitions
-				for (const auto& [texture, accessFlags] : m_PendingCopyTransitions) {
-					cmdList->textureBarrier(texture,
-						ResourceAccessFlags::Discard, accessFlags);
-				}
-				m_PendingCopyTransitions.clear();
+			transitions = &m_PendingCopyTransitions;
+			name = "Transition CommandList[Transfer]";
+		}
 
-				cmdList->end();
-				cmdList->submit();
-			}
+		if (!transitions || transitions->empty()) {
+			return VK_NULL_HANDLE;
+		}
+
+		// Lists retire in submission order, so only the oldest one can be free
+		std::deque<TransitionCommandList>& pool = m_TransitionCommandLists[(uint32_t)transitionType];
+		TransitionCommandList entry;
+		if (!pool.empty() && m_FrameFences[(uint32_t)transitionType]->getCompletedValue() >= pool.front().retireValue) {
+			entry = std::move(pool.front());
+			pool.pop_front();
+			entry.commandList->resetAllocator();
+		}
+		else {
+			entry.commandList = SE::Scoped<ICommandList>(createCommandList(transitionType, name));
+		}
+
+		// Everything created since the last submission of this queue type ends up in a single barrier batch
+		ICommandList* cmdList = entry.commandList.get();
+		cmdList->begin();
+		for (const auto& [texture, accessFlags] : *transitions) {
+			cmdList->textureBarrier(texture, ResourceAccessFlags::Discard, accessFlags);
 		}
+		transitions->clear();
+		cmdList->end();
+
+		// The frame fence signal of endFrame follows this submission on the same queue
+		entry.retireValue = m_FrameID + 1;
+		pool.push_back(std::move(entry));
+
+		return static_cast<VkCommandBuffer>(cmdList->getHandle());
+	}
+
+	void VulkanDevice::flushDescriptorWrites() {
+		m_ResourceDescriptorAllocator->flush();
+		m_SamplerDescriptorAllocator->flush();
 	}
+
 	bool VulkanDevice::create(const DeviceDescription& desc)
 	{
+		m_Description = desc;
 		VK_CHECK(volkInitialize());
 		SE_ASSERT(createDevice(), "Device creation failed");
 		SE_ASSERT(createPipelineLayout(), "PipelineLayout creation failed");
@@ -218,16 +237,40 @@ namespace rhi::vulkan {
 		allocatorInfo.device = m_Device;
 		allocatorInfo.instance = m_Instance;
 		allocatorInfo.flags = VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT;
+		if (m_MemoryBudgetSupported)
+		{
+			allocatorInfo.flags |= VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT;
+		}
 		allocatorInfo.pVulkanFunctions = &vmaVulkanFuncs;
 		vmaCreateAllocator(&allocatorInfo, &m_Allocator);
+		createMemoryPools();
+		detectDirectUploadSupport();
+		updateMemoryBudget();
 
 		m_DeletionQueue = SE::createScoped<VulkanDeletionQueue>(this);
 
-		for (size_t i = 0; i < SE::SE_MAX_FRAMES_IN_FLIGHT; ++i)
+		m_Queues[(uint32_t)CommandType::Graphics] = SE::createScoped<VulkanQueue>(this, CommandType::Graphics, m_GraphicsQueue);
+		m_Queues[(uint32_t)CommandType::Compute] = SE::createScoped<VulkanQueue>(this, CommandType::Compute, m_ComputeQueue);
+		m_Queues[(uint32_t)CommandType::Copy] = SE::createScoped<VulkanQueue>(this, CommandType::Copy, m_CopyQueue);
+
+		if (desc.enableSubmissionThread)
+		{
+			m_SubmissionThread = SE::createScoped<VulkanSubmissionThread>();
+		}
+
+		if (m_SparseResourceSupported)
+		{
+			m_SparseBindFence = SE::Scoped<IFence>(createFence("Sparse Bind Fence"));
+			for (uint32_t i = 0; i < 3; ++i)
+			{
+				m_SparseQueueFences[i] = SE::Scoped<IFence>(createFence("Sparse Queue Fence"));
+			}
+		}
+
+		m_ConstantBufferAllocator = SE::createScoped<VulkanConstantBufferAllocator>(this, 8 * 1024 * 1024, 2 * 1024 * 1024);
+		for (uint32_t i = 0; i < 3; ++i)
 		{
-			m_TransitionCopyCommandList[i] = SE::Scoped<ICommandList>(createCommandList(CommandType::Copy, "Transition CommandList[Transfer]"));
-			m_TransitionGraphicsCommandList[i] = SE::Scoped<ICommandList>(createCommandList(CommandType::Graphics, "Transition CommandList[Graphics]"));
-			m_ConstantBufferAllocators[i] = SE::createScoped<VulkanConstantBufferAllocator>(this, 8 * 1024 * 1024);
+			m_FrameFences[i] = SE::Scoped<IFence>(createFence("Frame Fence"));
 		}
 
 		VkPhysicalDeviceProperties2 properties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
@@ -414,6 +457,8 @@ namespace rhi::vulkan {
 		VkPhysicalDeviceVulkan12Features vulkan12Features{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
 		vulkan12Features.descriptorIndexing = VK_TRUE;
 		vulkan12Features.bufferDeviceAddress = VK_TRUE;
+		vulkan12Features.drawIndirectCount = VK_TRUE;
+		vulkan12Features.hostQueryReset = VK_TRUE;
 
 		VkPhysicalDeviceVulkan13Features vulkan13Features{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES };
 		vulkan13Features.pNext = &vulkan12Features;
@@ -431,10 +476,15 @@ namespace rhi::vulkan {
 
 		VkPhysicalDeviceFeatures2 features2{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
 		features2.pNext = &descriptorBufferFeatures;
+		features2.features.multiDrawIndirect = VK_TRUE;
+		features2.features.drawIndirectFirstInstance = VK_TRUE;
+		features2.features.pipelineStatisticsQuery = VK_TRUE;
 
 		vkb::PhysicalDeviceSelector selector{ vkbInst };
 		selector.set_minimum_version(1, 3)
 			.add_required_extensions(required_extensions)
+			.set_required_features(features2.features)
+			.set_required_features_12(vulkan12Features)
 			.add_required_extension_features(descriptorBufferFeatures);
 
 		// Select the physical device
@@ -453,10 +503,26 @@ namespace rhi::vulkan {
 		//	return EXIT_FAILURE;
 		//}
 
-		//if (!vkbPhysicalDevice.enable_extension_features_if_present(meshShaderFeatures)) {
-		//	SE::LogWarn("Mesh Shader features not supported by the selected physical device");
-		//	return EXIT_FAILURE;
-		//}
+		VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{ .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT };
+		meshShaderFeatures.taskShader = VK_TRUE;
+		meshShaderFeatures.meshShader = VK_TRUE;
+		meshShaderFeatures.meshShaderQueries = VK_TRUE;
+
+		// Task and mesh invocation statistics are optional, mesh shading works without them
+		m_MeshShadingSupported = vkbPhysicalDevice.enable_extension_if_present(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+		if (m_MeshShadingSupported) {
+			m_MeshShaderQuerySupported = vkbPhysicalDevice.enable_extension_features_if_present(meshShaderFeatures);
+			if (!m_MeshShaderQuerySupported) {
+				meshShaderFeatures.meshShaderQueries = VK_FALSE;
+				m_MeshShadingSupported = vkbPhysicalDevice.enable_extension_features_if_present(meshShaderFeatures);
+			}
+		}
+		if (!m_MeshShadingSupported) {
+			SE::LogWarn("Mesh Shader features not supported by the selected physical device");
+		}
+
+		bool calibratedTimestamps = vkbPhysicalDevice.enable_extension_if_present(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+		m_MemoryBudgetSupported = vkbPhysicalDevice.enable_extension_if_present(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
 
 		//if (!vkbPhysicalDevice.enable_extension_features_if_present(mutableDescriptorFeatures)) {
 		//	std::cerr << "Mutable Descriptor Type features not supported by the selected physical device." << std::endl;
@@ -468,8 +534,33 @@ namespace rhi::vulkan {
 		//	return EXIT_FAILURE;
 		//}
 
+		VkPhysicalDeviceFeatures sparseFeatures = {};
+		sparseFeatures.sparseBinding = VK_TRUE;
+		sparseFeatures.sparseResidencyBuffer = VK_TRUE;
+		sparseFeatures.sparseResidencyImage2D = VK_TRUE;
+		bool sparseFeaturesPresent = vkbPhysicalDevice.enable_features_if_present(sparseFeatures);
+
+		// One queue per family as vk-bootstrap does by default, plus a second queue of a sparse binding family.
+		// Binds run on their own queue so they never race with the submission thread.
+		std::vector<VkQueueFamilyProperties> queueFamilies = vkbPhysicalDevice.get_queue_families();
+		std::vector<vkb::CustomQueueDescription> queueDescriptions;
+		for (uint32_t i = 0; i < (uint32_t)queueFamilies.size(); ++i)
+		{
+			bool sparseFamily = (queueFamilies[i].queueFlags & VK_QUEUE_SPARSE_BINDING_BIT) && queueFamilies[i].queueCount > 1;
+			if (sparseFeaturesPresent && sparseFamily &&
+				(m_SparseQueueIndex == uint32_t(-1) || (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)))
+			{
+				m_SparseQueueIndex = i;
+			}
+		}
+		for (uint32_t i = 0; i < (uint32_t)queueFamilies.size(); ++i)
+		{
+			queueDescriptions.emplace_back(i, std::vector<float>(i == m_SparseQueueIndex ? 2 : 1, 1.0f));
+		}
+
 		// Create the logical device
 		vkb::DeviceBuilder deviceBuilder{ vkbPhysicalDevice };
+		deviceBuilder.custom_queue_setup(queueDescriptions);
 
 		// Add pNext chain
 		//deviceBuilder.add_pNext(&features2);
@@ -494,6 +585,42 @@ namespace rhi::vulkan {
 		m_ComputeQueueIndex = vkbDevice.get_queue_index(vkb::QueueType::compute).value();
 		m_CopyQueue = vkbDevice.get_queue(vkb::QueueType::transfer).value();
 		m_CopyQueueIndex = vkbDevice.get_queue_index(vkb::QueueType::transfer).value();
+
+		if (m_SparseQueueIndex != uint32_t(-1))
+		{
+			vkGetDeviceQueue(m_Device, m_SparseQueueIndex, 1, &m_SparseQueue);
+			m_SparseResourceSupported = true;
+		}
+		else
+		{
+			SE::LogWarn("Sparse resources not supported by the selected physical device");
+		}
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(m_PhysicalDevice, &properties);
+		m_TimestampPeriod = properties.limits.timestampPeriod;
+
+		m_TimestampSupported[(uint32_t)CommandType::Graphics] = queueFamilies[m_GraphicsQueueIndex].timestampValidBits > 0;
+		m_TimestampSupported[(uint32_t)CommandType::Compute] = queueFamilies[m_ComputeQueueIndex].timestampValidBits > 0;
+		m_TimestampSupported[(uint32_t)CommandType::Copy] = queueFamilies[m_CopyQueueIndex].timestampValidBits > 0;
+
+		if (calibratedTimestamps)
+		{
+#ifdef _WIN32
+			const VkTimeDomainEXT hostDomain = VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT;
+#else
+			const VkTimeDomainEXT hostDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+#endif
+			uint32_t domainCount = 0;
+			vkGetPhysicalDeviceCalibrateableTimeDomainsEXT(m_PhysicalDevice, &domainCount, nullptr);
+			std::vector<VkTimeDomainEXT> domains(domainCount);
+			vkGetPhysicalDeviceCalibrateableTimeDomainsEXT(m_PhysicalDevice, &domainCount, domains.data());
+
+			if (std::find(domains.begin(), domains.end(), hostDomain) != domains.end())
+			{
+				m_HostTimeDomain = hostDomain;
+			}
+		}
 	}
 
 	VulkanDevice::VulkanDevice(const DeviceDescription& desc)
@@ -503,16 +630,56 @@ namespace rhi::vulkan {
 
 	VulkanDevice::~VulkanDevice()
 	{
-		for (size_t i = 0; i < SE::SE_MAX_FRAMES_IN_FLIGHT; ++i)
+		flushSubmissions();
+		m_SubmissionThread.reset();
+
+		if (m_DefragmentationContext)
 		{
-			m_TransitionCopyCommandList[i].reset();
-			m_TransitionGraphicsCommandList[i].reset();
-			m_ConstantBufferAllocators[i].reset();
+			vkDeviceWaitIdle(m_Device);
+			if (m_DefragmentationPassPending)
+			{
+				vmaEndDefragmentationPass(m_Allocator, m_DefragmentationContext, &m_DefragmentationPass);
+			}
+			endDefragmentation();
+		}
+
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			m_TransitionCommandLists[i].clear();
+		}
+		m_ConstantBufferAllocator.reset();
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			m_FrameFences[i].reset();
+		}
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			m_Queues[i].reset();
+		}
+		// Descriptors leaked by their owners still hold views and descriptor slots
+		for (auto& iter : m_DescriptorRefCounts)
+		{
+			delete iter.first;
 		}
+		m_DescriptorRefCounts.clear();
+
+		m_SparseBindFence.reset();
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			m_SparseQueueFences[i].reset();
+		}
+
 		m_DeletionQueue.reset();
 		m_ResourceDescriptorAllocator.reset();
 		m_SamplerDescriptorAllocator.reset();
 
+		for (uint32_t i = 0; i < (uint32_t)MemoryPoolType::Count; ++i)
+		{
+			if (m_MemoryPools[i])
+			{
+				vmaDestroyPool(m_Allocator, m_MemoryPools[i]);
+			}
+		}
 		vmaDestroyAllocator(m_Allocator);
 		vkDestroyDescriptorSetLayout(m_Device, m_descriptorSetLayout[0], nullptr);
 		vkDestroyDescriptorSetLayout(m_Device, m_descriptorSetLayout[1], nullptr);
@@ -565,6 +732,18 @@ namespace rhi::vulkan {
 		return pipeline;
 	}
 
+	IPipelineState* VulkanDevice::createMeshShadingPipelineState(const MeshShadingPipelineDescription& desc, const std::string& name)
+	{
+		SE_ASSERT(m_MeshShadingSupported, "Mesh shading is not supported by the device");
+		VulkanMeshShadingPipelineState* pipeline = new VulkanMeshShadingPipelineState(this, desc, name);
+		if (!pipeline->create())
+		{
+			delete pipeline;
+			return nullptr;
+		}
+		return pipeline;
+	}
+
 	IPipelineState* VulkanDevice::createComputePipelineState(const ComputePipelineDescription& desc, const std::string& name)
 	{
 		VulkanComputePipelineState* pipeline = new VulkanComputePipelineState(this, desc, name);
@@ -606,24 +785,52 @@ namespace rhi::vulkan {
 
 	IDescriptor* VulkanDevice::createShaderResourceViewDescriptor(IResource* resource, const ShaderResourceViewDescriptorDescription& desc, const std::string& name)
 	{
+		std::lock_guard<std::mutex> lock(m_DescriptorCacheMutex);
+		m_DescriptorCacheStats.viewRequests++;
+
+		ShaderResourceViewKey key = { resource->getUniqueID(), desc };
+		auto iter = m_ShaderResourceViewCache.find(key);
+		if (iter != m_ShaderResourceViewCache.end())
+		{
+			m_DescriptorCacheStats.viewHits++;
+			m_DescriptorRefCounts[iter->second]++;
+			return new VulkanCachedDescriptor(this, CachedDescriptorType::ShaderResourceView, iter->second, name);
+		}
+
 		VulkanShaderResourceViewDescriptor* resourceDescriptor = new VulkanShaderResourceViewDescriptor(this, resource, desc, name);
 		if (!resourceDescriptor->create())
 		{
 			delete resourceDescriptor;
 			return nullptr;
 		}
-		return resourceDescriptor;
+		m_ShaderResourceViewCache.insert(std::make_pair(key, resourceDescriptor));
+		m_DescriptorRefCounts[resourceDescriptor] = 1;
+		return new VulkanCachedDescriptor(this, CachedDescriptorType::ShaderResourceView, resourceDescriptor, name);
 	}
 
 	IDescriptor* VulkanDevice::createUnorderedAccessDescriptor(IResource* resource, const UnorderedAccessDescriptorDescription& desc, const std::string& name)
 	{
+		std::lock_guard<std::mutex> lock(m_DescriptorCacheMutex);
+		m_DescriptorCacheStats.viewRequests++;
+
+		UnorderedAccessViewKey key = { resource->getUniqueID(), desc };
+		auto iter = m_UnorderedAccessViewCache.find(key);
+		if (iter != m_UnorderedAccessViewCache.end())
+		{
+			m_DescriptorCacheStats.viewHits++;
+			m_DescriptorRefCounts[iter->second]++;
+			return new VulkanCachedDescriptor(this, CachedDescriptorType::UnorderedAccess, iter->second, name);
+		}
+
 		VulkanUnorderedAccessDescriptor* storageDescriptor = new VulkanUnorderedAccessDescriptor(this, resource, desc, name);
 		if (!storageDescriptor->create())
 		{
 			delete storageDescriptor;
 			return nullptr;
 		}
-		return storageDescriptor;
+		m_UnorderedAccessViewCache.insert(std::make_pair(key, storageDescriptor));
+		m_DescriptorRefCounts[storageDescriptor] = 1;
+		return new VulkanCachedDescriptor(this, CachedDescriptorType::UnorderedAccess, storageDescriptor, name);
 	}
 
 	IDescriptor* VulkanDevice::createConstantBufferDescriptor(IBuffer* buffer, const ConstantBufferDescriptorDescription& desc, const std::string& name)
@@ -639,13 +846,194 @@ namespace rhi::vulkan {
 
 	IDescriptor* VulkanDevice::createSampler(const SamplerDescription& desc, const std::string& name)
 	{
+		std::lock_guard<std::mutex> lock(m_DescriptorCacheMutex);
+		m_DescriptorCacheStats.samplerRequests++;
+
+		auto iter = m_SamplerCache.find(desc);
+		if (iter != m_SamplerCache.end())
+		{
+			m_DescriptorCacheStats.samplerHits++;
+			m_DescriptorRefCounts[iter->second]++;
+			return new VulkanCachedDescriptor(this, CachedDescriptorType::Sampler, iter->second, name);
+		}
+
 		VulkanSamplerDescriptor* samplerDescriptor = new VulkanSamplerDescriptor(this, desc, name);
 		if (!samplerDescriptor->create())
 		{
 			delete samplerDescriptor;
 			return nullptr;
 		}
-		return samplerDescriptor;
+		m_SamplerCache.insert(std::make_pair(desc, samplerDescriptor));
+		m_DescriptorRefCounts[samplerDescriptor] = 1;
+		return new VulkanCachedDescriptor(this, CachedDescriptorType::Sampler, samplerDescriptor, name);
+	}
+
+	void VulkanDevice::releaseCachedDescriptor(CachedDescriptorType type, IDescriptor* descriptor)
+	{
+		std::lock_guard<std::mutex> lock(m_DescriptorCacheMutex);
+		auto iter = m_DescriptorRefCounts.find(descriptor);
+		SE_ASSERT(iter != m_DescriptorRefCounts.end());
+		if (--iter->second > 0)
+		{
+			return;
+		}
+		m_DescriptorRefCounts.erase(iter);
+
+		switch (type)
+		{
+		case CachedDescriptorType::Sampler:
+			m_SamplerCache.erase(((VulkanSamplerDescriptor*)descriptor)->getDescription());
+			break;
+		case CachedDescriptorType::ShaderResourceView:
+		{
+			VulkanShaderResourceViewDescriptor* srv = (VulkanShaderResourceViewDescriptor*)descriptor;
+			m_ShaderResourceViewCache.erase({ srv->getResourceID(), srv->getDescription() });
+			break;
+		}
+		case CachedDescriptorType::UnorderedAccess:
+		{
+			VulkanUnorderedAccessDescriptor* uav = (VulkanUnorderedAccessDescriptor*)descriptor;
+			m_UnorderedAccessViewCache.erase({ uav->getResourceID(), uav->getDescription() });
+			break;
+		}
+		}
+		delete descriptor;
+	}
+
+	void VulkanDevice::updateTileMappings(VulkanQueue* queue, const std::vector<VulkanTileMappingUpdate>& updates)
+	{
+		SE_ASSERT(m_SparseResourceSupported, "Sparse resources are not supported by the device");
+		std::lock_guard<std::mutex> lock(m_SparseQueueMutex);
+
+		// Queue work -> bind -> queue work, the queue side is flushed first so the bind can wait for it
+		uint32_t queueType = (uint32_t)queue->getType();
+		uint64_t queueValue = ++m_SparseQueueFenceValues[queueType];
+		uint64_t bindValue = ++m_SparseBindFenceValue;
+		VkSemaphore queueSemaphore = (VkSemaphore)m_SparseQueueFences[queueType]->getHandle();
+		VkSemaphore bindSemaphore = (VkSemaphore)m_SparseBindFence->getHandle();
+
+		queue->signal(queueSemaphore, queueValue);
+		queue->flush();
+
+		// Reserved up front, the bind infos point into these arrays
+		std::vector<VkSparseImageMemoryBind> imageBinds;
+		std::vector<VkSparseMemoryBind> opaqueBinds;
+		std::vector<VkSparseImageMemoryBindInfo> imageInfos;
+		std::vector<VkSparseImageOpaqueMemoryBindInfo> imageOpaqueInfos;
+		std::vector<VkSparseBufferMemoryBindInfo> bufferInfos;
+		imageBinds.reserve(updates.size());
+		opaqueBinds.reserve(updates.size());
+		imageInfos.reserve(updates.size());
+		imageOpaqueInfos.reserve(updates.size());
+		bufferInfos.reserve(updates.size());
+
+		for (const VulkanTileMappingUpdate& update : updates)
+		{
+			const TileMapping& mapping = update.mapping;
+
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize heapOffset = 0;
+			if (mapping.type == TileMappingType::Map)
+			{
+				VmaAllocationInfo heapInfo;
+				vmaGetAllocationInfo(m_Allocator, (VmaAllocation)update.heap->getHandle(), &heapInfo);
+				memory = heapInfo.deviceMemory;
+				heapOffset = heapInfo.offset;
+			}
+
+			if (update.resource->isBuffer())
+			{
+				VulkanBuffer* buffer = (VulkanBuffer*)update.resource;
+				uint64_t tileSize = buffer->getTileSize();
+
+				VkSparseMemoryBind& bind = opaqueBinds.emplace_back();
+				bind.resourceOffset = mapping.x * tileSize;
+				bind.size = std::min(mapping.tileCount * tileSize, buffer->getSparseSize() - bind.resourceOffset);
+				bind.memory = memory;
+				bind.memoryOffset = memory ? heapOffset + mapping.heapOffset * tileSize : 0;
+
+				bufferInfos.push_back({ buffer->getVkBuffer(), 1, &bind });
+				buffer->updateTileResidency(mapping);
+				continue;
+			}
+
+			VulkanTexture* texture = (VulkanTexture*)update.resource;
+			const TextureDescription& desc = texture->getDescription();
+			const VkSparseImageMemoryRequirements& requirements = texture->getSparseRequirements();
+			TextureTiling tiling = texture->getTiling();
+			uint32_t mip = mapping.subresource % desc.mipLevels;
+			uint32_t slice = mapping.subresource / desc.mipLevels;
+
+			if (mip < tiling.standardMipCount)
+			{
+				uint32_t mipWidth = std::max(desc.width >> mip, 1u);
+				uint32_t mipHeight = std::max(desc.height >> mip, 1u);
+				uint32_t mipDepth = std::max(desc.depth >> mip, 1u);
+
+				VkSparseImageMemoryBind& bind = imageBinds.emplace_back();
+				bind.subresource = { requirements.formatProperties.aspectMask, mip, slice };
+				bind.offset = { (int32_t)(mapping.x * tiling.tileWidth), (int32_t)(mapping.y * tiling.tileHeight), (int32_t)(mapping.z * tiling.tileDepth) };
+				// Regions have to be a multiple of the tile size or end at the edge of the mip
+				bind.extent.width = std::min(mapping.width * tiling.tileWidth, mipWidth - bind.offset.x);
+				bind.extent.height = std::min(mapping.height * tiling.tileHeight, mipHeight - bind.offset.y);
+				bind.extent.depth = std::min(mapping.depth * tiling.tileDepth, mipDepth - bind.offset.z);
+				bind.memory = memory;
+				bind.memoryOffset = memory ? heapOffset + (VkDeviceSize)mapping.heapOffset * tiling.tileSize : 0;
+
+				imageInfos.push_back({ (VkImage)texture->getHandle(), 1, &bind });
+			}
+			else
+			{
+				bool singleMipTail = requirements.formatProperties.flags & VK_SPARSE_IMAGE_FORMAT_SINGLE_MIPTAIL_BIT;
+
+				VkSparseMemoryBind& bind = opaqueBinds.emplace_back();
+				bind.resourceOffset = requirements.imageMipTailOffset + (singleMipTail ? 0 : slice * requirements.imageMipTailStride) +
+					(VkDeviceSize)mapping.x * tiling.tileSize;
+				bind.size = (VkDeviceSize)mapping.tileCount * tiling.tileSize;
+				bind.memory = memory;
+				bind.memoryOffset = memory ? heapOffset + (VkDeviceSize)mapping.heapOffset * tiling.tileSize : 0;
+
+				imageOpaqueInfos.push_back({ (VkImage)texture->getHandle(), 1, &bind });
+			}
+			texture->updateTileResidency(mapping);
+		}
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo = { VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO };
+		timelineInfo.waitSemaphoreValueCount = 1;
+		timelineInfo.pWaitSemaphoreValues = &queueValue;
+		timelineInfo.signalSemaphoreValueCount = 1;
+		timelineInfo.pSignalSemaphoreValues = &bindValue;
+
+		VkBindSparseInfo bindInfo = { VK_STRUCTURE_TYPE_BIND_SPARSE_INFO };
+		bindInfo.pNext = &timelineInfo;
+		bindInfo.waitSemaphoreCount = 1;
+		bindInfo.pWaitSemaphores = &queueSemaphore;
+		bindInfo.bufferBindCount = (uint32_t)bufferInfos.size();
+		bindInfo.pBufferBinds = bufferInfos.data();
+		bindInfo.imageOpaqueBindCount = (uint32_t)imageOpaqueInfos.size();
+		bindInfo.pImageOpaqueBinds = imageOpaqueInfos.data();
+		bindInfo.imageBindCount = (uint32_t)imageInfos.size();
+		bindInfo.pImageBinds = imageInfos.data();
+		bindInfo.signalSemaphoreCount = 1;
+		bindInfo.pSignalSemaphores = &bindSemaphore;
+
+		VK_CHECK(vkQueueBindSparse(m_SparseQueue, 1, &bindInfo, VK_NULL_HANDLE));
+
+		queue->wait(bindSemaphore, bindValue);
+	}
+
+	ConstantBufferStats VulkanDevice::getConstantBufferStats() const
+	{
+		return m_ConstantBufferAllocator->getStats();
+	}
+
+	DescriptorCacheStats VulkanDevice::getDescriptorCacheStats() const
+	{
+		std::lock_guard<std::mutex> lock(m_DescriptorCacheMutex);
+		DescriptorCacheStats stats = m_DescriptorCacheStats;
+		stats.liveSamplers = (uint32_t)m_SamplerCache.size();
+		stats.liveViews = (uint32_t)(m_ShaderResourceViewCache.size() + m_UnorderedAccessViewCache.size());
+		return stats;
 	}
 
 	IHeap* VulkanDevice::createHeap(const HeapDescription& desc, const std::string& name)
@@ -659,34 +1047,92 @@ namespace rhi::vulkan {
 		return heap;
 	}
 
-	uint32_t VulkanDevice::getAllocationSize(const rhi::TextureDescription& desc)
+	IQueryHeap* VulkanDevice::createQueryHeap(const QueryHeapDescription& desc, const std::string& name)
 	{
-		auto iter = m_TextureSizeMap.find(desc);
-		if (iter != m_TextureSizeMap.end())
+		VulkanQueryHeap* heap = new VulkanQueryHeap(this, desc, name);
+		if (!heap->create())
 		{
-			return iter->second;
+			delete heap;
+			return nullptr;
 		}
+		return heap;
+	}
 
-		VkImageCreateInfo createInfo = toImageCreateInfo(desc);
-		VkImage image;
-		VkResult result = vkCreateImage(m_Device, &createInfo, nullptr, &image);
-		if (result != VK_SUCCESS)
+	bool VulkanDevice::getCalibratedTimestamp(CalibratedTimestamp& timestamp)
+	{
+		if (m_HostTimeDomain == VK_TIME_DOMAIN_DEVICE_EXT)
 		{
-			return 0;
+			return false;
 		}
 
-		VkImageMemoryRequirementsInfo2 info = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2 };
-		info.image = image;
+		VkCalibratedTimestampInfoEXT infos[2] = {};
+		infos[0] = { VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT };
+		infos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+		infos[1] = { VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT };
+		infos[1].timeDomain = m_HostTimeDomain;
+
+		uint64_t timestamps[2] = {};
+		uint64_t maxDeviation = 0;
+		VK_CHECK_RETURN(vkGetCalibratedTimestampsEXT(m_Device, 2, infos, timestamps, &maxDeviation), false, "Failed to get calibrated timestamps");
+
+		timestamp.gpuTimestamp = timestamps[0];
+		timestamp.maxDeviationNs = maxDeviation;
+#ifdef _WIN32
+		// steady_clock is QueryPerformanceCounter based, convert ticks to its nanoseconds
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		timestamp.cpuTimeNs = (uint64_t)((double)timestamps[1] * 1000000000.0 / (double)frequency.QuadPart);
+#else
+		timestamp.cpuTimeNs = timestamps[1];
+#endif
+		return true;
+	}
+
+	uint32_t VulkanDevice::getAllocationSize(const rhi::TextureDescription& desc)
+	{
+		return getMemoryRequirements(desc).size;
+	}
+
+	MemoryRequirements VulkanDevice::getMemoryRequirements(const TextureDescription& desc)
+	{
+		// Placement does not change the requirements, keep one cache entry per layout
+		TextureDescription key = desc;
+		key.heap = nullptr;
+		key.heapOffset = 0;
+
+		auto iter = m_TextureRequirementsMap.find(key);
+		if (iter != m_TextureRequirementsMap.end())
+		{
+			return iter->second;
+		}
+
+		VkImageCreateInfo createInfo = toImageCreateInfo(key);
+		VkDeviceImageMemoryRequirements info = { VK_STRUCTURE_TYPE_DEVICE_IMAGE_MEMORY_REQUIREMENTS };
+		info.pCreateInfo = &createInfo;
 
 		VkMemoryRequirements2 requirements = { VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2 };
-		vkGetImageMemoryRequirements2(m_Device, &info, &requirements);
+		vkGetDeviceImageMemoryRequirements(m_Device, &info, &requirements);
 
-		vkDestroyImage(m_Device, image, nullptr);
+		MemoryRequirements result;
+		result.size = (uint32_t)requirements.memoryRequirements.size;
+		result.alignment = (uint32_t)requirements.memoryRequirements.alignment;
+		m_TextureRequirementsMap.emplace(key, result);
+		return result;
+	}
 
-		m_TextureSizeMap.emplace(desc, requirements.memoryRequirements.size);
-		return (uint32_t)requirements.memoryRequirements.size;
+	MemoryRequirements VulkanDevice::getMemoryRequirements(const BufferDescription& desc)
+	{
+		VkBufferCreateInfo createInfo = toBufferCreateInfo(desc);
+		VkDeviceBufferMemoryRequirements info = { VK_STRUCTURE_TYPE_DEVICE_BUFFER_MEMORY_REQUIREMENTS };
+		info.pCreateInfo = &createInfo;
 
-		return 0;
+		VkMemoryRequirements2 requirements = { VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2 };
+		vkGetDeviceBufferMemoryRequirements(m_Device, &info, &requirements);
+
+		MemoryRequirements result;
+		result.size = (uint32_t)requirements.memoryRequirements.size;
+		result.alignment = (uint32_t)requirements.memoryRequirements.alignment;
+		return result;
 	}
 
 	uint32_t VulkanDevice::allocateResourceDescriptor(void** descriptor)
@@ -701,31 +1147,32 @@ namespace rhi::vulkan {
 
 	void VulkanDevice::freeResourceDescriptor(uint32_t index)
 	{
-		m_ResourceDescriptorAllocator->free(index);
+		// Frames in flight may still index the slot
+		m_DeletionQueue->freeResourceDescriptor(index, m_FrameID);
 	}
 
 	void VulkanDevice::freeSamplerDescriptor(uint32_t index)
 	{
-		m_SamplerDescriptorAllocator->free(index);
+		m_DeletionQueue->freeSamplerDescriptor(index, m_FrameID);
 	}
 
 	VkDeviceAddress VulkanDevice::allocateUniformBuffer(const void* data, size_t data_size)
 	{
 		void* cpuAddress;
 		VkDeviceAddress gpuAddress;
-		getConstantBufferAllocator()->allocate((uint32_t)data_size, &cpuAddress, &gpuAddress);
+		m_ConstantBufferAllocator->allocate((uint32_t)data_size, &cpuAddress, &gpuAddress);
 
 		memcpy(cpuAddress, data, data_size);
 
 		return gpuAddress;
 	}
 
-	VkDeviceSize VulkanDevice::allocateUniformBufferDescriptor(const uint32_t* cbv0, const VkDescriptorAddressInfoEXT& ubv1, const VkDescriptorAddressInfoEXT& ubv2)
+	VkDeviceSize VulkanDevice::allocateUniformBufferDescriptor(const uint32_t* cbv0, const VkDescriptorAddressInfoEXT& ubv1, const VkDescriptorAddressInfoEXT& ubv2, VkDeviceAddress& descriptorBufferAddress)
 	{
 		size_t descriptorBufferSize = sizeof(uint32_t) * SE_MAX_PUSH_CONSTANTS + m_DescriptorBufferProperties.robustUniformBufferDescriptorSize * 2;
 		void* cpuAddress;
 		VkDeviceAddress gpuAddress;
-		getConstantBufferAllocator()->allocate((uint32_t)descriptorBufferSize, &cpuAddress, &gpuAddress);
+		descriptorBufferAddress = m_ConstantBufferAllocator->allocate((uint32_t)descriptorBufferSize, &cpuAddress, &gpuAddress);
 
 		memcpy(cpuAddress, cbv0, sizeof(uint32_t) * SE_MAX_PUSH_CONSTANTS);
 
@@ -746,24 +1193,363 @@ namespace rhi::vulkan {
 				(char*)cpuAddress + sizeof(uint32_t) * SE_MAX_PUSH_CONSTANTS + m_DescriptorBufferProperties.robustUniformBufferDescriptorSize);
 		}
 
-		VkDeviceSize descriptorBufferOffset = gpuAddress - getConstantBufferAllocator()->getGpuAddress();
+		VkDeviceSize descriptorBufferOffset = gpuAddress - descriptorBufferAddress;
 		return descriptorBufferOffset;
 	}
 
+	void VulkanDevice::flushSubmissions()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_SubmitMutex);
+			for (uint32_t i = 0; i < 3; ++i)
+			{
+				m_Queues[i]->flush();
+			}
+		}
+
+		if (m_SubmissionThread)
+		{
+			m_SubmissionThread->waitIdle();
+		}
+	}
+
+	void VulkanDevice::waitIdle()
+	{
+		flushSubmissions();
+		vkDeviceWaitIdle(m_Device);
+	}
+
 	void VulkanDevice::beginFrame()
 	{
 		m_DeletionQueue->flush();
-		uint32_t index = m_FrameID % SE::SE_MAX_FRAMES_IN_FLIGHT;
-
-		m_TransitionCopyCommandList[index]->resetAllocator();
-		m_TransitionGraphicsCommandList[index]->resetAllocator();
 
-		m_ConstantBufferAllocators[index]->reset();
+		// Each queue signals its frame fence at endFrame, constants of a frame are free once all of them passed it
+		uint64_t completedFrame = UINT64_MAX;
+		for (uint32_t i = 0; i < 3; ++i)
+		{
+			completedFrame = std::min(completedFrame, m_FrameFences[i]->getCompletedValue());
+		}
+		m_ConstantBufferAllocator->retire(completedFrame);
 	}
 
 	void VulkanDevice::endFrame()
 	{
-		++m_FrameID;
+		m_ConstantBufferAllocator->endFrame(m_FrameID + 1);
+
+		{
+			std::lock_guard<std::mutex> lock(m_SubmitMutex);
+			for (uint32_t i = 0; i < 3; ++i)
+			{
+				m_Queues[i]->signal((VkSemaphore)m_FrameFences[i]->getHandle(), m_FrameID + 1);
+				m_Queues[i]->flush();
+				m_SubmissionStats[i] = m_Queues[i]->consumeStats();
+			}
+			++m_FrameID;
+		}
+
+		updateMemoryBudget();
+
 		vmaSetCurrentFrameIndex(m_Allocator, (uint32_t)m_FrameID);
 	}
+
+	void VulkanDevice::trackAllocation(MemoryCategory category, VmaAllocation allocation)
+	{
+		if (allocation == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		VmaAllocationInfo info;
+		vmaGetAllocationInfo(m_Allocator, allocation, &info);
+
+		uint32_t index = (uint32_t)category;
+		uint64_t allocated = m_CategoryAllocatedBytes[index].fetch_add(info.size, std::memory_order_relaxed) + info.size;
+		m_CategoryAllocationCount[index].fetch_add(1, std::memory_order_relaxed);
+
+		uint64_t peak = m_CategoryPeakBytes[index].load(std::memory_order_relaxed);
+		while (allocated > peak && !m_CategoryPeakBytes[index].compare_exchange_weak(peak, allocated, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	void VulkanDevice::untrackAllocation(MemoryCategory category, VmaAllocation allocation)
+	{
+		if (allocation == VK_NULL_HANDLE)
+		{
+			return;
+		}
+
+		VmaAllocationInfo info;
+		vmaGetAllocationInfo(m_Allocator, allocation, &info);
+
+		uint32_t index = (uint32_t)category;
+		m_CategoryAllocatedBytes[index].fetch_sub(info.size, std::memory_order_relaxed);
+		m_CategoryAllocationCount[index].fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	MemoryStats VulkanDevice::getMemoryStats() const
+	{
+		MemoryStats stats;
+		for (uint32_t i = 0; i < (uint32_t)MemoryCategory::Count; ++i)
+		{
+			stats.categories[i].allocatedBytes = m_CategoryAllocatedBytes[i].load(std::memory_order_relaxed);
+			stats.categories[i].peakBytes = m_CategoryPeakBytes[i].load(std::memory_order_relaxed);
+			stats.categories[i].allocationCount = m_CategoryAllocationCount[i].load(std::memory_order_relaxed);
+		}
+
+		for (uint32_t i = 0; i < (uint32_t)MemoryPoolType::Count; ++i)
+		{
+			if (!m_MemoryPools[i])
+			{
+				continue;
+			}
+
+			VmaDetailedStatistics poolStats;
+			vmaCalculatePoolStatistics(m_Allocator, m_MemoryPools[i], &poolStats);
+
+			MemoryPoolStats& pool = stats.pools[i];
+			pool.allocationCount = poolStats.statistics.allocationCount;
+			pool.blockCount = poolStats.statistics.blockCount;
+			pool.allocatedBytes = poolStats.statistics.allocationBytes;
+			pool.blockBytes = poolStats.statistics.blockBytes;
+
+			uint64_t freeBytes = pool.blockBytes - pool.allocatedBytes;
+			pool.fragmentation = freeBytes > 0 ? 1.0f - (float)((double)poolStats.unusedRangeSizeMax / (double)freeBytes) : 0.0f;
+		}
+
+		stats.heapCount = m_HeapCount;
+		for (uint32_t i = 0; i < m_HeapCount; ++i)
+		{
+			stats.heaps[i] = m_HeapStats[i];
+		}
+		return stats;
+	}
+
+	void VulkanDevice::setMemoryBudgetCallback(float threshold, MemoryBudgetCallback callback)
+	{
+		m_BudgetThreshold = threshold;
+		m_BudgetCallback = std::move(callback);
+		for (uint32_t i = 0; i < SE_MAX_MEMORY_HEAPS; ++i)
+		{
+			m_HeapAboveThreshold[i] = false;
+		}
+	}
+
+	void VulkanDevice::updateMemoryBudget()
+	{
+		// Without VK_EXT_memory_budget VMA estimates usage from its own allocations and the budget from the heap size
+		VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+		vmaGetHeapBudgets(m_Allocator, budgets);
+
+		const VkPhysicalDeviceMemoryProperties* memoryProperties = nullptr;
+		vmaGetMemoryProperties(m_Allocator, &memoryProperties);
+
+		m_HeapCount = std::min(memoryProperties->memoryHeapCount, SE_MAX_MEMORY_HEAPS);
+		for (uint32_t i = 0; i < m_HeapCount; ++i)
+		{
+			MemoryHeapStats& heap = m_HeapStats[i];
+			heap.sizeBytes = memoryProperties->memoryHeaps[i].size;
+			heap.deviceLocal = (memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+			heap.usageBytes = budgets[i].usage;
+			heap.budgetBytes = budgets[i].budget;
+			heap.peakUsageBytes = std::max(heap.peakUsageBytes, heap.usageBytes);
+
+			bool aboveThreshold = heap.budgetBytes > 0 && (double)heap.usageBytes > (double)heap.budgetBytes * m_BudgetThreshold;
+			if (aboveThreshold && !m_HeapAboveThreshold[i] && m_BudgetCallback)
+			{
+				m_BudgetCallback(i, heap);
+			}
+			m_HeapAboveThreshold[i] = aboveThreshold;
+		}
+	}
+
+	void VulkanDevice::createMemoryPools()
+	{
+		for (uint32_t i = 0; i < (uint32_t)MemoryPoolType::Count; ++i)
+		{
+			if (m_Description.memoryPoolBlockSize[i] == 0)
+			{
+				continue;
+			}
+
+			// Pick the memory type from a representative resource of the pool
+			VmaAllocationCreateInfo allocationInfo = {};
+			uint32_t memoryTypeIndex = 0;
+			VkResult result = VK_ERROR_FEATURE_NOT_PRESENT;
+			switch ((MemoryPoolType)i)
+			{
+			case MemoryPoolType::RenderTarget:
+			case MemoryPoolType::StreamingTexture:
+			{
+				TextureDescription desc;
+				desc.format = Format::R8G8B8A8_UNORM;
+				desc.usage = (MemoryPoolType)i == MemoryPoolType::RenderTarget ? TextureUsageFlags::RenderTarget : TextureUsageFlags::None;
+				VkImageCreateInfo createInfo = toImageCreateInfo(desc);
+				allocationInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+				result = vmaFindMemoryTypeIndexForImageInfo(m_Allocator, &createInfo, &allocationInfo, &memoryTypeIndex);
+				break;
+			}
+			case MemoryPoolType::StaticGeometry:
+			case MemoryPoolType::Upload:
+			{
+				BufferDescription desc;
+				desc.size = 64 * 1024;
+				desc.usage = BufferUsageFlags::StructuredBuffer;
+				VkBufferCreateInfo createInfo = toBufferCreateInfo(desc);
+				allocationInfo.usage = (MemoryPoolType)i == MemoryPoolType::Upload ? VMA_MEMORY_USAGE_CPU_ONLY : VMA_MEMORY_USAGE_GPU_ONLY;
+				result = vmaFindMemoryTypeIndexForBufferInfo(m_Allocator, &createInfo, &allocationInfo, &memoryTypeIndex);
+				break;
+			}
+			default:
+				break;
+			}
+
+			if (result != VK_SUCCESS)
+			{
+				continue;
+			}
+
+			VmaPoolCreateInfo poolInfo = {};
+			poolInfo.memoryTypeIndex = memoryTypeIndex;
+			poolInfo.blockSize = m_Description.memoryPoolBlockSize[i];
+			VK_CHECK(vmaCreatePool(m_Allocator, &poolInfo, &m_MemoryPools[i]));
+		}
+	}
+
+	VmaPool VulkanDevice::getMemoryPool(const TextureDescription& desc) const
+	{
+		if (desc.memoryType != MemoryType::GpuOnly)
+		{
+			return VK_NULL_HANDLE;
+		}
+
+		if (anySet(desc.usage, TextureUsageFlags::RenderTarget | TextureUsageFlags::DepthStencil | TextureUsageFlags::ShaderStorage))
+		{
+			return m_MemoryPools[(uint32_t)MemoryPoolType::RenderTarget];
+		}
+		return m_MemoryPools[(uint32_t)MemoryPoolType::StreamingTexture];
+	}
+
+	VmaPool VulkanDevice::getMemoryPool(const BufferDescription& desc) const
+	{
+		switch (desc.memoryType)
+		{
+		case MemoryType::GpuOnly:
+			return m_MemoryPools[(uint32_t)MemoryPoolType::StaticGeometry];
+		case MemoryType::CpuOnly:
+			return m_MemoryPools[(uint32_t)MemoryPoolType::Upload];
+		default:
+			return VK_NULL_HANDLE;
+		}
+	}
+
+	bool VulkanDevice::defragmentMemory()
+	{
+		// Device local pools are referenced by device addresses and descriptors that are not tracked, they never move
+		VmaPool pool = m_MemoryPools[(uint32_t)MemoryPoolType::Upload];
+		if (!pool)
+		{
+			return false;
+		}
+
+		if (!m_DefragmentationContext)
+		{
+			VmaDefragmentationInfo info = {};
+			info.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_FULL_BIT;
+			info.pool = pool;
+			if (vmaBeginDefragmentation(m_Allocator, &info, &m_DefragmentationContext) != VK_SUCCESS)
+			{
+				m_DefragmentationContext = VK_NULL_HANDLE;
+				return false;
+			}
+		}
+
+		if (m_DefragmentationPassPending)
+		{
+			// Ending the pass frees the old memory, every queue has to be done with the frame it was moved in.
+			// Past the frames in flight this only waits for work the renderer already throttles on
+			uint64_t retireValue = m_DefragmentationPassFrame + 1;
+			for (uint32_t i = 0; i < 3; ++i)
+			{
+				if (m_FrameFences[i]->getCompletedValue() >= retireValue)
+				{
+					continue;
+				}
+				if (m_FrameID < m_DefragmentationPassFrame + SE::SE_MAX_FRAMES_IN_FLIGHT)
+				{
+					return true;
+				}
+				m_FrameFences[i]->wait(retireValue);
+			}
+
+			m_DefragmentationPassPending = false;
+			if (vmaEndDefragmentationPass(m_Allocator, m_DefragmentationContext, &m_DefragmentationPass) == VK_SUCCESS)
+			{
+				endDefragmentation();
+				return false;
+			}
+		}
+
+		m_DefragmentationPass = {};
+		if (vmaBeginDefragmentationPass(m_Allocator, m_DefragmentationContext, &m_DefragmentationPass) == VK_SUCCESS)
+		{
+			endDefragmentation();
+			return false;
+		}
+
+		for (uint32_t i = 0; i < m_DefragmentationPass.moveCount; ++i)
+		{
+			VmaDefragmentationMove& move = m_DefragmentationPass.pMoves[i];
+			VmaAllocationInfo allocationInfo;
+			vmaGetAllocationInfo(m_Allocator, move.srcAllocation, &allocationInfo);
+
+			// Buffers register themselves as user data and clear it when destroyed
+			VulkanBuffer* buffer = (VulkanBuffer*)allocationInfo.pUserData;
+			if (!buffer || !buffer->beginRelocation(move.dstTmpAllocation))
+			{
+				move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+			}
+		}
+
+		m_DefragmentationPassPending = true;
+		m_DefragmentationPassFrame = m_FrameID;
+		return true;
+	}
+
+	void VulkanDevice::endDefragmentation()
+	{
+		VmaDefragmentationStats stats = {};
+		vmaEndDefragmentation(m_Allocator, m_DefragmentationContext, &stats);
+		m_DefragmentationContext = VK_NULL_HANDLE;
+		m_DefragmentationPass = {};
+		m_LastDefragmentedBytes = stats.bytesMoved;
+	}
+
+	void VulkanDevice::detectDirectUploadSupport()
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(m_PhysicalDevice, &properties);
+		bool unifiedMemory = properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU ||
+			properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU;
+
+		const VkPhysicalDeviceMemoryProperties* memoryProperties = nullptr;
+		vmaGetMemoryProperties(m_Allocator, &memoryProperties);
+
+		// Without resizable BAR only a 256MB window of VRAM is host visible, keep that for the driver
+		const VkMemoryPropertyFlags requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		for (uint32_t i = 0; i < memoryProperties->memoryTypeCount; ++i)
+		{
+			const VkMemoryType& type = memoryProperties->memoryTypes[i];
+			if ((type.propertyFlags & requiredFlags) != requiredFlags)
+			{
+				continue;
+			}
+
+			if (unifiedMemory || memoryProperties->memoryHeaps[type.heapIndex].size > 256ull * 1024 * 1024)
+			{
+				m_DirectUploadSupported = true;
+				return;
+			}
+		}
+	}
 }
\ No newline at end of file
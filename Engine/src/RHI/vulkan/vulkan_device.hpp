@@ -7,7 +7,11 @@
 #include"vulkan_deletion_queue.hpp"
 #include"vulkan_descriptor_allocator.hpp"
 #include"vulkan_constant_buffer_allocator.hpp"
+#include"vulkan_queue.hpp"
+#include"vulkan_submission_thread.hpp"
+#include"vulkan_descriptor.hpp"
 #include <cstdint>
+#include <deque>
 #include <span>
 #include <string>
 #include <utility>
@@ -15,8 +19,39 @@
 #include <vk_mem_alloc.h>
 #include <vulkan\vulkan_core.h>
 #include <unordered_map>
+#include <atomic>
+#include <mutex>
 #include"xxHash/xxhash.h"
 
+namespace rhi::vulkan
+{
+	struct ShaderResourceViewKey
+	{
+		uint64_t resourceID = 0; // a recycled resource address must not hit the views of its previous owner
+		ShaderResourceViewDescriptorDescription description;
+	};
+
+	inline bool operator==(const ShaderResourceViewKey& lhs, const ShaderResourceViewKey& rhs)
+	{
+		return lhs.resourceID == rhs.resourceID &&
+			lhs.description.format == rhs.description.format &&
+			lhs.description == rhs.description;
+	}
+
+	struct UnorderedAccessViewKey
+	{
+		uint64_t resourceID = 0;
+		UnorderedAccessDescriptorDescription description;
+	};
+
+	inline bool operator==(const UnorderedAccessViewKey& lhs, const UnorderedAccessViewKey& rhs)
+	{
+		return lhs.resourceID == rhs.resourceID &&
+			lhs.description.format == rhs.description.format &&
+			lhs.description == rhs.description;
+	}
+}
+
 namespace std
 {
 	template <>
@@ -27,10 +62,40 @@ namespace std
 			return XXH3_64bits(&desc, sizeof(desc));
 		}
 	};
+
+	template <>
+	struct std::hash<rhi::SamplerDescription>
+	{
+		size_t operator()(const rhi::SamplerDescription& desc) const
+		{
+			return XXH3_64bits(&desc, sizeof(desc));
+		}
+	};
+
+	// Descriptions hold no padding, the key itself does so it is hashed per member
+	template <>
+	struct std::hash<rhi::vulkan::ShaderResourceViewKey>
+	{
+		size_t operator()(const rhi::vulkan::ShaderResourceViewKey& key) const
+		{
+			return XXH3_64bits_withSeed(&key.description, sizeof(key.description), (XXH64_hash_t)key.resourceID);
+		}
+	};
+
+	template <>
+	struct std::hash<rhi::vulkan::UnorderedAccessViewKey>
+	{
+		size_t operator()(const rhi::vulkan::UnorderedAccessViewKey& key) const
+		{
+			return XXH3_64bits_withSeed(&key.description, sizeof(key.description), (XXH64_hash_t)key.resourceID);
+		}
+	};
 }
 
 namespace rhi::vulkan
 {
+	struct VulkanTileMappingUpdate;
+
 	class VulkanDevice final : public IDevice {
 	public:
 		VulkanDevice(const DeviceDescription& desc);
@@ -49,22 +114,49 @@ namespace rhi::vulkan
 		virtual IShader* createShader(const ShaderDescription& desc, std::span<std::byte> data, const std::string& name) override;
 		virtual IPipelineState* createGraphicsPipelineState(const GraphicsPipelineDescription& desc, const std::string& name) override;
 		virtual IPipelineState* createComputePipelineState(const ComputePipelineDescription& desc, const std::string& name) override;
+		virtual IPipelineState* createMeshShadingPipelineState(const MeshShadingPipelineDescription& desc, const std::string& name) override;
 		virtual IDescriptor* createShaderResourceViewDescriptor(IResource* resource, const ShaderResourceViewDescriptorDescription& desc, const std::string& name) override;
 		virtual IDescriptor* createUnorderedAccessDescriptor(IResource* resource, const UnorderedAccessDescriptorDescription& desc, const std::string& name) override;
 		virtual IDescriptor* createConstantBufferDescriptor(IBuffer* buffer, const ConstantBufferDescriptorDescription& desc, const std::string& name) override;
 		virtual IDescriptor* createSampler(const SamplerDescription& desc, const std::string& name) override;
 		virtual IHeap* createHeap(const HeapDescription& desc, const std::string& name) override;
+		virtual IQueryHeap* createQueryHeap(const QueryHeapDescription& desc, const std::string& name) override;
 
 		virtual uint32_t getAllocationSize(const rhi::TextureDescription& desc) override;
+		virtual MemoryRequirements getMemoryRequirements(const TextureDescription& desc) override;
+		virtual MemoryRequirements getMemoryRequirements(const BufferDescription& desc) override;
+		virtual uint64_t getTimestampFrequency() const override { return (uint64_t)(1000000000.0 / m_TimestampPeriod); }
+		virtual bool isTimestampSupported(CommandType type) const override { return m_TimestampSupported[(uint32_t)type]; }
+		virtual bool getCalibratedTimestamp(CalibratedTimestamp& timestamp) override;
+		virtual QueueSubmissionStats getSubmissionStats(CommandType type) const override { return m_SubmissionStats[(uint32_t)type]; }
+		virtual MemoryStats getMemoryStats() const override;
+		virtual void setMemoryBudgetCallback(float threshold, MemoryBudgetCallback callback) override;
+		virtual bool defragmentMemory() override;
+		virtual uint64_t getLastDefragmentedBytes() const override { return m_LastDefragmentedBytes; }
+		virtual DescriptorCacheStats getDescriptorCacheStats() const override;
+		virtual ConstantBufferStats getConstantBufferStats() const override;
+
+		// Custom VMA pool for a resource, null when it should use the default pools
+		VmaPool getMemoryPool(const TextureDescription& desc) const;
+		VmaPool getMemoryPool(const BufferDescription& desc) const;
+
+		// Memory accounting of VMA allocations owned by RHI objects
+		void trackAllocation(MemoryCategory category, VmaAllocation allocation);
+		void untrackAllocation(MemoryCategory category, VmaAllocation allocation);
 
 		//Descriptors
 		uint32_t allocateResourceDescriptor(void** descriptor);
 		uint32_t allocateSamplerDescriptor(void** descriptor);
 		void freeResourceDescriptor(uint32_t index);
 		void freeSamplerDescriptor(uint32_t index);
+		// Binds tile memory on the sparse queue, ordered after the work already recorded on the queue
+		void updateTileMappings(VulkanQueue* queue, const std::vector<VulkanTileMappingUpdate>& updates);
+		// Drops a reference taken by a cached sampler or view, the shared descriptor is deleted with the last one
+		void releaseCachedDescriptor(CachedDescriptorType type, IDescriptor* descriptor);
 
 		VkDeviceAddress allocateUniformBuffer(const void* data, size_t data_size);
-		VkDeviceSize allocateUniformBufferDescriptor(const uint32_t* cbv0, const VkDescriptorAddressInfoEXT& ubv1, const VkDescriptorAddressInfoEXT& ubv2);
+		// descriptorBufferAddress receives the constant buffer block the returned offset is relative to
+		VkDeviceSize allocateUniformBufferDescriptor(const uint32_t* cbv0, const VkDescriptorAddressInfoEXT& ubv1, const VkDescriptorAddressInfoEXT& ubv2, VkDeviceAddress& descriptorBufferAddress);
 
 		//Deletion
 		template<typename T>
@@ -80,6 +172,13 @@ namespace rhi::vulkan
 		VkQueue getGraphicsQueue() const { return m_GraphicsQueue; }
 		VkQueue getComputeQueue() const { return m_ComputeQueue; }
 		VkQueue getCopyQueue() const { return m_CopyQueue; }
+		VulkanQueue* getQueue(CommandType type) const { return m_Queues[(uint32_t)type].get(); }
+		VulkanSubmissionThread* getSubmissionThread() const { return m_SubmissionThread.get(); }
+		bool isMeshShaderQuerySupported() const { return m_MeshShaderQuerySupported; }
+
+		// Flushes all queue batches and waits until the submission thread handed them to the driver
+		void flushSubmissions();
+		void waitIdle();
 		VkPipelineLayout getPipelineLayout() const { return m_PipelineLayout; }
 		VmaAllocator getVmaAllocator() const { return m_Allocator; }
 
@@ -90,12 +189,21 @@ namespace rhi::vulkan
 
 		void enqueueDefaultLayoutTransition(ITexture* texture);
 		void cancelLayoutTransition(ITexture* texture);
-		void flushLayoutTransition(CommandType type);
+		// Records the pending transitions of a queue type, the returned command buffer goes in front of the caller's own.
+		// Called with the submit mutex held
+		VkCommandBuffer flushLayoutTransition(CommandType type);
+		void flushDescriptorWrites();
+		// Serializes queue access, command lists may be submitted from other threads than the frame loop
+		std::mutex& getSubmitMutex() { return m_SubmitMutex; }
 	private:
 		VulkanDevice() = default;
 		bool create(const DeviceDescription& desc);
 		bool createPipelineLayout();
 		bool createDevice();
+		void updateMemoryBudget();
+		void createMemoryPools();
+		void detectDirectUploadSupport();
+		void endDefragmentation();
 	private:
 		// Core Vulkan objects
 		VkInstance m_Instance = VK_NULL_HANDLE;
@@ -103,11 +211,18 @@ namespace rhi::vulkan
 		VkDevice m_Device = VK_NULL_HANDLE;
 		VkDebugUtilsMessengerEXT m_DebugMessenger = VK_NULL_HANDLE;
 		VmaAllocator m_Allocator = VK_NULL_HANDLE;
+		VmaPool m_MemoryPools[(uint32_t)MemoryPoolType::Count] = {};
 		VkDescriptorSetLayout m_descriptorSetLayout[3] = {};
 		VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
 		VkPhysicalDeviceDescriptorBufferPropertiesEXT m_DescriptorBufferProperties = { VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT };
+		bool m_MemoryBudgetSupported = false;
+		bool m_MeshShaderQuerySupported = false;
+		float m_TimestampPeriod = 1.0f; // nanoseconds per tick
+		bool m_TimestampSupported[3] = {};
+		VkTimeDomainEXT m_HostTimeDomain = VK_TIME_DOMAIN_DEVICE_EXT; // device domain means no calibration support
 
-		SE::Scoped<VulkanConstantBufferAllocator> m_ConstantBufferAllocators[SE::SE_MAX_FRAMES_IN_FLIGHT]{};
+		SE::Scoped<VulkanConstantBufferAllocator> m_ConstantBufferAllocator = nullptr;
+		SE::Scoped<IFence> m_FrameFences[3] = {};
 		SE::Scoped<VulkanDescriptorAllocator> m_ResourceDescriptorAllocator = nullptr;
 		SE::Scoped<VulkanDescriptorAllocator>m_SamplerDescriptorAllocator = nullptr;
 
@@ -118,14 +233,56 @@ namespace rhi::vulkan
 		VkQueue m_GraphicsQueue = VK_NULL_HANDLE;
 		VkQueue m_ComputeQueue = VK_NULL_HANDLE;
 		VkQueue m_CopyQueue = VK_NULL_HANDLE;
+		SE::Scoped<VulkanQueue> m_Queues[3] = {};
+
+		// Sparse binding
+		uint32_t m_SparseQueueIndex = uint32_t(-1);
+		VkQueue m_SparseQueue = VK_NULL_HANDLE;
+		std::mutex m_SparseQueueMutex;
+		std::mutex m_SubmitMutex;
+		SE::Scoped<IFence> m_SparseBindFence = nullptr;
+		uint64_t m_SparseBindFenceValue = 0;
+		SE::Scoped<IFence> m_SparseQueueFences[3] = {};
+		uint64_t m_SparseQueueFenceValues[3] = {};
+
+		// Memory accounting
+		std::atomic<uint64_t> m_CategoryAllocatedBytes[(uint32_t)MemoryCategory::Count] = {};
+		std::atomic<uint64_t> m_CategoryPeakBytes[(uint32_t)MemoryCategory::Count] = {};
+		std::atomic<uint32_t> m_CategoryAllocationCount[(uint32_t)MemoryCategory::Count] = {};
+		MemoryHeapStats m_HeapStats[SE_MAX_MEMORY_HEAPS] = {};
+		uint32_t m_HeapCount = 0;
+		bool m_HeapAboveThreshold[SE_MAX_MEMORY_HEAPS] = {};
+		float m_BudgetThreshold = 0.9f;
+		MemoryBudgetCallback m_BudgetCallback;
+		// Incremental defragmentation of the upload pool, one pass in flight at a time
+		VmaDefragmentationContext m_DefragmentationContext = VK_NULL_HANDLE;
+		VmaDefragmentationPassMoveInfo m_DefragmentationPass = {};
+		bool m_DefragmentationPassPending = false;
+		uint64_t m_DefragmentationPassFrame = 0;
+		uint64_t m_LastDefragmentedBytes = 0;
+		QueueSubmissionStats m_SubmissionStats[3] = {};
+		SE::Scoped<VulkanSubmissionThread> m_SubmissionThread = nullptr;
 
 		SE::Scoped<VulkanDeletionQueue> m_DeletionQueue = nullptr;
-		SE::Scoped<ICommandList> m_TransitionCopyCommandList[SE::SE_MAX_FRAMES_IN_FLIGHT] = {};
-		SE::Scoped<ICommandList> m_TransitionGraphicsCommandList[SE::SE_MAX_FRAMES_IN_FLIGHT] = {};
+		// Each flush records into its own list, reused once the queue's frame fence passed retireValue
+		struct TransitionCommandList
+		{
+			SE::Scoped<ICommandList> commandList;
+			uint64_t retireValue = 0;
+		};
+		std::deque<TransitionCommandList> m_TransitionCommandLists[3];
 		std::vector<std::pair<ITexture*, ResourceAccessFlags>> m_PendingGraphicsTransitions;
 		std::vector<std::pair<ITexture*, ResourceAccessFlags>> m_PendingCopyTransitions;
 
-		std::unordered_map<TextureDescription, uint32_t> m_TextureSizeMap;
+		std::unordered_map<TextureDescription, MemoryRequirements> m_TextureRequirementsMap;
+
+		// Sampler and view deduplication
+		mutable std::mutex m_DescriptorCacheMutex;
+		std::unordered_map<SamplerDescription, IDescriptor*> m_SamplerCache;
+		std::unordered_map<ShaderResourceViewKey, IDescriptor*> m_ShaderResourceViewCache;
+		std::unordered_map<UnorderedAccessViewKey, IDescriptor*> m_UnorderedAccessViewCache;
+		std::unordered_map<IDescriptor*, uint32_t> m_DescriptorRefCounts;
+		DescriptorCacheStats m_DescriptorCacheStats;
 	};
 	template<typename T>
 	void VulkanDevice::enqueueDeletion(T objectHandle)
@@ -55,4 +55,11 @@ namespace rhi::vulkan
 
 		vkSignalSemaphore((VkDevice)m_Device->getHandle(), &info);
 	}
-}
\ No newline at end of file
+
+	uint64_t VulkanFence::getCompletedValue() const
+	{
+		uint64_t value = 0;
+		vkGetSemaphoreCounterValue((VkDevice)m_Device->getHandle(), m_Semaphore, &value);
+		return value;
+	}
+}
@@ -16,6 +16,7 @@ namespace rhi::vulkan
 		virtual void* getHandle() const override { return m_Semaphore; }
 		virtual void wait(uint64_t value) override;
 		virtual void signal(uint64_t value) override;
+		virtual uint64_t getCompletedValue() const override;
 
 	private:
 		VkSemaphore m_Semaphore = VK_NULL_HANDLE;
@@ -11,6 +11,13 @@ namespace rhi::vulkan
 	}
 	VulkanHeap::~VulkanHeap()
 	{
+		if (m_VirtualBlock)
+		{
+			vmaClearVirtualBlock(m_VirtualBlock);
+			vmaDestroyVirtualBlock(m_VirtualBlock);
+		}
+
+		((VulkanDevice*)m_Device)->untrackAllocation(MemoryCategory::RenderGraphHeap, m_Allocation);
 		((VulkanDevice*)m_Device)->enqueueDeletion(m_Allocation);
 	}
 	bool VulkanHeap::create()
@@ -23,37 +30,61 @@ namespace rhi::vulkan
 		requirements.size = m_Description.size;
 		requirements.alignment = 1;
 
-		switch (m_Description.memoryType)
-		{
-		case rhi::MemoryType::GpuOnly:
-			requirements.memoryTypeBits = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-			break;
-		case rhi::MemoryType::CpuOnly:
-			requirements.memoryTypeBits = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
-			break;
-		case rhi::MemoryType::CpuToGpu:
-			requirements.memoryTypeBits = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
-			break;
-		case rhi::MemoryType::GpuToCpu:
-			requirements.memoryTypeBits = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
-			break;
-		default:
-			break;
-		}
+		// memoryTypeBits is a mask of memory type indices, the VMA usage picks the type
+		requirements.memoryTypeBits = UINT32_MAX;
 
 		VmaAllocationCreateInfo createInfo = {};
 		createInfo.usage = translateMemoryTypeToVMA(m_Description.memoryType);
 		createInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
 
-		VkResult result = vmaAllocateMemory(allocator, &requirements, &createInfo, &m_Allocation, nullptr);
+		VmaAllocationInfo allocationInfo = {};
+		VkResult result = vmaAllocateMemory(allocator, &requirements, &createInfo, &m_Allocation, &allocationInfo);
 		if (result != VK_SUCCESS)
 		{
 			SE_ASSERT(false, "[VulkanHeap] failed to create {}", m_DebugName);
 			return false;
 		}
+		m_MemoryTypeIndex = allocationInfo.memoryType;
 
 		vmaSetAllocationName(allocator, m_Allocation, m_DebugName.c_str());
+		((VulkanDevice*)m_Device)->trackAllocation(MemoryCategory::RenderGraphHeap, m_Allocation);
+
+		VmaVirtualBlockCreateInfo blockInfo = {};
+		blockInfo.size = m_Description.size;
+		VK_CHECK_RETURN(vmaCreateVirtualBlock(&blockInfo, &m_VirtualBlock), false, "[VulkanHeap] failed to create virtual block {}", m_DebugName);
 
 		return true;
 	}
+
+	bool VulkanHeap::allocate(uint32_t size, uint32_t alignment, HeapAllocation& allocation)
+	{
+		VmaVirtualAllocationCreateInfo createInfo = {};
+		createInfo.size = size;
+		createInfo.alignment = alignment;
+
+		VmaVirtualAllocation virtualAllocation = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		if (vmaVirtualAllocate(m_VirtualBlock, &createInfo, &virtualAllocation, &offset) != VK_SUCCESS)
+		{
+			return false;
+		}
+
+		allocation.offset = (uint32_t)offset;
+		allocation.size = size;
+		allocation.handle = (uint64_t)virtualAllocation;
+		m_UsedSize += size;
+		return true;
+	}
+
+	void VulkanHeap::free(HeapAllocation& allocation)
+	{
+		if (!allocation.isValid())
+		{
+			return;
+		}
+
+		vmaVirtualFree(m_VirtualBlock, (VmaVirtualAllocation)allocation.handle);
+		m_UsedSize -= allocation.size;
+		allocation = {};
+	}
 }
\ No newline at end of file
@@ -15,7 +15,16 @@ namespace rhi::vulkan
 
 		virtual void* getHandle() const override { return m_Allocation; }
 
+		virtual bool allocate(uint32_t size, uint32_t alignment, HeapAllocation& allocation) override;
+		virtual void free(HeapAllocation& allocation) override;
+		virtual uint32_t getUsedSize() const override { return m_UsedSize; }
+		// Checked against the memoryTypeBits of sparse resources mapped to the heap
+		uint32_t getMemoryTypeIndex() const { return m_MemoryTypeIndex; }
+
 	private:
 		VmaAllocation m_Allocation = VK_NULL_HANDLE;
+		VmaVirtualBlock m_VirtualBlock = VK_NULL_HANDLE;
+		uint32_t m_UsedSize = 0;
+		uint32_t m_MemoryTypeIndex = 0;
 	};
 }
\ No newline at end of file
@@ -90,6 +90,95 @@ namespace rhi::vulkan {
 		return true;
 	}
 
+	VulkanMeshShadingPipelineState::VulkanMeshShadingPipelineState(VulkanDevice* device, const MeshShadingPipelineDescription& desc, const std::string& name) {
+		m_Device = device;
+		m_DebugName = name;
+		m_Description = desc;
+		m_Type = PipelineType::Mesh;
+	}
+
+	VulkanMeshShadingPipelineState::~VulkanMeshShadingPipelineState() {
+		((VulkanDevice*)(m_Device))->enqueueDeletion(m_Pipeline);
+	}
+
+	bool VulkanMeshShadingPipelineState::create() {
+		if (m_Pipeline)
+			((VulkanDevice*)(m_Device))->enqueueDeletion(m_Pipeline);
+
+		VkPipelineShaderStageCreateInfo stages[3];
+		uint32_t stageCount = 0;
+
+		if (m_Description.amplificationShader) {
+			stages[stageCount] = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
+			stages[stageCount].stage = VK_SHADER_STAGE_TASK_BIT_EXT;
+			stages[stageCount].module = static_cast<VkShaderModule>(m_Description.amplificationShader->getHandle());
+			stages[stageCount].pName = m_Description.amplificationShader->getDescription().entryPoint.c_str();
+			++stageCount;
+		}
+
+		stages[stageCount] = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
+		stages[stageCount].stage = VK_SHADER_STAGE_MESH_BIT_EXT;
+		stages[stageCount].module = static_cast<VkShaderModule>(m_Description.meshShader->getHandle());
+		stages[stageCount].pName = m_Description.meshShader->getDescription().entryPoint.c_str();
+		++stageCount;
+
+		if (m_Description.pixelShader) {
+			stages[stageCount] = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO };
+			stages[stageCount].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+			stages[stageCount].module = static_cast<VkShaderModule>(m_Description.pixelShader->getHandle());
+			stages[stageCount].pName = m_Description.pixelShader->getDescription().entryPoint.c_str();
+			++stageCount;
+		}
+
+		VkPipelineMultisampleStateCreateInfo multisampleState{ VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO };
+		multisampleState.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+		constexpr VkDynamicState dynamicStates[] = {
+			VK_DYNAMIC_STATE_VIEWPORT,
+			VK_DYNAMIC_STATE_SCISSOR,
+			VK_DYNAMIC_STATE_BLEND_CONSTANTS,
+			VK_DYNAMIC_STATE_STENCIL_REFERENCE,
+		};
+
+		VkPipelineDynamicStateCreateInfo dynamicStateInfo{ VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO };
+		dynamicStateInfo.dynamicStateCount = std::size(dynamicStates);
+		dynamicStateInfo.pDynamicStates = dynamicStates;
+
+		VkPipelineViewportStateCreateInfo viewportInfo{ VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO };
+		viewportInfo.viewportCount = 1;
+		viewportInfo.scissorCount = 1;
+
+		auto rasterState = toVkPipelineRasterizationStateCreateInfo(m_Description.rasterizer);
+		auto depthStencilState = toVkPipelineDepthStencilStateCreateInfo(m_Description.depthStencil);
+
+		VkPipelineColorBlendAttachmentState blendStates[8];
+		auto colorBlendState = toVkPipelineColorBlendStateCreateInfo(m_Description.blend, blendStates);
+
+		VkFormat colorFormats[8];
+		auto formatInfo = toVkPipelineRenderingCreateInfo(m_Description, colorFormats);
+
+		// Vertex input and input assembly are not used by mesh shading pipelines
+		VkGraphicsPipelineCreateInfo createInfo{ VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
+		createInfo.pNext = &formatInfo;
+		createInfo.flags = VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+		createInfo.stageCount = stageCount;
+		createInfo.pStages = stages;
+		createInfo.pMultisampleState = &multisampleState;
+		createInfo.pViewportState = &viewportInfo;
+		createInfo.pRasterizationState = &rasterState;
+		createInfo.pDepthStencilState = &depthStencilState;
+		createInfo.pColorBlendState = &colorBlendState;
+		createInfo.pDynamicState = &dynamicStateInfo;
+		createInfo.layout = ((VulkanDevice*)m_Device)->getPipelineLayout();
+
+		VK_CHECK_RETURN(
+			vkCreateGraphicsPipelines((VkDevice)m_Device->getHandle(), VK_NULL_HANDLE, 1, &createInfo, nullptr, &m_Pipeline),
+			false,
+			"Failed to create mesh shading pipeline: {}", m_DebugName);
+		setDebugName((VkDevice)m_Device->getHandle(), VK_OBJECT_TYPE_PIPELINE, m_Pipeline, m_DebugName.c_str());
+		return true;
+	}
+
 	VulkanComputePipelineState::VulkanComputePipelineState(VulkanDevice* device, const ComputePipelineDescription& desc, const std::string& name) {
 		m_Device = device;
 		m_DebugName = name;
@@ -17,6 +17,18 @@ namespace rhi::vulkan {
 		GraphicsPipelineDescription m_Description;
 		VkPipeline m_Pipeline{ VK_NULL_HANDLE };
 	};
+	class VulkanMeshShadingPipelineState : public IPipelineState {
+	public:
+		VulkanMeshShadingPipelineState(VulkanDevice* device, const MeshShadingPipelineDescription& desc, const std::string& name);
+		~VulkanMeshShadingPipelineState();
+
+		void* getHandle() const override { return m_Pipeline; }
+		bool create() override;
+
+	private:
+		MeshShadingPipelineDescription m_Description;
+		VkPipeline m_Pipeline{ VK_NULL_HANDLE };
+	};
 	class VulkanComputePipelineState : public IPipelineState
 	{
 	public:
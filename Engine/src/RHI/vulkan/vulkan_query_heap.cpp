@@ -0,0 +1,112 @@
+#include "vulkan_query_heap.hpp"
+#include "vulkan_device.hpp"
+#include "vulkan_buffer.hpp"
+
+namespace rhi::vulkan
+{
+	namespace
+	{
+		static VkQueryType toVkQueryType(QueryType type)
+		{
+			switch (type)
+			{
+			case QueryType::Timestamp:
+				return VK_QUERY_TYPE_TIMESTAMP;
+			case QueryType::PipelineStatistics:
+				return VK_QUERY_TYPE_PIPELINE_STATISTICS;
+			case QueryType::Occlusion:
+				return VK_QUERY_TYPE_OCCLUSION;
+			default:
+				SE_ASSERT(false, "Unknown QueryType");
+				return VK_QUERY_TYPE_TIMESTAMP;
+			}
+		}
+	}
+
+	VulkanQueryHeap::VulkanQueryHeap(VulkanDevice* device, const QueryHeapDescription& desc, const std::string& name)
+	{
+		m_Device = device;
+		m_Description = desc;
+		m_DebugName = name;
+	}
+
+	VulkanQueryHeap::~VulkanQueryHeap()
+	{
+		((VulkanDevice*)m_Device)->enqueueDeletion(m_QueryPool);
+	}
+
+	bool VulkanQueryHeap::create()
+	{
+		VulkanDevice* device = (VulkanDevice*)m_Device;
+
+		VkQueryPoolCreateInfo createInfo = { VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+		createInfo.queryType = toVkQueryType(m_Description.type);
+		createInfo.queryCount = m_Description.queryCount;
+		if (m_Description.type == QueryType::PipelineStatistics)
+		{
+			// Geometry and tessellation shaders are never enabled on the device, their bits would be invalid here
+			createInfo.pipelineStatistics =
+				VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+				VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+				VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+				VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+				VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+				VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT |
+				VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+			if (device->isMeshShaderQuerySupported())
+			{
+				createInfo.pipelineStatistics |=
+					VK_QUERY_PIPELINE_STATISTIC_TASK_SHADER_INVOCATIONS_BIT_EXT |
+					VK_QUERY_PIPELINE_STATISTIC_MESH_SHADER_INVOCATIONS_BIT_EXT;
+			}
+		}
+
+		VK_CHECK_RETURN(vkCreateQueryPool(device->getDevice(), &createInfo, nullptr, &m_QueryPool), false, "Failed to create query pool: {}", m_DebugName);
+		setDebugName(device->getDevice(), VK_OBJECT_TYPE_QUERY_POOL, m_QueryPool, m_DebugName.c_str());
+
+		// Queries have to be reset before first use, resolveQueries resets them afterwards
+		vkResetQueryPool(device->getDevice(), m_QueryPool, 0, m_Description.queryCount);
+
+		BufferDescription bufferDesc;
+		bufferDesc.size = (uint64_t)getQueryResultSize(m_Description.type) * m_Description.queryCount;
+		bufferDesc.memoryType = MemoryType::GpuToCpu;
+		for (uint32_t i = 0; i < SE::SE_MAX_FRAMES_IN_FLIGHT; ++i)
+		{
+			m_ReadbackBuffers[i].reset(device->createBuffer(bufferDesc, m_DebugName + ":Readback"));
+			if (!m_ReadbackBuffers[i] || !m_ReadbackBuffers[i]->map())
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	bool VulkanQueryHeap::readResults(uint32_t startIndex, uint32_t count, void* data)
+	{
+		SE_ASSERT(startIndex + count <= m_Description.queryCount, "Query range out of bounds");
+
+		uint32_t slot = m_Device->getFrameID() % SE::SE_MAX_FRAMES_IN_FLIGHT;
+		if (!m_Resolved[slot])
+		{
+			return false;
+		}
+
+		VulkanBuffer* buffer = (VulkanBuffer*)m_ReadbackBuffers[slot].get();
+		uint32_t resultSize = getQueryResultSize(m_Description.type);
+		vmaInvalidateAllocation(((VulkanDevice*)m_Device)->getVmaAllocator(), buffer->getAllocation(), (VkDeviceSize)startIndex * resultSize, (VkDeviceSize)count * resultSize);
+
+		memcpy(data, (char*)buffer->getCpuAddress() + startIndex * resultSize, (size_t)count * resultSize);
+		return true;
+	}
+
+	IBuffer* VulkanQueryHeap::getReadbackBuffer() const
+	{
+		return m_ReadbackBuffers[m_Device->getFrameID() % SE::SE_MAX_FRAMES_IN_FLIGHT].get();
+	}
+
+	void VulkanQueryHeap::markResolved()
+	{
+		m_Resolved[m_Device->getFrameID() % SE::SE_MAX_FRAMES_IN_FLIGHT] = true;
+	}
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "vulkan_core.hpp"
+#include "../query_heap.hpp"
+#include "../buffer.hpp"
+#include "engine_core.h"
+
+namespace rhi::vulkan
+{
+	class VulkanDevice;
+	class VulkanQueryHeap : public IQueryHeap
+	{
+	public:
+		VulkanQueryHeap(VulkanDevice* device, const QueryHeapDescription& desc, const std::string& name);
+		~VulkanQueryHeap();
+
+		bool create();
+
+		virtual void* getHandle() const override { return m_QueryPool; }
+		virtual bool readResults(uint32_t startIndex, uint32_t count, void* data) override;
+
+		// Readback buffer of the current frame slot, written by resolveQueries
+		IBuffer* getReadbackBuffer() const;
+		void markResolved();
+
+	private:
+		VkQueryPool m_QueryPool = VK_NULL_HANDLE;
+		SE::Scoped<IBuffer> m_ReadbackBuffers[SE::SE_MAX_FRAMES_IN_FLIGHT];
+		bool m_Resolved[SE::SE_MAX_FRAMES_IN_FLIGHT] = {};
+	};
+}
@@ -0,0 +1,262 @@
+#include "vulkan_queue.hpp"
+#include "vulkan_device.hpp"
+#include "vulkan_swapchain.hpp"
+#include "vulkan_submission_thread.hpp"
+#include <algorithm>
+
+namespace rhi::vulkan
+{
+	void VulkanSubmitBatch::reset()
+	{
+		submitCount = 0;
+		commandBufferCount = 0;
+		waitCount = 0;
+		signalCount = 0;
+		presentCount = 0;
+	}
+
+	VulkanQueue::VulkanQueue(VulkanDevice* device, CommandType type, VkQueue queue)
+	{
+		m_Device = device;
+		m_Type = type;
+		m_Queue = queue;
+	}
+
+	void VulkanQueue::wait(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags2 stageMask)
+	{
+		// A wait applies to the whole VkSubmitInfo2, so work recorded before it goes into its own entry
+		if (m_SubmitOpen)
+		{
+			const VkSubmitInfo2& current = m_Batch.submits[m_Batch.submitCount];
+			if (current.commandBufferInfoCount > 0 || current.signalSemaphoreInfoCount > 0)
+			{
+				closeSubmit();
+			}
+		}
+
+		reserve(1, 0, 0, 0);
+		VkSubmitInfo2& submitInfo = openSubmit();
+
+		VkSemaphoreSubmitInfo& info = m_Batch.waits[m_Batch.waitCount++];
+		info = { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+		info.semaphore = semaphore;
+		info.value = value;
+		info.stageMask = stageMask;
+		++submitInfo.waitSemaphoreInfoCount;
+	}
+
+	void VulkanQueue::signal(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags2 stageMask)
+	{
+		reserve(0, 0, 1, 0);
+		VkSubmitInfo2& submitInfo = openSubmit();
+
+		VkSemaphoreSubmitInfo& info = m_Batch.signals[m_Batch.signalCount++];
+		info = { VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO };
+		info.semaphore = semaphore;
+		info.value = value;
+		info.stageMask = stageMask;
+		++submitInfo.signalSemaphoreInfoCount;
+
+		m_NeedsFlush = true;
+	}
+
+	void VulkanQueue::addCommandBuffer(VkCommandBuffer commandBuffer)
+	{
+		if (m_SubmitOpen && m_Batch.submits[m_Batch.submitCount].signalSemaphoreInfoCount > 0)
+		{
+			closeSubmit();
+		}
+
+		reserve(0, 1, 0, 0);
+		VkSubmitInfo2& submitInfo = openSubmit();
+
+		VkCommandBufferSubmitInfo& info = m_Batch.commandBuffers[m_Batch.commandBufferCount++];
+		info = { VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO };
+		info.commandBuffer = commandBuffer;
+		++submitInfo.commandBufferInfoCount;
+	}
+
+	void VulkanQueue::present(VulkanSwapchain* swapchain, uint32_t imageIndex, VkSemaphore waitSemaphore)
+	{
+		reserve(0, 0, 0, 1);
+
+		VulkanSubmitBatch::Present& present = m_Batch.presents[m_Batch.presentCount++];
+		present.swapchain = swapchain;
+		present.imageIndex = imageIndex;
+		present.waitSemaphore = waitSemaphore;
+
+		m_NeedsFlush = true;
+	}
+
+	void VulkanQueue::submit()
+	{
+		++m_Stats.submitRequests;
+
+		if (m_NeedsFlush)
+		{
+			flush();
+		}
+	}
+
+	void VulkanQueue::flush()
+	{
+		closeSubmit();
+
+		if (!m_Batch.empty())
+		{
+			if (m_Batch.submitCount > 0)
+			{
+				++m_Stats.queueSubmits;
+				m_Stats.commandBuffers += m_Batch.commandBufferCount;
+			}
+
+			VulkanSubmissionThread* submissionThread = m_Device->getSubmissionThread();
+			if (submissionThread)
+			{
+				submissionThread->enqueue(this, m_Batch);
+			}
+			else
+			{
+				execute(m_Batch);
+			}
+		}
+
+		m_Batch.reset();
+		m_NeedsFlush = false;
+	}
+
+	void VulkanQueue::execute(VulkanSubmitBatch& batch)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		if (batch.submitCount > 0)
+		{
+			for (uint32_t i = 0; i < batch.submitCount; ++i)
+			{
+				batch.submits[i].pWaitSemaphoreInfos = batch.waits + batch.ranges[i].firstWait;
+				batch.submits[i].pCommandBufferInfos = batch.commandBuffers + batch.ranges[i].firstCommandBuffer;
+				batch.submits[i].pSignalSemaphoreInfos = batch.signals + batch.ranges[i].firstSignal;
+			}
+
+			VK_CHECK(vkQueueSubmit2(m_Queue, batch.submitCount, batch.submits, VK_NULL_HANDLE));
+		}
+
+		auto submitted = std::chrono::high_resolution_clock::now();
+
+		for (uint32_t i = 0; i < batch.presentCount; ++i)
+		{
+			const VulkanSubmitBatch::Present& present = batch.presents[i];
+			present.swapchain->present(m_Queue, present.imageIndex, present.waitSemaphore);
+		}
+
+		auto end = std::chrono::high_resolution_clock::now();
+
+		m_SubmitTimeNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(submitted - start).count(), std::memory_order_relaxed);
+		m_PresentTimeNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(end - submitted).count(), std::memory_order_relaxed);
+	}
+
+	QueueSubmissionStats VulkanQueue::consumeStats()
+	{
+		QueueSubmissionStats stats = m_Stats;
+		stats.submitTimeMs = m_SubmitTimeNs.exchange(0, std::memory_order_relaxed) / 1000000.0f;
+		stats.presentTimeMs = m_PresentTimeNs.exchange(0, std::memory_order_relaxed) / 1000000.0f;
+		m_Stats = {};
+		return stats;
+	}
+
+	VkSubmitInfo2& VulkanQueue::openSubmit()
+	{
+		if (!m_SubmitOpen)
+		{
+			if (m_Batch.submitCount == VulkanSubmitBatch::MAX_SUBMITS)
+			{
+				flush();
+			}
+
+			VkSubmitInfo2& submitInfo = m_Batch.submits[m_Batch.submitCount];
+			submitInfo = { VK_STRUCTURE_TYPE_SUBMIT_INFO_2 };
+
+			VulkanSubmitBatch::SubmitRange& range = m_Batch.ranges[m_Batch.submitCount];
+			range.firstWait = m_Batch.waitCount;
+			range.firstCommandBuffer = m_Batch.commandBufferCount;
+			range.firstSignal = m_Batch.signalCount;
+			m_SubmitOpen = true;
+		}
+
+		return m_Batch.submits[m_Batch.submitCount];
+	}
+
+	void VulkanQueue::closeSubmit()
+	{
+		if (!m_SubmitOpen)
+		{
+			return;
+		}
+
+		const VkSubmitInfo2& submitInfo = m_Batch.submits[m_Batch.submitCount];
+		if (submitInfo.waitSemaphoreInfoCount > 0 || submitInfo.commandBufferInfoCount > 0 || submitInfo.signalSemaphoreInfoCount > 0)
+		{
+			++m_Batch.submitCount;
+		}
+		m_SubmitOpen = false;
+	}
+
+	void VulkanQueue::reserve(uint32_t waitCount, uint32_t commandBufferCount, uint32_t signalCount, uint32_t presentCount)
+	{
+		if (m_Batch.waitCount + waitCount <= VulkanSubmitBatch::MAX_SEMAPHORES &&
+			m_Batch.commandBufferCount + commandBufferCount <= VulkanSubmitBatch::MAX_COMMAND_BUFFERS &&
+			m_Batch.signalCount + signalCount <= VulkanSubmitBatch::MAX_SEMAPHORES &&
+			m_Batch.presentCount + presentCount <= VulkanSubmitBatch::MAX_PRESENTS)
+		{
+			return;
+		}
+
+		// The open submit moves into the next batch whole, its waits also cover the command buffers still to come
+		VulkanSubmitBatch::SubmitRange range = {};
+		uint32_t openWaits = 0;
+		uint32_t openCommandBuffers = 0;
+		uint32_t openSignals = 0;
+		if (m_SubmitOpen)
+		{
+			range = m_Batch.ranges[m_Batch.submitCount];
+			openWaits = m_Batch.waitCount - range.firstWait;
+			openCommandBuffers = m_Batch.commandBufferCount - range.firstCommandBuffer;
+			openSignals = m_Batch.signalCount - range.firstSignal;
+		}
+
+		bool carry = m_SubmitOpen && m_Batch.submitCount + m_Batch.presentCount > 0 &&
+			openWaits + waitCount <= VulkanSubmitBatch::MAX_SEMAPHORES &&
+			openCommandBuffers + commandBufferCount <= VulkanSubmitBatch::MAX_COMMAND_BUFFERS &&
+			openSignals + signalCount <= VulkanSubmitBatch::MAX_SEMAPHORES;
+		if (!carry)
+		{
+			flush();
+			return;
+		}
+
+		VkSemaphoreSubmitInfo waits[VulkanSubmitBatch::MAX_SEMAPHORES];
+		VkCommandBufferSubmitInfo commandBuffers[VulkanSubmitBatch::MAX_COMMAND_BUFFERS];
+		VkSemaphoreSubmitInfo signals[VulkanSubmitBatch::MAX_SEMAPHORES];
+		std::copy_n(m_Batch.waits + range.firstWait, openWaits, waits);
+		std::copy_n(m_Batch.commandBuffers + range.firstCommandBuffer, openCommandBuffers, commandBuffers);
+		std::copy_n(m_Batch.signals + range.firstSignal, openSignals, signals);
+
+		m_Batch.waitCount = range.firstWait;
+		m_Batch.commandBufferCount = range.firstCommandBuffer;
+		m_Batch.signalCount = range.firstSignal;
+		m_SubmitOpen = false;
+		flush();
+
+		VkSubmitInfo2& submitInfo = openSubmit();
+		std::copy_n(waits, openWaits, m_Batch.waits);
+		std::copy_n(commandBuffers, openCommandBuffers, m_Batch.commandBuffers);
+		std::copy_n(signals, openSignals, m_Batch.signals);
+		m_Batch.waitCount = openWaits;
+		m_Batch.commandBufferCount = openCommandBuffers;
+		m_Batch.signalCount = openSignals;
+		submitInfo.waitSemaphoreInfoCount = openWaits;
+		submitInfo.commandBufferInfoCount = openCommandBuffers;
+		submitInfo.signalSemaphoreInfoCount = openSignals;
+		m_NeedsFlush = openSignals > 0;
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "../types.hpp"
+#include "vulkan_core.hpp"
+#include <atomic>
+
+namespace rhi::vulkan
+{
+	class VulkanDevice;
+	class VulkanSwapchain;
+
+	// Plain copyable batch; submit info pointers are resolved when the batch is executed
+	struct VulkanSubmitBatch
+	{
+		static const uint32_t MAX_SUBMITS = 16;
+		static const uint32_t MAX_COMMAND_BUFFERS = 64;
+		static const uint32_t MAX_SEMAPHORES = 32;
+		static const uint32_t MAX_PRESENTS = 4;
+
+		struct SubmitRange
+		{
+			uint32_t firstWait = 0;
+			uint32_t firstCommandBuffer = 0;
+			uint32_t firstSignal = 0;
+		};
+
+		struct Present
+		{
+			VulkanSwapchain* swapchain = nullptr;
+			uint32_t imageIndex = 0;
+			VkSemaphore waitSemaphore = VK_NULL_HANDLE;
+		};
+
+		VkSubmitInfo2 submits[MAX_SUBMITS] = {};
+		SubmitRange ranges[MAX_SUBMITS] = {};
+		VkCommandBufferSubmitInfo commandBuffers[MAX_COMMAND_BUFFERS] = {};
+		VkSemaphoreSubmitInfo waits[MAX_SEMAPHORES] = {};
+		VkSemaphoreSubmitInfo signals[MAX_SEMAPHORES] = {};
+		Present presents[MAX_PRESENTS] = {};
+
+		uint32_t submitCount = 0;
+		uint32_t commandBufferCount = 0;
+		uint32_t waitCount = 0;
+		uint32_t signalCount = 0;
+		uint32_t presentCount = 0;
+
+		bool empty() const { return submitCount == 0 && presentCount == 0; }
+		void reset();
+	};
+
+	// Collects command buffers, waits and signals of a queue and flushes them with a single vkQueueSubmit2.
+	// Work without a signal or present stays batched until the next sync point (or endFrame).
+	// When the device runs a submission thread, flushed batches are handed over to it instead of being submitted here.
+	class VulkanQueue
+	{
+	public:
+		VulkanQueue(VulkanDevice* device, CommandType type, VkQueue queue);
+
+		void wait(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags2 stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+		void signal(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags2 stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+		void addCommandBuffer(VkCommandBuffer commandBuffer);
+		void present(VulkanSwapchain* swapchain, uint32_t imageIndex, VkSemaphore waitSemaphore);
+		void submit();
+		void flush();
+
+		// Issues the driver calls of a flushed batch, may run on the submission thread
+		void execute(VulkanSubmitBatch& batch);
+
+		VkQueue getHandle() const { return m_Queue; }
+		CommandType getType() const { return m_Type; }
+		// Returns the counters gathered since the last call and resets them
+		QueueSubmissionStats consumeStats();
+
+	private:
+		VkSubmitInfo2& openSubmit();
+		void closeSubmit();
+		// Flushes the batch when the entries about to be added do not fit
+		void reserve(uint32_t waitCount, uint32_t commandBufferCount, uint32_t signalCount, uint32_t presentCount);
+
+	private:
+		VulkanDevice* m_Device = nullptr;
+		VkQueue m_Queue = VK_NULL_HANDLE;
+		CommandType m_Type = CommandType::Graphics;
+
+		VulkanSubmitBatch m_Batch;
+		bool m_SubmitOpen = false;
+		bool m_NeedsFlush = false;
+
+		QueueSubmissionStats m_Stats;
+		std::atomic<uint64_t> m_SubmitTimeNs{ 0 };
+		std::atomic<uint64_t> m_PresentTimeNs{ 0 };
+	};
+}
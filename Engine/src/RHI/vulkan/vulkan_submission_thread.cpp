@@ -0,0 +1,76 @@
+#include "vulkan_submission_thread.hpp"
+
+namespace rhi::vulkan
+{
+	VulkanSubmissionThread::VulkanSubmissionThread()
+	{
+		m_Thread = std::thread(&VulkanSubmissionThread::run, this);
+	}
+
+	VulkanSubmissionThread::~VulkanSubmissionThread()
+	{
+		enqueue(nullptr, {});
+		m_Thread.join();
+	}
+
+	uint64_t VulkanSubmissionThread::enqueue(VulkanQueue* queue, const VulkanSubmitBatch& batch)
+	{
+		// Callers usually hold the device submit mutex already, this one stays uncontended then
+		std::lock_guard<std::mutex> lock(m_EnqueueMutex);
+		uint64_t head = m_Head.load(std::memory_order_relaxed);
+		uint64_t tail = m_Tail.load(std::memory_order_acquire);
+		while (head - tail >= RING_SIZE)
+		{
+			m_Tail.wait(tail, std::memory_order_acquire);
+			tail = m_Tail.load(std::memory_order_acquire);
+		}
+
+		Packet& packet = m_Packets[head % RING_SIZE];
+		packet.queue = queue;
+		packet.batch = batch;
+
+		m_Head.store(head + 1, std::memory_order_release);
+		m_Head.notify_one();
+		return head;
+	}
+
+	void VulkanSubmissionThread::waitIdle()
+	{
+		uint64_t head = m_Head.load(std::memory_order_acquire);
+		uint64_t tail = m_Tail.load(std::memory_order_acquire);
+		while (tail < head)
+		{
+			m_Tail.wait(tail, std::memory_order_acquire);
+			tail = m_Tail.load(std::memory_order_acquire);
+		}
+	}
+
+	void VulkanSubmissionThread::run()
+	{
+		while (true)
+		{
+			uint64_t tail = m_Tail.load(std::memory_order_relaxed);
+			uint64_t head = m_Head.load(std::memory_order_acquire);
+			if (head == tail)
+			{
+				m_Head.wait(head, std::memory_order_acquire);
+				continue;
+			}
+
+			Packet& packet = m_Packets[tail % RING_SIZE];
+			VulkanQueue* queue = packet.queue;
+			if (queue)
+			{
+				queue->execute(packet.batch);
+			}
+
+			m_Tail.store(tail + 1, std::memory_order_release);
+			m_Tail.notify_all();
+
+			if (!queue)
+			{
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "vulkan_queue.hpp"
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace rhi::vulkan
+{
+	// Owns every vkQueueSubmit2/vkQueuePresentKHR call when enabled.
+	// Ring of batches with a single consumer (this thread). Queue flushes of the render thread and of the upload workers
+	// both produce, enqueue serializes them so the consumer side stays lock-free.
+	class VulkanSubmissionThread
+	{
+	public:
+		static const uint32_t RING_SIZE = 8;
+
+		VulkanSubmissionThread();
+		~VulkanSubmissionThread();
+
+		// Blocks only if the ring is full or another thread is enqueuing
+		uint64_t enqueue(VulkanQueue* queue, const VulkanSubmitBatch& batch);
+		void waitIdle();
+
+		// Tickets: batch N has been handed to the driver once getCompletedCount() > N
+		uint64_t getEnqueuedCount() const { return m_Head.load(std::memory_order_acquire); }
+		uint64_t getCompletedCount() const { return m_Tail.load(std::memory_order_acquire); }
+
+	private:
+		void run();
+
+	private:
+		struct Packet
+		{
+			VulkanQueue* queue = nullptr; // nullptr stops the thread
+			VulkanSubmitBatch batch;
+		};
+
+		Packet m_Packets[RING_SIZE];
+		std::atomic<uint64_t> m_Head{ 0 };
+		std::atomic<uint64_t> m_Tail{ 0 };
+		std::mutex m_EnqueueMutex; // head is read, written and published by one producer at a time
+		std::thread m_Thread;
+	};
+}
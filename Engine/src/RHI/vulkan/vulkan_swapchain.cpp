@@ -99,21 +99,18 @@ namespace rhi::vulkan {
 		return true;
 	}
 
-	void VulkanSwapchain::present(VkQueue queue) {
-		VkSemaphore waitSemaphore = getPresentSemaphore();
-
+	void VulkanSwapchain::present(VkQueue queue, uint32_t imageIndex, VkSemaphore waitSemaphore) {
 		VkPresentInfoKHR info = { VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
 		info.waitSemaphoreCount = 1;
 		info.pWaitSemaphores = &waitSemaphore;
 		info.swapchainCount = 1;
 		info.pSwapchains = &m_Swapchain;
-		info.pImageIndices = &m_CurrentSwapchainImage;
+		info.pImageIndices = &imageIndex;
 
+		std::lock_guard<std::mutex> lock(m_Mutex);
 		VkResult result = vkQueuePresentKHR(queue, &info);
 		if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-			{
-				recreateSwapchain();
-			}
+			m_NeedsRecreate.store(true, std::memory_order_release);
 		}
 	}
 
@@ -129,7 +126,10 @@ namespace rhi::vulkan {
 	}
 
 	bool VulkanSwapchain::recreateSwapchain() {
-		vkDeviceWaitIdle((VkDevice)m_Device->getHandle());
+		// Drains the submission thread, so it must not hold the lock a pending present is waiting for
+		((VulkanDevice*)m_Device)->waitIdle();
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_NeedsRecreate.store(false, std::memory_order_relaxed);
 		for (auto& image : m_SwapchainImages)
 		{
 			image.reset();
@@ -177,15 +177,27 @@ namespace rhi::vulkan {
 
 	bool VulkanSwapchain::acquireNextImage()
 	{
+		if (m_NeedsRecreate.load(std::memory_order_acquire))
+		{
+			recreateSwapchain();
+		}
+
 		m_frameSemaphoreIndex = (m_frameSemaphoreIndex + 1) % m_AcquireSemaphores.size();
 		VkSemaphore signalSemaphore = getAcquireSemaphore();
 
-		VkResult result = vkAcquireNextImageKHR((VkDevice)m_Device->getHandle(), m_Swapchain, UINT64_MAX, signalSemaphore, VK_NULL_HANDLE, &m_CurrentSwapchainImage);
+		VkResult result = VK_SUCCESS;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			result = vkAcquireNextImageKHR((VkDevice)m_Device->getHandle(), m_Swapchain, UINT64_MAX, signalSemaphore, VK_NULL_HANDLE, &m_CurrentSwapchainImage);
+		}
 
 		if (result == VK_SUBOPTIMAL_KHR || result == VK_ERROR_OUT_OF_DATE_KHR)
 		{
 			recreateSwapchain();
+			m_frameSemaphoreIndex %= m_AcquireSemaphores.size();
+			signalSemaphore = getAcquireSemaphore();
 
+			std::lock_guard<std::mutex> lock(m_Mutex);
 			result = vkAcquireNextImageKHR((VkDevice)m_Device->getHandle(), m_Swapchain, UINT64_MAX, signalSemaphore, VK_NULL_HANDLE, &m_CurrentSwapchainImage);
 			SE_ASSERT(result == VK_SUCCESS, "Acquiring image failed!{}", m_DebugName);
 		}
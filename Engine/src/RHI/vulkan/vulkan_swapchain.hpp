@@ -3,6 +3,8 @@
 #include "vulkan_core.hpp"
 #include "../swapchain.hpp"
 #include "vulkan_device.hpp"
+#include <atomic>
+#include <mutex>
 class VulkanTexture;
 
 namespace rhi::vulkan
@@ -14,9 +16,10 @@ namespace rhi::vulkan
 		~VulkanSwapchain();
 
 		bool create();
-		void present(VkQueue queue);
+		void present(VkQueue queue, uint32_t imageIndex, VkSemaphore waitSemaphore);
 		VkSemaphore getAcquireSemaphore();
 		VkSemaphore getPresentSemaphore();
+		uint32_t getCurrentImageIndex() const { return m_CurrentSwapchainImage; }
 
 		virtual void* getHandle() const override { return m_Swapchain; }
 		virtual bool acquireNextImage() override;
@@ -42,5 +45,10 @@ namespace rhi::vulkan
 		int32_t m_frameSemaphoreIndex = uint32_t(-1);
 		std::vector<VkSemaphore> m_AcquireSemaphores;
 		std::vector<VkSemaphore> m_PresentSemaphores;
+
+		// Set by present (possibly on the submission thread), handled on the next acquire
+		std::atomic<bool> m_NeedsRecreate{ false };
+		// Present runs on the submission thread, acquire and recreation on the render thread
+		std::mutex m_Mutex;
 	};
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "vulkan_texture.hpp"
+#include <algorithm>
 
 namespace rhi::vulkan
 {
@@ -23,6 +24,7 @@ namespace rhi::vulkan
 
 		if (!m_IsSwapchainImage)
 		{
+			pDevice->untrackAllocation(MemoryCategory::Texture, m_allocation);
 			pDevice->enqueueDeletion(m_Image);
 			pDevice->enqueueDeletion(m_allocation);
 		}
@@ -39,16 +41,49 @@ namespace rhi::vulkan
 		VmaAllocator allocator = ((VulkanDevice*)m_Device)->getVmaAllocator();
 
 		VkImageCreateInfo createInfo = toImageCreateInfo(m_Description);
-		VmaAllocationCreateInfo allocationInfo = {};
-		allocationInfo.usage = translateMemoryTypeToVMA(m_Description.memoryType);
 
-		VK_CHECK_RETURN(vmaCreateImage(allocator, &createInfo, &allocationInfo, &m_Image, &m_allocation, nullptr), false, "Image creation failed!");
+		if (anySet(m_Description.usage, TextureUsageFlags::Sparse))
+		{
+			// Sparse images get their memory per tile from heaps through tile mappings
+			SE_ASSERT(m_Device->isSparseResourceSupported(), "Sparse resources are not supported by the device");
+			SE_ASSERT(!m_Description.heap, "Sparse textures can not be placed in a heap");
+
+			VK_CHECK_RETURN(vkCreateImage(device, &createInfo, nullptr, &m_Image), false, "Sparse image creation failed! {}", m_DebugName);
+			if (!initTiling())
+			{
+				return false;
+			}
+		}
+		else if (m_Description.heap)
+		{
+			// Placed images alias the heap memory and own no allocation
+			SE_ASSERT(m_Description.heapOffset + ((VulkanDevice*)m_Device)->getAllocationSize(m_Description) <= m_Description.heap->getDescription().size);
+
+			VmaAllocation heapAllocation = (VmaAllocation)m_Description.heap->getHandle();
+			VK_CHECK_RETURN(vmaCreateAliasingImage2(allocator, heapAllocation, m_Description.heapOffset, &createInfo, &m_Image), false, "Placed image creation failed! {}", m_DebugName);
+		}
+		else
+		{
+			VmaAllocationCreateInfo allocationInfo = {};
+			allocationInfo.usage = translateMemoryTypeToVMA(m_Description.memoryType);
+			allocationInfo.pool = ((VulkanDevice*)m_Device)->getMemoryPool(m_Description);
+
+			VkResult result = vmaCreateImage(allocator, &createInfo, &allocationInfo, &m_Image, &m_allocation, nullptr);
+			if (result != VK_SUCCESS && allocationInfo.pool)
+			{
+				// The pool memory type may not support this image (e.g. depth formats) or it is larger than a block
+				allocationInfo.pool = VK_NULL_HANDLE;
+				result = vmaCreateImage(allocator, &createInfo, &allocationInfo, &m_Image, &m_allocation, nullptr);
+			}
+			VK_CHECK_RETURN(result, false, "Image creation failed!");
+		}
 
 		setDebugName(device, VK_OBJECT_TYPE_IMAGE, m_Image, m_DebugName.c_str());
 
 		if (m_allocation)
 		{
 			vmaSetAllocationName(allocator, m_allocation, m_DebugName.c_str());
+			((VulkanDevice*)m_Device)->trackAllocation(MemoryCategory::Texture, m_allocation);
 		}
 
 		m_IsSwapchainImage = false;
@@ -70,6 +105,135 @@ namespace rhi::vulkan
 		return true;
 	}
 
+	bool VulkanTexture::initTiling()
+	{
+		VkDevice device = ((VulkanDevice*)m_Device)->getDevice();
+
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(device, m_Image, &requirements);
+
+		uint32_t count = 0;
+		vkGetImageSparseMemoryRequirements(device, m_Image, &count, nullptr);
+		std::vector<VkSparseImageMemoryRequirements> sparseRequirements(count);
+		vkGetImageSparseMemoryRequirements(device, m_Image, &count, sparseRequirements.data());
+
+		// Only single aspect formats, depth/stencil would need a tile layout per aspect
+		VkImageAspectFlags aspect = getVkAspectMask(m_Description.format);
+		auto iter = std::find_if(sparseRequirements.begin(), sparseRequirements.end(),
+			[aspect](const VkSparseImageMemoryRequirements& r) { return r.formatProperties.aspectMask == aspect; });
+		if (iter == sparseRequirements.end())
+		{
+			SE::LogError("Sparse residency is not supported for the format of {}", m_DebugName);
+			return false;
+		}
+		m_SparseRequirements = *iter;
+		m_SparseMemoryTypeBits = requirements.memoryTypeBits;
+
+		const VkExtent3D& granularity = m_SparseRequirements.formatProperties.imageGranularity;
+		bool singleMipTail = m_SparseRequirements.formatProperties.flags & VK_SPARSE_IMAGE_FORMAT_SINGLE_MIPTAIL_BIT;
+
+		m_Tiling.tileSize = (uint32_t)requirements.alignment;
+		m_Tiling.tileWidth = granularity.width;
+		m_Tiling.tileHeight = granularity.height;
+		m_Tiling.tileDepth = granularity.depth;
+		m_Tiling.standardMipCount = std::min(m_SparseRequirements.imageMipTailFirstLod, m_Description.mipLevels);
+		m_Tiling.packedMipTileCount = m_Tiling.standardMipCount < m_Description.mipLevels ?
+			(uint32_t)(m_SparseRequirements.imageMipTailSize / requirements.alignment) : 0;
+
+		m_SubresourceTilings.resize(m_Description.mipLevels * m_Description.arraySize);
+
+		uint32_t tileIndex = 0;
+		uint32_t mipTailIndex = 0;
+		for (uint32_t slice = 0; slice < m_Description.arraySize; ++slice)
+		{
+			for (uint32_t mip = 0; mip < m_Tiling.standardMipCount; ++mip)
+			{
+				SubresourceTiling& tiling = m_SubresourceTilings[slice * m_Description.mipLevels + mip];
+				tiling.widthInTiles = (std::max(m_Description.width >> mip, 1u) + granularity.width - 1) / granularity.width;
+				tiling.heightInTiles = (std::max(m_Description.height >> mip, 1u) + granularity.height - 1) / granularity.height;
+				tiling.depthInTiles = (std::max(m_Description.depth >> mip, 1u) + granularity.depth - 1) / granularity.depth;
+				tiling.startTileIndex = tileIndex;
+				tileIndex += tiling.widthInTiles * tiling.heightInTiles * tiling.depthInTiles;
+			}
+
+			if (m_Tiling.packedMipTileCount > 0 && (slice == 0 || !singleMipTail))
+			{
+				mipTailIndex = tileIndex;
+				tileIndex += m_Tiling.packedMipTileCount;
+			}
+
+			for (uint32_t mip = m_Tiling.standardMipCount; mip < m_Description.mipLevels; ++mip)
+			{
+				m_SubresourceTilings[slice * m_Description.mipLevels + mip].startTileIndex = mipTailIndex;
+			}
+		}
+
+		m_Tiling.tileCount = tileIndex;
+		m_TileResidency.assign(tileIndex, 0);
+		m_ResidentTileCount = 0;
+		return true;
+	}
+
+	SubresourceTiling VulkanTexture::getSubresourceTiling(uint32_t subresource) const
+	{
+		return subresource < m_SubresourceTilings.size() ? m_SubresourceTilings[subresource] : SubresourceTiling{};
+	}
+
+	uint32_t VulkanTexture::getTileIndex(uint32_t subresource, uint32_t x, uint32_t y, uint32_t z) const
+	{
+		const SubresourceTiling& tiling = m_SubresourceTilings[subresource];
+		if (subresource % m_Description.mipLevels >= m_Tiling.standardMipCount)
+		{
+			return tiling.startTileIndex + x;
+		}
+
+		SE_ASSERT(x < tiling.widthInTiles && y < tiling.heightInTiles && z < tiling.depthInTiles);
+		return tiling.startTileIndex + (z * tiling.heightInTiles + y) * tiling.widthInTiles + x;
+	}
+
+	bool VulkanTexture::isTileResident(uint32_t subresource, uint32_t x, uint32_t y, uint32_t z) const
+	{
+		if (m_TileResidency.empty())
+		{
+			return true;
+		}
+		return m_TileResidency[getTileIndex(subresource, x, y, z)] != 0;
+	}
+
+	void VulkanTexture::updateTileResidency(const TileMapping& mapping)
+	{
+		uint8_t resident = mapping.type == TileMappingType::Map ? 1 : 0;
+		auto update = [&](uint32_t index)
+		{
+			if (m_TileResidency[index] != resident)
+			{
+				m_TileResidency[index] = resident;
+				m_ResidentTileCount += resident ? 1 : -1;
+			}
+		};
+
+		if (mapping.subresource % m_Description.mipLevels >= m_Tiling.standardMipCount)
+		{
+			for (uint32_t i = 0; i < mapping.tileCount; ++i)
+			{
+				update(getTileIndex(mapping.subresource, mapping.x + i, 0, 0));
+			}
+			return;
+		}
+
+		const SubresourceTiling& tiling = m_SubresourceTilings[mapping.subresource];
+		for (uint32_t z = mapping.z; z < std::min(mapping.z + mapping.depth, tiling.depthInTiles); ++z)
+		{
+			for (uint32_t y = mapping.y; y < std::min(mapping.y + mapping.height, tiling.heightInTiles); ++y)
+			{
+				for (uint32_t x = mapping.x; x < std::min(mapping.x + mapping.width, tiling.widthInTiles); ++x)
+				{
+					update(getTileIndex(mapping.subresource, x, y, z));
+				}
+			}
+		}
+	}
+
 	uint32_t VulkanTexture::getRequiredStagingBufferSize() const
 	{
 		VkMemoryRequirements requirements;
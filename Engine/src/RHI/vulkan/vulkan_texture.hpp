@@ -20,13 +20,34 @@ namespace rhi::vulkan
 		virtual void* getHandle() const override { return m_Image; };
 		virtual bool isTexture() const override { return true; };
 
+		virtual TextureTiling getTiling() const override { return m_Tiling; }
+		virtual SubresourceTiling getSubresourceTiling(uint32_t subresource) const override;
+		virtual bool isTileResident(uint32_t subresource, uint32_t x, uint32_t y, uint32_t z) const override;
+		virtual uint32_t getResidentTileCount() const override { return m_ResidentTileCount; }
+
 		uint32_t getRequiredStagingBufferSize() const;
 		VkImageView getRenderView(uint32_t mipSlice, uint32_t arraySlice);
 
+		const VkSparseImageMemoryRequirements& getSparseRequirements() const { return m_SparseRequirements; }
+		uint32_t getSparseMemoryTypeBits() const { return m_SparseMemoryTypeBits; }
+		void updateTileResidency(const TileMapping& mapping);
+
+	private:
+		bool initTiling();
+		uint32_t getTileIndex(uint32_t subresource, uint32_t x, uint32_t y, uint32_t z) const;
+
 	private:
 		VkImage m_Image = VK_NULL_HANDLE;
 		VmaAllocation m_allocation = VK_NULL_HANDLE;
 		bool m_IsSwapchainImage = false;
 		std::vector<VkImageView> m_RenderViews;
+
+		// Sparse residency, one entry per tile in the order of m_SubresourceTilings
+		VkSparseImageMemoryRequirements m_SparseRequirements = {};
+		uint32_t m_SparseMemoryTypeBits = 0;
+		TextureTiling m_Tiling;
+		std::vector<SubresourceTiling> m_SubresourceTilings;
+		std::vector<uint8_t> m_TileResidency;
+		uint32_t m_ResidentTileCount = 0;
 	};
 }
\ No newline at end of file
@@ -1,6 +1,9 @@
 #include "engine.hpp"
 #include "renderer/renderer.hpp"
 #include "Editor.hpp"
+#include "scene/gltf_loader.hpp"
+#include "scene/obj_loader.hpp"
+#include "utils/thread_pool.hpp"
 #include <rpmalloc.h>
 
 namespace SE
@@ -15,6 +18,7 @@ namespace SE
 
 		m_AssetPath = "assets/";
 		m_ShaderPath = "shaders/";
+		m_ThreadPool = createScoped<ThreadPool>();
 		m_Renderer = createScoped<Renderer>();
 		m_Renderer->createDevice(rhi::RenderBackend::Vulkan, m_Window->getNativeWindow(), widthWin, heightWin);
 
@@ -52,10 +56,38 @@ namespace SE
 	}
 	void Engine::shutdown()
 	{
+		m_LoadedScenes.clear();
 		m_Camera.reset();
 		m_Editor.reset();
 		m_Renderer.reset();
 		m_Window.reset();
+		m_ThreadPool.reset();
+	}
+	Shared<LoadedScene> Engine::loadScene(const std::string& fileName)
+	{
+		std::filesystem::path path = m_AssetPath + fileName;
+		std::string extension = path.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)std::tolower(c); });
+
+		Shared<LoadedScene> scene;
+		if (extension == ".gltf" || extension == ".glb")
+		{
+			scene = loadGLTF(m_Renderer.get(), *m_ThreadPool, path);
+		}
+		else if (extension == ".obj")
+		{
+			scene = loadOBJ(m_Renderer.get(), *m_ThreadPool, path);
+		}
+		else
+		{
+			LogError("Unsupported scene format {}", fileName);
+		}
+
+		if (scene)
+		{
+			m_LoadedScenes[fileName] = scene;
+		}
+		return scene;
 	}
 	void Engine::handleEvent(const SDL_Event& event, const Uint8* state)
 	{
@@ -13,8 +13,9 @@ namespace SE
 {
 	// Forward declarations
 	struct MeshAsset;
-	struct LoadedGLTF;
+	struct LoadedScene;
 	struct Renderer;
+	class ThreadPool;
 
 	// Vulkan engine class
 	class Engine {
@@ -28,6 +29,9 @@ namespace SE
 		SINGULARITY_API void create(uint32_t width, uint32_t height);
 		SINGULARITY_API void run();
 		SINGULARITY_API void shutdown();
+		// Imports a file from the asset folder, replacing an earlier import of it. Returns nullptr on failure
+		SINGULARITY_API Shared<LoadedScene> loadScene(const std::string& fileName);
+		const std::unordered_map<std::string, Shared<LoadedScene>>& getLoadedScenes() const { return m_LoadedScenes; }
 
 		const std::string& getAssetPath() const { return m_AssetPath; }
 		const std::string& getShaderPath() const { return m_ShaderPath; }
@@ -35,6 +39,7 @@ namespace SE
 		Editor& getEditor() { return *m_Editor; }
 		Renderer& getRenderer() { return *m_Renderer; }
 		Camera& getCamera() { return *m_Camera; }
+		ThreadPool& getThreadPool() { return *m_ThreadPool; }
 	private:
 		Engine() = default;
 		~Engine() = default;
@@ -48,11 +53,12 @@ namespace SE
 		Scoped<Renderer> m_Renderer;
 		Scoped<Editor> m_Editor;
 		Scoped<Window> m_Window;
+		Scoped<ThreadPool> m_ThreadPool;
 		bool m_StopRendering = false;
 
 		//World
 		Scoped<Camera> m_Camera;
-		std::unordered_map<std::string, Shared<LoadedGLTF>> m_LoadedNodes;
+		std::unordered_map<std::string, Shared<LoadedScene>> m_LoadedScenes;
 		std::string m_AssetPath;
 		std::string m_ShaderPath;
 	private:
@@ -0,0 +1,305 @@
+#include "async_upload_queue.hpp"
+#include "renderer.hpp"
+#include <algorithm>
+#include <numeric>
+// Uploads are split into jobs of at most this size so one large resource does not hold back the fence of smaller ones
+#define ASYNC_UPLOAD_JOB_SIZE (4 * 1024 * 1024)
+#define ASYNC_UPLOAD_ALIGNMENT 256u
+
+namespace SE
+{
+	AsyncUploadQueue::AsyncUploadQueue(Renderer* pRenderer, uint32_t stagingSize)
+		: m_Renderer(pRenderer)
+	{
+		rhi::IDevice* device = m_Renderer->getDevice();
+		m_Fence.reset(device->createFence("AsyncUploadFence"));
+		m_StagingBufferAllocator = createScoped<StagingBufferAllocator>(pRenderer, m_Fence.get(), stagingSize);
+		for (CommandContext& context : m_Contexts)
+		{
+			context.commandList.reset(device->createCommandList(rhi::CommandType::Copy, "AsyncUploadCommands"));
+		}
+
+		m_Thread = std::thread(&AsyncUploadQueue::run, this);
+	}
+
+	AsyncUploadQueue::~AsyncUploadQueue()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stop = true;
+		}
+		m_Condition.notify_all();
+		m_Thread.join();
+
+		m_Fence->wait(m_SubmittedValue);
+	}
+
+	uint64_t AsyncUploadQueue::uploadBuffer(rhi::IBuffer* buffer, uint32_t offset, const void* data, uint32_t size)
+	{
+		const char* src_data = (const char*)data;
+		uint64_t value = 0;
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (uint32_t dataOffset = 0; dataOffset < size; dataOffset += ASYNC_UPLOAD_JOB_SIZE)
+		{
+			uint32_t jobSize = std::min<uint32_t>(ASYNC_UPLOAD_JOB_SIZE, size - dataOffset);
+
+			Job job;
+			job.buffer = buffer;
+			job.offset = offset + dataOffset;
+			job.alignment = ASYNC_UPLOAD_ALIGNMENT;
+			job.data.assign(src_data + dataOffset, src_data + dataOffset + jobSize);
+			value = pushJob(std::move(job));
+		}
+		m_Condition.notify_one();
+		return value;
+	}
+
+	uint64_t AsyncUploadQueue::uploadBuffer(rhi::IBuffer* buffer, uint32_t offset, Shared<const void> owner, const void* data, uint32_t size)
+	{
+		const char* src_data = (const char*)data;
+		uint64_t value = 0;
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		for (uint32_t dataOffset = 0; dataOffset < size; dataOffset += ASYNC_UPLOAD_JOB_SIZE)
+		{
+			Job job;
+			job.buffer = buffer;
+			job.offset = offset + dataOffset;
+			job.alignment = ASYNC_UPLOAD_ALIGNMENT;
+			job.owner = owner;
+			job.source = src_data + dataOffset;
+			job.size = std::min<uint32_t>(ASYNC_UPLOAD_JOB_SIZE, size - dataOffset);
+			value = pushJob(std::move(job));
+		}
+		m_Condition.notify_one();
+		return value;
+	}
+
+	uint64_t AsyncUploadQueue::uploadTexture(rhi::ITexture* texture, const void* data)
+	{
+		const rhi::TextureDescription& desc = texture->getDescription();
+		std::vector<rhi::SubresourceFootprint> footprints;
+		rhi::getTextureFootprints(desc, footprints);
+		uint32_t alignment = std::lcm(ASYNC_UPLOAD_ALIGNMENT, rhi::getFormatCopyAlignment(desc.format));
+
+		const char* src_data = (const char*)data;
+		uint64_t value = 0;
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		size_t first = 0;
+		while (first < footprints.size())
+		{
+			// Consecutive subresources share a job until it grows past the job size, footprint offsets stay in staging layout
+			uint32_t baseOffset = footprints[first].offset;
+			size_t last = first + 1;
+			while (last < footprints.size() && footprints[last].offset + footprints[last].size - baseOffset <= ASYNC_UPLOAD_JOB_SIZE)
+			{
+				++last;
+			}
+			SE_ASSERT(footprints[last - 1].offset + footprints[last - 1].size - baseOffset <= m_StagingBufferAllocator->getSize(),
+				"Subresource does not fit into the async upload staging ring");
+
+			Job job;
+			job.texture = texture;
+			job.alignment = alignment;
+			job.data.resize(footprints[last - 1].offset + footprints[last - 1].size - baseOffset);
+			for (size_t i = first; i < last; ++i)
+			{
+				rhi::SubresourceFootprint footprint = footprints[i];
+				footprint.offset -= baseOffset;
+				memcpy(job.data.data() + footprint.offset, src_data, footprint.size);
+				src_data += footprint.size;
+				job.footprints.push_back(footprint);
+			}
+			value = pushJob(std::move(job));
+			first = last;
+		}
+
+		auto pending = std::find_if(m_PendingTextures.begin(), m_PendingTextures.end(),
+			[texture](const std::pair<rhi::ITexture*, uint64_t>& entry) { return entry.first == texture; });
+		if (pending != m_PendingTextures.end())
+		{
+			pending->second = value;
+		}
+		else
+		{
+			m_PendingTextures.emplace_back(texture, value);
+		}
+
+		m_Condition.notify_one();
+		return value;
+	}
+
+	uint64_t AsyncUploadQueue::copyBuffer(rhi::IBuffer* dstBuffer, rhi::IBuffer* srcBuffer, const std::vector<rhi::BufferCopyRegion>& regions)
+	{
+		Job job;
+		job.buffer = dstBuffer;
+		job.srcBuffer = srcBuffer;
+		job.regions = regions;
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		uint64_t value = pushJob(std::move(job));
+		m_Condition.notify_one();
+		return value;
+	}
+
+	void AsyncUploadQueue::waitForSubmission(uint64_t uploadValue)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_SubmitCondition.wait(lock, [&]() { return m_SubmittedValue >= uploadValue; });
+	}
+
+	void AsyncUploadQueue::takeUploadedTextures(uint64_t uploadValue, std::vector<rhi::ITexture*>& textures)
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		auto end = std::remove_if(m_PendingTextures.begin(), m_PendingTextures.end(),
+			[&](const std::pair<rhi::ITexture*, uint64_t>& entry)
+			{
+				if (entry.second > uploadValue)
+				{
+					return false;
+				}
+				textures.push_back(entry.first);
+				return true;
+			});
+		m_PendingTextures.erase(end, m_PendingTextures.end());
+	}
+
+	AsyncUploadStats AsyncUploadQueue::getStats() const
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		AsyncUploadStats stats;
+		stats.pendingJobs = (uint32_t)m_Jobs.size();
+		stats.pendingBytes = m_PendingBytes;
+		stats.submittedValue = m_SubmittedValue;
+		stats.completedValue = m_Fence->getCompletedValue();
+		return stats;
+	}
+
+	uint64_t AsyncUploadQueue::pushJob(Job&& job)
+	{
+		job.value = ++m_NextValue;
+		if (!job.owner)
+		{
+			job.size = (uint32_t)job.data.size();
+		}
+		m_PendingBytes += job.size;
+		m_Jobs.push_back(std::move(job));
+		return m_NextValue;
+	}
+
+	void AsyncUploadQueue::run()
+	{
+		SE_INIT_THREAD_ALLOC();
+		std::deque<Job> jobs;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Condition.wait(lock, [&]() { return m_Stop || !m_Jobs.empty(); });
+				if (m_Jobs.empty())
+				{
+					break;
+				}
+				jobs.swap(m_Jobs);
+			}
+
+			std::lock_guard<std::mutex> recordLock(m_RecordMutex);
+			for (Job& job : jobs)
+			{
+				record(job);
+			}
+			jobs.clear();
+
+			submit();
+			m_StagingBufferAllocator->retire();
+		}
+	}
+
+	rhi::ICommandList* AsyncUploadQueue::beginRecording()
+	{
+		CommandContext& context = m_Contexts[m_CurrentContext];
+		if (!m_Recording)
+		{
+			m_Fence->wait(context.fenceValue);
+			context.commandList->resetAllocator();
+			context.commandList->begin();
+			m_Recording = true;
+		}
+		return context.commandList.get();
+	}
+
+	void AsyncUploadQueue::record(Job& job)
+	{
+		if (job.srcBuffer)
+		{
+			// Earlier copies may write the source, later ones may overwrite the destination
+			rhi::ICommandList* commandList = beginRecording();
+			commandList->globalBarrier(rhi::ResourceAccessFlags::TransferDst, rhi::ResourceAccessFlags::MaskTransferAccess);
+			commandList->copyBuffer(job.buffer, job.srcBuffer, (uint32_t)job.regions.size(), job.regions.data());
+			commandList->globalBarrier(rhi::ResourceAccessFlags::TransferDst, rhi::ResourceAccessFlags::MaskTransferAccess);
+			m_RecordedValue = job.value;
+			return;
+		}
+
+		uint32_t size = job.size;
+		StagingBuffer staging_buffer;
+		while (!m_StagingBufferAllocator->allocate(size, job.alignment, staging_buffer))
+		{
+			// The ring may be full of copies that were recorded but never submitted
+			if (m_Recording)
+			{
+				submit();
+			}
+			else if (!m_StagingBufferAllocator->waitForSpace())
+			{
+				SE_ASSERT(false, "Async upload does not fit into the staging ring");
+				return;
+			}
+		}
+
+		rhi::ICommandList* commandList = beginRecording();
+		memcpy(m_StagingBufferAllocator->getCpuAddress(staging_buffer), job.owner ? job.source : job.data.data(), size);
+		staging_buffer.buffer->flush(staging_buffer.offset, size);
+
+		if (job.texture)
+		{
+			commandList->copyBufferToTexture(job.texture, staging_buffer.buffer, staging_buffer.offset,
+				(uint32_t)job.footprints.size(), job.footprints.data());
+		}
+		else
+		{
+			commandList->copyBuffer(job.buffer, job.offset, staging_buffer.buffer, staging_buffer.offset, size);
+		}
+		m_RecordedValue = job.value;
+		job.owner.reset();
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_PendingBytes -= size;
+	}
+
+	void AsyncUploadQueue::submit()
+	{
+		if (!m_Recording)
+		{
+			return;
+		}
+
+		CommandContext& context = m_Contexts[m_CurrentContext];
+		context.commandList->end();
+		context.commandList->signal(m_Fence.get(), m_RecordedValue);
+		context.commandList->submit();
+		context.fenceValue = m_RecordedValue;
+		m_StagingBufferAllocator->endBatch(m_RecordedValue);
+
+		m_CurrentContext = (m_CurrentContext + 1) % (uint32_t)m_Contexts.size();
+		m_Recording = false;
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_SubmittedValue = m_RecordedValue;
+		}
+		m_SubmitCondition.notify_all();
+	}
+}
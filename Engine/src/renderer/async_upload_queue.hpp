@@ -0,0 +1,102 @@
+#pragma once
+#include "../rhi/rhi.hpp"
+#include "engine_core.h"
+#include "staging_buffer_allocator.hpp"
+#include <array>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace SE
+{
+	class Renderer;
+
+	struct AsyncUploadStats
+	{
+		uint32_t pendingJobs = 0;
+		uint64_t pendingBytes = 0;
+		uint64_t submittedValue = 0;
+		uint64_t completedValue = 0;
+	};
+
+	// Streams uploads on the copy queue from its own thread, independent of the frame loop. Every upload returns the
+	// value the upload fence reaches once its data is on the GPU; consumers wait on it the first time they use the resource.
+	class AsyncUploadQueue
+	{
+	public:
+		AsyncUploadQueue(Renderer* pRenderer, uint32_t stagingSize);
+		~AsyncUploadQueue();
+
+		// Thread safe, the data is copied before returning
+		uint64_t uploadBuffer(rhi::IBuffer* buffer, uint32_t offset, const void* data, uint32_t size);
+		// Thread safe, data is read straight into staging memory and owner is kept alive until then
+		uint64_t uploadBuffer(rhi::IBuffer* buffer, uint32_t offset, Shared<const void> owner, const void* data, uint32_t size);
+		// data holds every subresource in subresource order with tightly packed rows
+		uint64_t uploadTexture(rhi::ITexture* texture, const void* data);
+		// GPU copy ordered after every upload queued before it, and before every upload queued after it
+		uint64_t copyBuffer(rhi::IBuffer* dstBuffer, rhi::IBuffer* srcBuffer, const std::vector<rhi::BufferCopyRegion>& regions);
+
+		rhi::IFence* getFence() const { return m_Fence.get(); }
+		// Blocks until the copy signaling uploadValue was handed to the copy queue, so GPU waits never precede their signal
+		void waitForSubmission(uint64_t uploadValue);
+		bool isComplete(uint64_t uploadValue) const { return m_Fence->getCompletedValue() >= uploadValue; }
+		// Textures whose last upload is at or below uploadValue, they are left in TransferDst for the consumer to transition
+		void takeUploadedTextures(uint64_t uploadValue, std::vector<rhi::ITexture*>& textures);
+		AsyncUploadStats getStats() const;
+		// Keeps the upload thread from touching staging memory while the lock is held, e.g. during defragmentation
+		std::unique_lock<std::mutex> suspend() { return std::unique_lock<std::mutex>(m_RecordMutex); }
+
+	private:
+		struct Job
+		{
+			rhi::IBuffer* buffer = nullptr;
+			rhi::ITexture* texture = nullptr;
+			rhi::IBuffer* srcBuffer = nullptr; // buffer to buffer copy of regions, no staging
+			std::vector<rhi::BufferCopyRegion> regions;
+			uint32_t offset = 0;
+			uint32_t alignment = 0;
+			std::vector<rhi::SubresourceFootprint> footprints;
+			std::vector<char> data;
+			Shared<const void> owner; // keeps source alive instead of a copy in data
+			const char* source = nullptr;
+			uint32_t size = 0;
+			uint64_t value = 0;
+		};
+
+		struct CommandContext
+		{
+			Scoped<rhi::ICommandList> commandList;
+			uint64_t fenceValue = 0;
+		};
+
+		uint64_t pushJob(Job&& job);
+		void run();
+		void record(Job& job);
+		rhi::ICommandList* beginRecording();
+		void submit();
+
+	private:
+		Renderer* m_Renderer = nullptr;
+		Scoped<rhi::IFence> m_Fence;
+		Scoped<StagingBufferAllocator> m_StagingBufferAllocator;
+
+		std::thread m_Thread;
+		mutable std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+		std::condition_variable m_SubmitCondition;
+		std::deque<Job> m_Jobs;
+		std::vector<std::pair<rhi::ITexture*, uint64_t>> m_PendingTextures;
+		uint64_t m_NextValue = 0;
+		uint64_t m_PendingBytes = 0;
+		uint64_t m_SubmittedValue = 0;
+		bool m_Stop = false;
+
+		// Owned by the upload thread
+		std::mutex m_RecordMutex;
+		std::array<CommandContext, 4> m_Contexts;
+		uint32_t m_CurrentContext = 0;
+		bool m_Recording = false;
+		uint64_t m_RecordedValue = 0;
+	};
+}
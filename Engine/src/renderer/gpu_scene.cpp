@@ -1,60 +1,563 @@
 #include "gpu_scene.hpp"
 #include "renderer.hpp"
+#include "meshlet_builder.hpp"
+#include "vertex_compression.hpp"
 #include "utils/math.hpp"
 
-#define MAX_CONSTANT_BUFFER_SIZE (8 * 1024 * 1024)
+#define INITIAL_CONSTANT_BUFFER_SIZE (1024 * 1024)
 #define ALLOCATION_ALIGNMENT (4)
+#define INITIAL_INSTANCE_CAPACITY (1024)
+// Dirty runs at least this long are copied, shorter ones go through the scatter shader
+#define INSTANCE_COPY_RUN_MIN (8)
+#define INSTANCE_SCATTER_GROUP_SIZE (64)
+// The allocator covers the whole address range, the buffer grows to back the allocations as they come
+#define STATIC_BUFFER_INITIAL_SIZE MB(64)
+#define STATIC_BUFFER_MAX_SIZE MB(2048)
+#define STATIC_DEFRAG_BYTES_PER_FRAME MB(8)
 namespace SE
 {
 	GpuScene::GpuScene(Renderer* renderer) : m_pRenderer(renderer)
 	{
 		rhi::BufferDescription bufferDesc;
-		uint32_t staticBuffSize = MB(200);
-		m_pSceneStaticBuffer.reset(m_pRenderer->createRawBuffer(nullptr, staticBuffSize, "GPU_SCENE::StaticBuffer", rhi::MemoryType::GpuOnly));
-		m_pSceneStaticBufferAllocator = createScoped<OffsetAllocator::Allocator>(staticBuffSize);
+		// With resizable BAR or UMA the scene data is written straight into VRAM
+		rhi::MemoryType staticMemoryType = renderer->getDevice()->isDirectUploadSupported() ? rhi::MemoryType::GpuUpload : rhi::MemoryType::GpuOnly;
+		m_pSceneStaticBuffer.reset(m_pRenderer->createRawBuffer(nullptr, STATIC_BUFFER_INITIAL_SIZE, "GPU_SCENE::StaticBuffer", staticMemoryType));
+		m_pSceneStaticBufferAllocator = createScoped<OffsetAllocator::Allocator>(STATIC_BUFFER_MAX_SIZE);
 
 		for (int i = 0; i < SE_MAX_FRAMES_IN_FLIGHT; ++i)
 		{
-			m_pConstantBuffer[i].reset(renderer->createRawBuffer(nullptr, MAX_CONSTANT_BUFFER_SIZE, "GPU_SCENE::ConstantBuffer", rhi::MemoryType::CpuToGpu));
+			m_pConstantBuffer[i].reset(renderer->createRawBuffer(nullptr, INITIAL_CONSTANT_BUFFER_SIZE, "GPU_SCENE::ConstantBuffer", rhi::MemoryType::CpuToGpu));
 			m_pConstantBuffer[i]->getBuffer()->map();
 		}
+
+		growInstanceBuffer(INITIAL_INSTANCE_CAPACITY);
+
+		rhi::ComputePipelineDescription scatterDesc;
+		scatterDesc.computeShader = m_pRenderer->getShaderCache()->getShader("instanceScatter.hlsl", "CSMain", rhi::ShaderType::Compute, {});
+		m_pInstanceScatterPipeline.reset(renderer->getDevice()->createComputePipelineState(scatterDesc, "GPU_SCENE::InstanceScatter"));
 	}
 	GpuScene::~GpuScene()
 	{
 	}
 	OffsetAllocator::Allocation GpuScene::allocateStaticBuffer(uint32_t size)
 	{
-		return m_pSceneStaticBufferAllocator->allocate(alignToPowerOfTwo<uint32_t>(size, ALLOCATION_ALIGNMENT));
+		size = alignToPowerOfTwo<uint32_t>(size, ALLOCATION_ALIGNMENT);
+		OffsetAllocator::Allocation allocation = m_pSceneStaticBufferAllocator->allocate(size);
+		if (allocation.offset != OffsetAllocator::Allocation::NO_SPACE &&
+			allocation.offset + size > m_pSceneStaticBuffer->getBuffer()->getDescription().size)
+		{
+			growStaticBuffer(allocation.offset + size);
+		}
+		return allocation;
 	}
 	void GpuScene::freeStaticBuffer(OffsetAllocator::Allocation alloc)
 	{
-		if (alloc.offset >= m_pSceneStaticBuffer->getBuffer()->getDescription().size)
+		if (alloc.offset == OffsetAllocator::Allocation::NO_SPACE)
 		{
 			return;
 		}
-		m_pSceneStaticBufferAllocator->free(alloc);
+		m_StaticFrees.push_back(alloc);
 	}
 
 	uint32_t GpuScene::allocateConstantBuffer(uint32_t size)
 	{
-		SE_ASSERT(m_ConstantBufferOffset + size <= MAX_CONSTANT_BUFFER_SIZE);
+		uint32_t frame_index = m_pRenderer->getFrameID() % SE_MAX_FRAMES_IN_FLIGHT;
+		rhi::IBuffer* buffer = m_pConstantBuffer[frame_index]->getBuffer();
+		if (m_ConstantBufferOffset + size > buffer->getDescription().size)
+		{
+			growConstantBuffer(frame_index, m_ConstantBufferOffset + size);
+		}
 
 		uint32_t address = m_ConstantBufferOffset;
 		m_ConstantBufferOffset += alignToPowerOfTwo<uint32_t>(size, ALLOCATION_ALIGNMENT);
+		m_ConstantBufferHighWater = std::max(m_ConstantBufferHighWater, m_ConstantBufferOffset);
 
 		return address;
 	}
-	uint32_t GpuScene::addInstance(const InstanceData& data)
+
+	void GpuScene::growConstantBuffer(uint32_t frameIndex, uint32_t requiredSize)
+	{
+		// The SRV is read when the frame's global constants are set, so the data written so far moves along
+		RawBuffer* oldBuffer = m_pConstantBuffer[frameIndex].get();
+		uint32_t size = std::max((uint32_t)oldBuffer->getBuffer()->getDescription().size * 2, alignToPowerOfTwo<uint32_t>(requiredSize, INITIAL_CONSTANT_BUFFER_SIZE));
+
+		RawBuffer* buffer = m_pRenderer->createRawBuffer(nullptr, size, "GPU_SCENE::ConstantBuffer", rhi::MemoryType::CpuToGpu);
+		buffer->getBuffer()->map();
+		memcpy(buffer->getBuffer()->getCpuAddress(), oldBuffer->getBuffer()->getCpuAddress(), m_ConstantBufferOffset);
+
+		m_pConstantBuffer[frameIndex].reset(buffer);
+	}
+	void GpuScene::growStaticBuffer(uint32_t requiredSize)
+	{
+		RawBuffer* oldBuffer = m_pSceneStaticBuffer.get();
+		const rhi::BufferDescription& oldDesc = oldBuffer->getBuffer()->getDescription();
+		uint32_t oldSize = (uint32_t)oldDesc.size;
+		uint32_t size = std::min<uint32_t>(std::max(oldSize * 2, alignToPowerOfTwo<uint32_t>(requiredSize, STATIC_BUFFER_INITIAL_SIZE)), STATIC_BUFFER_MAX_SIZE);
+
+		RawBuffer* buffer = m_pRenderer->createRawBuffer(nullptr, size, "GPU_SCENE::StaticBuffer", oldDesc.memoryType);
+		SE_ASSERT(buffer, "Static buffer growth failed");
+
+		// Ordered with the async uploads, those queued before still land in the old buffer and are carried over.
+		// Mapped VRAM is write combined, reading the old contents back on the CPU would stall for seconds
+		rhi::BufferCopyRegion region;
+		region.srcOffset = 0;
+		region.dstOffset = 0;
+		region.size = oldSize;
+		uint64_t uploadValue = m_pRenderer->getAsyncUploadQueue()->copyBuffer(buffer->getBuffer(), oldBuffer->getBuffer(), { region });
+		trackStaticUpload(uploadValue);
+		m_RequiredUploadValue = std::max(m_RequiredUploadValue, uploadValue);
+
+		RetiredStaticBuffer retired;
+		retired.buffer = std::move(m_pSceneStaticBuffer);
+		retired.uploadValue = uploadValue;
+		m_RetiredStaticBuffers.push_back(std::move(retired));
+
+		m_pSceneStaticBuffer.reset(buffer);
+		m_DefragmentStaticBuffer = true;
+	}
+
+	void GpuScene::defragmentStaticBuffer()
+	{
+		struct Candidate
+		{
+			uint32_t offset;
+			uint32_t slot;
+			uint32_t index;
+		};
+		std::vector<Candidate> candidates;
+		for (uint32_t slot : m_InstanceSlotIndices)
+		{
+			const std::vector<OffsetAllocator::Allocation>& allocations = m_InstanceSlots[slot].allocations;
+			for (uint32_t i = 0; i < (uint32_t)allocations.size(); ++i)
+			{
+				candidates.push_back({ allocations[i].offset, slot, i });
+			}
+		}
+		// Highest allocations move first, into the lowest holes that fit them
+		std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) { return a.offset > b.offset; });
+
+		std::vector<rhi::BufferCopyRegion> regions;
+		uint32_t budget = STATIC_DEFRAG_BYTES_PER_FRAME;
+		for (const Candidate& candidate : candidates)
+		{
+			OffsetAllocator::Allocation from = m_InstanceSlots[candidate.slot].allocations[candidate.index];
+			uint32_t size = m_pSceneStaticBufferAllocator->allocationSize(from);
+			if (size > budget && !regions.empty())
+			{
+				break;
+			}
+
+			OffsetAllocator::Allocation to = m_pSceneStaticBufferAllocator->allocate(size);
+			if (to.offset == OffsetAllocator::Allocation::NO_SPACE || to.offset >= from.offset)
+			{
+				// Never used, no need to defer the free. A smaller allocation further down may still fit a hole
+				m_pSceneStaticBufferAllocator->free(to);
+				continue;
+			}
+
+			StaticRelocation relocation;
+			relocation.slot = candidate.slot;
+			relocation.generation = m_InstanceSlots[candidate.slot].generation;
+			relocation.index = candidate.index;
+			relocation.from = from;
+			relocation.to = to;
+			m_StaticRelocations.push_back(relocation);
+
+			rhi::BufferCopyRegion region;
+			region.srcOffset = from.offset;
+			region.dstOffset = to.offset;
+			region.size = size;
+			regions.push_back(region);
+			budget -= std::min(budget, size);
+		}
+
+		// Only a full pass without a single move means the buffer is compact
+		if (regions.empty())
+		{
+			m_DefragmentStaticBuffer = false;
+			return;
+		}
+
+		// Frames in flight only read the old ranges, the new ones are unused until patched
+		rhi::IBuffer* buffer = m_pSceneStaticBuffer->getBuffer();
+		m_RelocationUploadValue = m_pRenderer->getAsyncUploadQueue()->copyBuffer(buffer, buffer, regions);
+	}
+
+	void GpuScene::patchStaticRelocations()
+	{
+		if (m_StaticRelocations.empty() || !m_pRenderer->getAsyncUploadQueue()->isComplete(m_RelocationUploadValue))
+		{
+			return;
+		}
+
+		for (const StaticRelocation& relocation : m_StaticRelocations)
+		{
+			InstanceSlot& slot = m_InstanceSlots[relocation.slot];
+			if (slot.generation != relocation.generation || slot.allocations[relocation.index].offset != relocation.from.offset)
+			{
+				// Removed while the copy was in flight, the old range was freed with the instance
+				freeStaticBuffer(relocation.to);
+				continue;
+			}
+
+			InstanceData& data = m_InstanceData[slot.denseIndex];
+			uint32_t* addresses[] = { &data.vertexBufferAddress, &data.indexBufferAddress, &data.meshletBufferAddress,
+				&data.meshletVertexBufferAddress, &data.meshletTriangleBufferAddress };
+			for (uint32_t* address : addresses)
+			{
+				if (*address == relocation.from.offset)
+				{
+					*address = relocation.to.offset;
+				}
+			}
+			markInstanceDirty(slot.denseIndex);
+
+			slot.allocations[relocation.index] = relocation.to;
+			freeStaticBuffer(relocation.from);
+			m_RelocatedBytes += m_pSceneStaticBufferAllocator->allocationSize(relocation.to);
+		}
+		m_StaticRelocations.clear();
+	}
+
+	StaticBufferStats GpuScene::getStaticBufferStats() const
+	{
+		OffsetAllocator::StorageReport report = m_pSceneStaticBufferAllocator->storageReport();
+		StaticBufferStats stats;
+		stats.bufferSize = (uint32_t)m_pSceneStaticBuffer->getBuffer()->getDescription().size;
+		stats.usedSize = STATIC_BUFFER_MAX_SIZE - report.totalFreeSpace;
+		stats.pendingRelocations = (uint32_t)m_StaticRelocations.size();
+		stats.relocatedBytes = m_RelocatedBytes;
+		return stats;
+	}
+
+	void GpuScene::uploadMesh(const VertexStreams& streams, const uint32_t* indices, uint32_t indexCount, InstanceData& data, std::vector<OffsetAllocator::Allocation>* allocations)
+	{
+		Shared<PackedMesh> mesh = createShared<PackedMesh>();
+		mesh->data = data;
+		packMesh(streams, indices, indexCount, *mesh);
+		uploadMesh(mesh, allocations);
+		data = mesh->data;
+	}
+
+	void GpuScene::packMesh(const VertexStreams& streams, const uint32_t* indices, uint32_t indexCount, PackedMesh& mesh)
+	{
+		packVertices(streams, mesh.vertices, mesh.data);
+		packIndices(indices, indexCount, streams.vertexCount, mesh.indices, mesh.data);
+		buildMeshlets(streams.positions, streams.vertexCount, indices, indexCount, mesh.meshlets);
+	}
+
+	void GpuScene::uploadMesh(const Shared<PackedMesh>& mesh, std::vector<OffsetAllocator::Allocation>* allocations)
+	{
+		// Only the arrays are read by the upload thread, the instance fields are ours to fill
+		InstanceData& data = mesh->data;
+		const MeshletData& meshlets = mesh->meshlets;
+		OffsetAllocator::Allocation vertexAllocation = uploadStatic(mesh, mesh->vertices.data(), sizeof(PackedVertex) * (uint32_t)mesh->vertices.size());
+		OffsetAllocator::Allocation indexAllocation = uploadStatic(mesh, mesh->indices.data(), sizeof(uint32_t) * (uint32_t)mesh->indices.size());
+		data.vertexBufferAddress = vertexAllocation.offset;
+		data.indexBufferAddress = indexAllocation.offset;
+		if (allocations)
+		{
+			allocations->push_back(vertexAllocation);
+			allocations->push_back(indexAllocation);
+		}
+
+		data.meshletCount = (uint32_t)meshlets.meshlets.size();
+		if (data.meshletCount == 0)
+		{
+			return;
+		}
+
+		OffsetAllocator::Allocation meshletAllocation = uploadStatic(mesh, meshlets.meshlets.data(), sizeof(Meshlet) * (uint32_t)meshlets.meshlets.size());
+		OffsetAllocator::Allocation meshletVertexAllocation = uploadStatic(mesh, meshlets.vertices.data(), sizeof(uint32_t) * (uint32_t)meshlets.vertices.size());
+		OffsetAllocator::Allocation triangleAllocation = uploadStatic(mesh, meshlets.triangles.data(), sizeof(uint32_t) * (uint32_t)meshlets.triangles.size());
+		data.meshletBufferAddress = meshletAllocation.offset;
+		data.meshletVertexBufferAddress = meshletVertexAllocation.offset;
+		data.meshletTriangleBufferAddress = triangleAllocation.offset;
+
+		if (allocations)
+		{
+			allocations->push_back(meshletAllocation);
+			allocations->push_back(meshletVertexAllocation);
+			allocations->push_back(triangleAllocation);
+		}
+	}
+
+	OffsetAllocator::Allocation GpuScene::uploadStatic(const Shared<const void>& owner, const void* data, uint32_t size)
+	{
+		OffsetAllocator::Allocation allocation = allocateStaticBuffer(size);
+		writeStatic(allocation.offset, owner, data, size);
+		return allocation;
+	}
+
+	void GpuScene::writeStatic(uint32_t offset, const Shared<const void>& owner, const void* data, uint32_t size)
+	{
+		rhi::IBuffer* buffer = getSceneStaticBuffer();
+		uint64_t uploadValue = 0;
+		if (m_RetiredStaticBuffers.empty())
+		{
+			uploadValue = owner ? m_pRenderer->uploadBufferAsync(buffer, offset, owner, data, size) : m_pRenderer->uploadBufferAsync(buffer, offset, data, size);
+		}
+		else
+		{
+			// A direct write into mapped VRAM could land before the copy into the grown buffer and be overwritten by it
+			AsyncUploadQueue* asyncUploadQueue = m_pRenderer->getAsyncUploadQueue();
+			uploadValue = owner ? asyncUploadQueue->uploadBuffer(buffer, offset, owner, data, size) : asyncUploadQueue->uploadBuffer(buffer, offset, data, size);
+		}
+		trackStaticUpload(uploadValue);
+	}
+
+	void GpuScene::uploadMeshlets(const MeshletData& meshlets, InstanceData& data, std::vector<OffsetAllocator::Allocation>* allocations)
 	{
+		data.meshletCount = (uint32_t)meshlets.meshlets.size();
+		if (data.meshletCount == 0)
+		{
+			return;
+		}
+
+		OffsetAllocator::Allocation meshletAllocation = m_pRenderer->allocateSceneStaticBuffer(meshlets.meshlets.data(), sizeof(Meshlet) * (uint32_t)meshlets.meshlets.size());
+		OffsetAllocator::Allocation vertexAllocation = m_pRenderer->allocateSceneStaticBuffer(meshlets.vertices.data(), sizeof(uint32_t) * (uint32_t)meshlets.vertices.size());
+		OffsetAllocator::Allocation triangleAllocation = m_pRenderer->allocateSceneStaticBuffer(meshlets.triangles.data(), sizeof(uint32_t) * (uint32_t)meshlets.triangles.size());
+		data.meshletBufferAddress = meshletAllocation.offset;
+		data.meshletVertexBufferAddress = vertexAllocation.offset;
+		data.meshletTriangleBufferAddress = triangleAllocation.offset;
+
+		if (allocations)
+		{
+			allocations->push_back(meshletAllocation);
+			allocations->push_back(vertexAllocation);
+			allocations->push_back(triangleAllocation);
+		}
+	}
+
+	InstanceHandle GpuScene::addInstance(const InstanceData& data, const std::vector<OffsetAllocator::Allocation>& allocations)
+	{
+		m_MaxInstanceMeshletCount = std::max(m_MaxInstanceMeshletCount, data.meshletCount);
+		m_MaxInstanceIndexCount = std::max(m_MaxInstanceIndexCount, data.indexCount);
 		m_InstanceData.push_back(data);
+		m_RequiredUploadValue = m_StaticUploadValue;
 		uint32_t instance_id = (uint32_t)m_InstanceData.size() - 1;
+		markInstanceDirty(instance_id);
+
+		uint32_t slotIndex;
+		if (!m_FreeInstanceSlots.empty())
+		{
+			slotIndex = m_FreeInstanceSlots.back();
+			m_FreeInstanceSlots.pop_back();
+		}
+		else
+		{
+			slotIndex = (uint32_t)m_InstanceSlots.size();
+			m_InstanceSlots.emplace_back();
+		}
+
+		InstanceSlot& slot = m_InstanceSlots[slotIndex];
+		slot.denseIndex = instance_id;
+		slot.allocations = allocations;
+		m_InstanceSlotIndices.push_back(slotIndex);
+
+		InstanceHandle handle;
+		handle.slot = slotIndex;
+		handle.generation = slot.generation;
+		return handle;
+	}
+	void GpuScene::updateInstance(InstanceHandle handle, const InstanceData& data)
+	{
+		SE_ASSERT(isValid(handle), "Stale instance handle");
+		uint32_t instance_id = m_InstanceSlots[handle.slot].denseIndex;
+
+		m_MaxInstanceMeshletCount = std::max(m_MaxInstanceMeshletCount, data.meshletCount);
+		m_MaxInstanceIndexCount = std::max(m_MaxInstanceIndexCount, data.indexCount);
+		m_InstanceData[instance_id] = data;
+		m_RequiredUploadValue = m_StaticUploadValue;
+		markInstanceDirty(instance_id);
+	}
+	void GpuScene::removeInstance(InstanceHandle handle)
+	{
+		SE_ASSERT(isValid(handle), "Stale instance handle");
+		InstanceSlot& slot = m_InstanceSlots[handle.slot];
+		uint32_t instance_id = slot.denseIndex;
+		uint32_t last_id = (uint32_t)m_InstanceData.size() - 1;
+
+		if (instance_id != last_id)
+		{
+			m_InstanceData[instance_id] = m_InstanceData[last_id];
+			m_InstanceSlotIndices[instance_id] = m_InstanceSlotIndices[last_id];
+			m_InstanceSlots[m_InstanceSlotIndices[instance_id]].denseIndex = instance_id;
+			markInstanceDirty(instance_id);
+		}
+		m_InstanceData.pop_back();
+		m_InstanceSlotIndices.pop_back();
+
+		for (const OffsetAllocator::Allocation& allocation : slot.allocations)
+		{
+			freeStaticBuffer(allocation);
+		}
+		slot.allocations.clear();
+		slot.denseIndex = uint32_t(-1);
+		++slot.generation;
+		m_FreeInstanceSlots.push_back(handle.slot);
+	}
+	bool GpuScene::isValid(InstanceHandle handle) const
+	{
+		return handle.slot < m_InstanceSlots.size() && m_InstanceSlots[handle.slot].generation == handle.generation &&
+			m_InstanceSlots[handle.slot].denseIndex != uint32_t(-1);
+	}
+	uint32_t GpuScene::getInstanceIndex(InstanceHandle handle) const
+	{
+		SE_ASSERT(isValid(handle), "Stale instance handle");
+		return m_InstanceSlots[handle.slot].denseIndex;
+	}
+	void GpuScene::markInstanceDirty(uint32_t instanceId)
+	{
+		if (instanceId / 64 >= m_DirtyInstanceMask.size())
+		{
+			m_DirtyInstanceMask.resize(instanceId / 64 + 1, 0);
+		}
+
+		uint64_t bit = 1ull << (instanceId % 64);
+		if (!(m_DirtyInstanceMask[instanceId / 64] & bit))
+		{
+			m_DirtyInstanceMask[instanceId / 64] |= bit;
+			++m_DirtyInstanceCount;
+		}
+	}
+
+	void GpuScene::growInstanceBuffer(uint32_t requiredCount)
+	{
+		uint32_t capacity = std::max(m_InstanceCapacity * 2, requiredCount);
+		m_pInstanceBuffer.reset(m_pRenderer->createRawBuffer(nullptr, capacity * sizeof(InstanceData), "GPU_SCENE::InstanceBuffer", rhi::MemoryType::GpuOnly, true));
+		m_InstanceCapacity = capacity;
 
-		return instance_id;
+		// The new buffer starts empty, every live instance is written again
+		for (uint32_t i = 0; i < (uint32_t)m_InstanceData.size(); ++i)
+		{
+			markInstanceDirty(i);
+		}
 	}
-	void GpuScene::update()
+
+	void GpuScene::update(rhi::ICommandList* pCommandList)
 	{
+		m_pRenderer->waitForUpload(m_RequiredUploadValue);
+
+		// The frame slot's fence was waited on, nothing reads the ranges freed SE_MAX_FRAMES_IN_FLIGHT frames ago
+		uint32_t frame_index = m_pRenderer->getFrameID() % SE_MAX_FRAMES_IN_FLIGHT;
+		for (const OffsetAllocator::Allocation& allocation : m_PendingStaticFrees[frame_index])
+		{
+			m_pSceneStaticBufferAllocator->free(allocation);
+		}
+		m_PendingStaticFrees[frame_index].swap(m_StaticFrees);
+		m_StaticFrees.clear();
+
+		AsyncUploadQueue* asyncUploadQueue = m_pRenderer->getAsyncUploadQueue();
+		auto retired = std::remove_if(m_RetiredStaticBuffers.begin(), m_RetiredStaticBuffers.end(),
+			[&](const RetiredStaticBuffer& buffer) { return asyncUploadQueue->isComplete(buffer.uploadValue); });
+		m_RetiredStaticBuffers.erase(retired, m_RetiredStaticBuffers.end());
+
+		// Relocated instances are patched at the frame boundary, together with the rest of the instance upload
+		patchStaticRelocations();
+		if (m_DefragmentStaticBuffer && m_StaticRelocations.empty())
+		{
+			defragmentStaticBuffer();
+		}
+
+		m_InstanceUploadStats = {};
+		if (m_DirtyInstanceCount == 0)
+		{
+			return;
+		}
+
 		uint32_t instance_count = (uint32_t)m_InstanceData.size();
-		m_InstanceDataAddress = m_pRenderer->allocateSceneConstant(m_InstanceData.data(), sizeof(InstanceData) * instance_count);
+		if (instance_count > m_InstanceCapacity)
+		{
+			growInstanceBuffer(instance_count);
+		}
+
+		std::vector<rhi::BufferCopyRegion> regions;
+		std::vector<uint32_t> scatterIndices;
+		std::vector<InstanceData> scatterData;
+		auto flushRun = [&](uint32_t first, uint32_t count)
+		{
+			if (count >= INSTANCE_COPY_RUN_MIN)
+			{
+				rhi::BufferCopyRegion region;
+				region.srcOffset = m_pRenderer->allocateSceneConstant(&m_InstanceData[first], sizeof(InstanceData) * count);
+				region.dstOffset = first * sizeof(InstanceData);
+				region.size = sizeof(InstanceData) * count;
+				regions.push_back(region);
+				return;
+			}
+			for (uint32_t i = first; i < first + count; ++i)
+			{
+				scatterIndices.push_back(i);
+				scatterData.push_back(m_InstanceData[i]);
+			}
+		};
+
+		uint32_t runStart = 0;
+		uint32_t runCount = 0;
+		for (uint32_t word = 0; word < (uint32_t)m_DirtyInstanceMask.size(); ++word)
+		{
+			uint64_t mask = m_DirtyInstanceMask[word];
+			m_DirtyInstanceMask[word] = 0;
+			for (uint32_t bit = 0; mask != 0 || (runCount > 0 && bit < 64); ++bit)
+			{
+				uint32_t instanceId = word * 64 + bit;
+				bool dirty = (mask & 1) && instanceId < instance_count;
+				mask >>= 1;
+				if (dirty)
+				{
+					runStart = runCount == 0 ? instanceId : runStart;
+					++runCount;
+				}
+				else if (runCount > 0)
+				{
+					flushRun(runStart, runCount);
+					runCount = 0;
+				}
+			}
+		}
+		if (runCount > 0)
+		{
+			flushRun(runStart, runCount);
+		}
+		m_DirtyInstanceCount = 0;
+
+		InstanceScatterConstants scatterCB = {};
+		if (!scatterIndices.empty())
+		{
+			scatterCB.count = (uint32_t)scatterIndices.size();
+			scatterCB.indexAddress = m_pRenderer->allocateSceneConstant(scatterIndices.data(), sizeof(uint32_t) * scatterCB.count);
+			scatterCB.dataAddress = m_pRenderer->allocateSceneConstant(scatterData.data(), sizeof(InstanceData) * scatterCB.count);
+		}
+
+		// Recorded after all allocations, the constant buffer may have grown in between
+		rhi::IBuffer* instanceBuffer = m_pInstanceBuffer->getBuffer();
+		pCommandList->bufferBarrier(instanceBuffer, rhi::ResourceAccessFlags::MaskShaderRead,
+			rhi::ResourceAccessFlags::TransferDst | rhi::ResourceAccessFlags::ComputeShaderStorage);
+		if (!regions.empty())
+		{
+			pCommandList->copyBuffer(instanceBuffer, getSceneConstantBuffer(), (uint32_t)regions.size(), regions.data());
+		}
+		if (scatterCB.count > 0)
+		{
+			scatterCB.srcBufferSRV = getSceneConstantSRV()->getDescriptorArrayIndex();
+			scatterCB.instanceBufferUAV = m_pInstanceBuffer->getUAV()->getDescriptorArrayIndex();
+			pCommandList->bindPipeline(m_pInstanceScatterPipeline.get());
+			pCommandList->setComputeConstants(1, &scatterCB, sizeof(scatterCB));
+			pCommandList->dispatch((scatterCB.count + INSTANCE_SCATTER_GROUP_SIZE - 1) / INSTANCE_SCATTER_GROUP_SIZE, 1, 1);
+		}
+		pCommandList->bufferBarrier(instanceBuffer, rhi::ResourceAccessFlags::TransferDst | rhi::ResourceAccessFlags::ComputeShaderStorage,
+			rhi::ResourceAccessFlags::MaskShaderRead);
+
+		m_InstanceUploadStats.copyRegions = (uint32_t)regions.size();
+		m_InstanceUploadStats.scatteredInstances = scatterCB.count;
+		m_InstanceUploadStats.dirtyInstances = scatterCB.count;
+		for (const rhi::BufferCopyRegion& region : regions)
+		{
+			m_InstanceUploadStats.dirtyInstances += region.size / sizeof(InstanceData);
+			m_InstanceUploadStats.uploadBytes += region.size;
+		}
+		m_InstanceUploadStats.uploadBytes += scatterCB.count * (sizeof(InstanceData) + sizeof(uint32_t));
 	}
 
 	rhi::IBuffer* GpuScene::getSceneConstantBuffer() const
@@ -3,11 +3,52 @@
 #include "engine_core.h"
 #include "offsetAllocator/offsetAllocator.hpp"
 #include "renderer/resources/raw_buffer.hpp"
+#include "renderer/meshlet_builder.hpp"
 #include <gpu_scene.hlsli>
+#include <algorithm>
 
 namespace SE
 {
 	class Renderer;
+	struct VertexStreams;
+
+	struct InstanceUploadStats
+	{
+		uint32_t dirtyInstances = 0;
+		uint32_t copyRegions = 0; // contiguous dirty runs copied from the constant buffer
+		uint32_t scatteredInstances = 0; // isolated instances written by the scatter shader
+		uint64_t uploadBytes = 0;
+	};
+
+	struct StaticBufferStats
+	{
+		uint32_t bufferSize = 0;
+		uint32_t usedSize = 0;
+		uint32_t pendingRelocations = 0;
+		uint64_t relocatedBytes = 0;
+	};
+
+	// GPU layout of a mesh built off the render thread, data holds the dequantization fields and index flags
+	struct PackedMesh
+	{
+		std::vector<PackedVertex> vertices;
+		std::vector<uint32_t> indices;
+		MeshletData meshlets;
+		InstanceData data = {};
+	};
+
+	// Stays valid while the instance moves inside the dense instance array
+	struct InstanceHandle
+	{
+		uint32_t slot = uint32_t(-1);
+		uint32_t generation = 0;
+
+		bool isValid() const
+		{
+			return slot != uint32_t(-1);
+		}
+	};
+
 	class GpuScene
 	{
 	public:
@@ -15,13 +56,47 @@ namespace SE
 		~GpuScene();
 
 		OffsetAllocator::Allocation allocateStaticBuffer(uint32_t size);
+		// The range is reused once the frames in flight that may read it have completed
 		void freeStaticBuffer(OffsetAllocator::Allocation alloc);
+		// Moves instance owned allocations towards the start of the static buffer over the next frames
+		void requestStaticBufferDefragmentation() { m_DefragmentStaticBuffer = true; }
+		StaticBufferStats getStaticBufferStats() const;
 
+		// Per-frame scene constants, the frame's buffer grows when it runs out of space
 		uint32_t allocateConstantBuffer(uint32_t size);
+		uint32_t getConstantBufferHighWater() const { return m_ConstantBufferHighWater; }
+
+		// Uploads the meshlet arrays to the static buffer and fills the meshlet fields of the instance,
+		// the static buffer allocations are appended to allocations when given
+		void uploadMeshlets(const MeshletData& meshlets, InstanceData& data, std::vector<OffsetAllocator::Allocation>* allocations = nullptr);
 
-		uint32_t addInstance(const InstanceData& data);
+		// Packs the vertex streams and indices, builds the meshlets and uploads all of them to the static buffer.
+		// Fills the geometry fields of the instance, the allocations are appended to allocations when given
+		void uploadMesh(const VertexStreams& streams, const uint32_t* indices, uint32_t indexCount, InstanceData& data, std::vector<OffsetAllocator::Allocation>* allocations = nullptr);
+		// Thread safe, the CPU half of uploadMesh
+		static void packMesh(const VertexStreams& streams, const uint32_t* indices, uint32_t indexCount, PackedMesh& mesh);
+		// Streams the packed arrays to the static buffer straight from mesh, which is kept alive until they are staged,
+		// and fills the address fields of mesh->data
+		void uploadMesh(const Shared<PackedMesh>& mesh, std::vector<OffsetAllocator::Allocation>* allocations = nullptr);
+
+		// Writes into the static buffer, ordered behind a pending copy into a grown buffer. owner may be null, data is copied then
+		void writeStatic(uint32_t offset, const Shared<const void>& owner, const void* data, uint32_t size);
+		// Static data is uploaded asynchronously, instances added afterwards make the frame wait for it once
+		void trackStaticUpload(uint64_t uploadValue) { m_StaticUploadValue = std::max(m_StaticUploadValue, uploadValue); }
+		// allocations are owned by the instance and freed with it, defragmentation may move them and patch the instance
+		InstanceHandle addInstance(const InstanceData& data, const std::vector<OffsetAllocator::Allocation>& allocations = {});
+		void updateInstance(InstanceHandle handle, const InstanceData& data);
+		// The last instance moves into the freed spot, so instance ids stay dense
+		void removeInstance(InstanceHandle handle);
+		bool isValid(InstanceHandle handle) const;
+		// Index into the dense instance array read by shaders, changes when other instances are removed
+		uint32_t getInstanceIndex(InstanceHandle handle) const;
 		uint32_t getInstanceCount() const { return (uint32_t)m_InstanceData.size(); }
-		void update();
+		uint32_t getMaxInstanceMeshletCount() const { return m_MaxInstanceMeshletCount; }
+		uint32_t getMaxInstanceIndexCount() const { return m_MaxInstanceIndexCount; }
+		// Writes the instances changed since the last update into the persistent instance buffer
+		void update(rhi::ICommandList* pCommandList);
+		const InstanceUploadStats& getInstanceUploadStats() const { return m_InstanceUploadStats; }
 
 		rhi::IBuffer* getSceneStaticBuffer() const { return m_pSceneStaticBuffer->getBuffer(); }
 		rhi::IDescriptor* getSceneStaticBufferSRV() const { return m_pSceneStaticBuffer->getSRV(); }
@@ -29,19 +104,70 @@ namespace SE
 		rhi::IBuffer* getSceneConstantBuffer() const;
 		rhi::IDescriptor* getSceneConstantSRV() const;
 
-		uint32_t getInstanceAddress() const { return m_InstanceDataAddress; }
+		rhi::IDescriptor* getInstanceBufferSRV() const { return m_pInstanceBuffer->getSRV(); }
 
 		void resetFrameData();
 	private:
+		void growConstantBuffer(uint32_t frameIndex, uint32_t requiredSize);
+		void markInstanceDirty(uint32_t instanceId);
+		void growInstanceBuffer(uint32_t requiredCount);
+		void growStaticBuffer(uint32_t requiredSize);
+		void defragmentStaticBuffer();
+		void patchStaticRelocations();
+		OffsetAllocator::Allocation uploadStatic(const Shared<const void>& owner, const void* data, uint32_t size);
+
 		Renderer* m_pRenderer = nullptr;
 
+		struct InstanceSlot
+		{
+			uint32_t denseIndex = uint32_t(-1);
+			uint32_t generation = 0;
+			std::vector<OffsetAllocator::Allocation> allocations;
+		};
+
 		std::vector<InstanceData> m_InstanceData;
-		uint32_t m_InstanceDataAddress = 0;
+		std::vector<uint32_t> m_InstanceSlotIndices; // slot of each dense instance
+		std::vector<InstanceSlot> m_InstanceSlots;
+		std::vector<uint32_t> m_FreeInstanceSlots;
+		std::vector<uint64_t> m_DirtyInstanceMask;
+		uint32_t m_DirtyInstanceCount = 0;
+		Scoped<RawBuffer> m_pInstanceBuffer;
+		uint32_t m_InstanceCapacity = 0;
+		Scoped<rhi::IPipelineState> m_pInstanceScatterPipeline;
+		InstanceUploadStats m_InstanceUploadStats;
+		uint32_t m_MaxInstanceMeshletCount = 0;
+		uint32_t m_MaxInstanceIndexCount = 0;
+		uint64_t m_StaticUploadValue = 0;
+		uint64_t m_RequiredUploadValue = 0;
 
 		Scoped<RawBuffer> m_pSceneStaticBuffer;
 		Scoped<OffsetAllocator::Allocator> m_pSceneStaticBufferAllocator;
+		// Frees since the last update, and those waiting for the frame slot's fence
+		std::vector<OffsetAllocator::Allocation> m_StaticFrees;
+		std::vector<OffsetAllocator::Allocation> m_PendingStaticFrees[SE::SE_MAX_FRAMES_IN_FLIGHT];
+
+		struct RetiredStaticBuffer
+		{
+			Scoped<RawBuffer> buffer;
+			uint64_t uploadValue = 0; // copy into the grown buffer
+		};
+		std::vector<RetiredStaticBuffer> m_RetiredStaticBuffers;
+
+		struct StaticRelocation
+		{
+			uint32_t slot = 0;
+			uint32_t generation = 0;
+			uint32_t index = 0;
+			OffsetAllocator::Allocation from;
+			OffsetAllocator::Allocation to;
+		};
+		std::vector<StaticRelocation> m_StaticRelocations;
+		uint64_t m_RelocationUploadValue = 0;
+		uint64_t m_RelocatedBytes = 0;
+		bool m_DefragmentStaticBuffer = false;
 
 		Scoped<RawBuffer> m_pConstantBuffer[SE::SE_MAX_FRAMES_IN_FLIGHT];
 		uint32_t m_ConstantBufferOffset = 0;
+		uint32_t m_ConstantBufferHighWater = 0;
 	};
 }
\ No newline at end of file
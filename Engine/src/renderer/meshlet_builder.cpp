@@ -0,0 +1,135 @@
+#include "meshlet_builder.hpp"
+
+namespace SE
+{
+	namespace
+	{
+		static void computeMeshletBounds(const glm::vec3* positions, const uint32_t* vertices, const uint32_t* triangles, Meshlet& meshlet)
+		{
+			glm::vec3 boundsMin(FLT_MAX);
+			glm::vec3 boundsMax(-FLT_MAX);
+			for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+			{
+				const glm::vec3& position = positions[vertices[meshlet.vertexOffset + i]];
+				boundsMin = glm::min(boundsMin, position);
+				boundsMax = glm::max(boundsMax, position);
+			}
+
+			glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+			float radius = 0.0f;
+			for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+			{
+				radius = glm::max(radius, glm::length(positions[vertices[meshlet.vertexOffset + i]] - center));
+			}
+
+			glm::vec3 normals[MAX_MESHLET_TRIANGLES];
+			glm::vec3 axis(0.0f);
+			uint32_t normalCount = 0;
+			for (uint32_t i = 0; i < meshlet.triangleCount; ++i)
+			{
+				uint32_t packed = triangles[meshlet.triangleOffset + i];
+				const glm::vec3& a = positions[vertices[meshlet.vertexOffset + (packed & 0xFF)]];
+				const glm::vec3& b = positions[vertices[meshlet.vertexOffset + ((packed >> 8) & 0xFF)]];
+				const glm::vec3& c = positions[vertices[meshlet.vertexOffset + ((packed >> 16) & 0xFF)]];
+
+				glm::vec3 normal = glm::cross(b - a, c - a);
+				float length = glm::length(normal);
+				if (length > 0.0f)
+				{
+					normals[normalCount] = normal / length;
+					axis += normals[normalCount];
+					++normalCount;
+				}
+			}
+
+			// Cutoff of 1 never passes the backface test in the amplification shader
+			float cutoff = 1.0f;
+			float axisLength = glm::length(axis);
+			if (normalCount > 0 && axisLength > 0.0f)
+			{
+				axis /= axisLength;
+
+				float minDot = 1.0f;
+				for (uint32_t i = 0; i < normalCount; ++i)
+				{
+					minDot = glm::min(minDot, glm::dot(axis, normals[i]));
+				}
+
+				// Cones wider than ~84 degrees reject almost nothing
+				if (minDot > 0.1f)
+				{
+					cutoff = glm::sqrt(1.0f - minDot * minDot);
+				}
+			}
+
+			meshlet.boundingSphere = float4(center.x, center.y, center.z, radius);
+			meshlet.cone = float4(axis.x, axis.y, axis.z, cutoff);
+		}
+	}
+
+	void buildMeshlets(const glm::vec3* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, MeshletData& output)
+	{
+		SE_ASSERT(indexCount % 3 == 0, "Meshlets require a triangle list");
+
+		output.meshlets.clear();
+		output.vertices.clear();
+		output.triangles.clear();
+
+		static const uint32_t INVALID_INDEX = ~0u;
+		std::vector<uint32_t> localIndices(vertexCount, INVALID_INDEX);
+
+		Meshlet meshlet = {};
+		auto finishMeshlet = [&]()
+		{
+			if (meshlet.triangleCount == 0)
+			{
+				return;
+			}
+
+			computeMeshletBounds(positions, output.vertices.data(), output.triangles.data(), meshlet);
+			output.meshlets.push_back(meshlet);
+
+			for (uint32_t i = 0; i < meshlet.vertexCount; ++i)
+			{
+				localIndices[output.vertices[meshlet.vertexOffset + i]] = INVALID_INDEX;
+			}
+
+			meshlet = {};
+			meshlet.vertexOffset = (uint32_t)output.vertices.size();
+			meshlet.triangleOffset = (uint32_t)output.triangles.size();
+		};
+
+		for (uint32_t i = 0; i < indexCount; i += 3)
+		{
+			const uint32_t* triangle = indices + i;
+
+			uint32_t newVertices = 0;
+			for (uint32_t j = 0; j < 3; ++j)
+			{
+				newVertices += localIndices[triangle[j]] == INVALID_INDEX ? 1 : 0;
+			}
+
+			if (meshlet.vertexCount + newVertices > MAX_MESHLET_VERTICES || meshlet.triangleCount + 1 > MAX_MESHLET_TRIANGLES)
+			{
+				finishMeshlet();
+			}
+
+			uint32_t packed = 0;
+			for (uint32_t j = 0; j < 3; ++j)
+			{
+				uint32_t& local = localIndices[triangle[j]];
+				if (local == INVALID_INDEX)
+				{
+					local = meshlet.vertexCount++;
+					output.vertices.push_back(triangle[j]);
+				}
+				packed |= local << (j * 8);
+			}
+
+			output.triangles.push_back(packed);
+			++meshlet.triangleCount;
+		}
+
+		finishMeshlet();
+	}
+}
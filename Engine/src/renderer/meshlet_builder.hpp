@@ -0,0 +1,20 @@
+#pragma once
+#include "engine_core.h"
+#include "glm/glm.hpp"
+#include "utils/math.hpp"
+#include <gpu_scene.hlsli>
+#include <vector>
+
+namespace SE
+{
+	struct MeshletData
+	{
+		std::vector<Meshlet> meshlets;
+		std::vector<uint32_t> vertices;  // instance vertex index per meshlet-local vertex
+		std::vector<uint32_t> triangles; // three 8-bit meshlet-local indices per triangle
+	};
+
+	// Greedily splits an indexed triangle list into meshlets of at most MAX_MESHLET_VERTICES/MAX_MESHLET_TRIANGLES
+	// and computes the bounding sphere and normal cone used for GPU culling
+	void buildMeshlets(const glm::vec3* positions, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, MeshletData& output);
+}
@@ -0,0 +1,112 @@
+#include "readback_manager.hpp"
+#include "renderer.hpp"
+
+#define READBACK_BUFFER_SIZE (16 * 1024 * 1024)
+
+namespace SE
+{
+	ReadbackManager::Request ReadbackManager::allocate(uint32_t size)
+	{
+		FrameRing& frame = m_Frames[m_Renderer->getFrameID() % SE_MAX_FRAMES_IN_FLIGHT];
+
+		// Oversized readbacks get a buffer of their own at the end of the ring
+		bool fits = frame.currentBuffer < frame.buffers.size() &&
+			frame.allocatedSize + size <= frame.buffers[frame.currentBuffer]->getDescription().size;
+		if (!fits)
+		{
+			if (frame.currentBuffer < frame.buffers.size() && frame.allocatedSize > 0)
+			{
+				frame.currentBuffer++;
+				frame.allocatedSize = 0;
+			}
+
+			if (frame.currentBuffer >= frame.buffers.size() ||
+				frame.buffers[frame.currentBuffer]->getDescription().size < size)
+			{
+				rhi::BufferDescription desc;
+				desc.size = std::max<uint32_t>(size, READBACK_BUFFER_SIZE);
+				desc.memoryType = rhi::MemoryType::GpuToCpu;
+				desc.mapped = true;
+				rhi::IBuffer* buffer = m_Renderer->getDevice()->createBuffer(desc, "ReadbackManager::m_Buffer");
+				frame.buffers.insert(frame.buffers.begin() + frame.currentBuffer, Scoped<rhi::IBuffer>(buffer));
+			}
+		}
+
+		Request request;
+		request.buffer = frame.buffers[frame.currentBuffer].get();
+		request.offset = frame.allocatedSize;
+		request.size = size;
+
+		frame.allocatedSize += SE::alignToPowerOfTwo<uint32_t>(size, 256);
+		return request;
+	}
+
+	void ReadbackManager::readbackBuffer(rhi::ICommandList* pCommandList, rhi::IBuffer* buffer, uint32_t offset, uint32_t size, ReadbackCallback callback)
+	{
+		Request request = allocate(size);
+		request.callback = std::move(callback);
+
+		pCommandList->copyBuffer(request.buffer, request.offset, buffer, offset, size);
+		pCommandList->bufferBarrier(request.buffer, rhi::ResourceAccessFlags::TransferDst, rhi::ResourceAccessFlags::HostRead);
+
+		m_Frames[m_Renderer->getFrameID() % SE_MAX_FRAMES_IN_FLIGHT].requests.push_back(std::move(request));
+	}
+
+	std::future<std::vector<uint8_t>> ReadbackManager::readbackBuffer(rhi::ICommandList* pCommandList, rhi::IBuffer* buffer, uint32_t offset, uint32_t size)
+	{
+		auto promise = std::make_shared<std::promise<std::vector<uint8_t>>>();
+		std::future<std::vector<uint8_t>> future = promise->get_future();
+		readbackBuffer(pCommandList, buffer, offset, size, makePromiseCallback(promise));
+		return future;
+	}
+
+	void ReadbackManager::readbackTexture(rhi::ICommandList* pCommandList, rhi::ITexture* texture, uint32_t mipLevel, uint32_t arraySlice, ReadbackCallback callback)
+	{
+		const rhi::TextureDescription& desc = texture->getDescription();
+		uint32_t width = std::max(desc.width >> mipLevel, 1u);
+		uint32_t height = std::max(desc.height >> mipLevel, 1u);
+		uint32_t depth = std::max(desc.depth >> mipLevel, 1u);
+		uint32_t size = rhi::getFormatRowPitch(desc.format, width) * height * depth;
+
+		Request request = allocate(size);
+		request.callback = std::move(callback);
+
+		pCommandList->copyTextureToBuffer(request.buffer, request.offset, texture, mipLevel, arraySlice);
+		pCommandList->bufferBarrier(request.buffer, rhi::ResourceAccessFlags::TransferDst, rhi::ResourceAccessFlags::HostRead);
+
+		m_Frames[m_Renderer->getFrameID() % SE_MAX_FRAMES_IN_FLIGHT].requests.push_back(std::move(request));
+	}
+
+	std::future<std::vector<uint8_t>> ReadbackManager::readbackTexture(rhi::ICommandList* pCommandList, rhi::ITexture* texture, uint32_t mipLevel, uint32_t arraySlice)
+	{
+		auto promise = std::make_shared<std::promise<std::vector<uint8_t>>>();
+		std::future<std::vector<uint8_t>> future = promise->get_future();
+		readbackTexture(pCommandList, texture, mipLevel, arraySlice, makePromiseCallback(promise));
+		return future;
+	}
+
+	void ReadbackManager::beginFrame()
+	{
+		FrameRing& frame = m_Frames[m_Renderer->getFrameID() % SE_MAX_FRAMES_IN_FLIGHT];
+
+		for (Request& request : frame.requests)
+		{
+			request.buffer->invalidate(request.offset, request.size);
+			const uint8_t* data = (const uint8_t*)request.buffer->getCpuAddress() + request.offset;
+			request.callback(data, request.size);
+		}
+		frame.requests.clear();
+
+		frame.currentBuffer = 0;
+		frame.allocatedSize = 0;
+	}
+
+	ReadbackCallback ReadbackManager::makePromiseCallback(std::shared_ptr<std::promise<std::vector<uint8_t>>> promise)
+	{
+		return [promise](const void* data, uint32_t size)
+		{
+			const uint8_t* bytes = (const uint8_t*)data;
+			promise->set_value(std::vector<uint8_t>(bytes, bytes + size));
+		};
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "../rhi/rhi.hpp"
+#include "engine_core.h"
+#include <functional>
+#include <future>
+
+namespace SE
+{
+	class Renderer;
+
+	using ReadbackCallback = std::function<void(const void* data, uint32_t size)>;
+
+	// Copies GPU data into persistently mapped GpuToCpu buffers and hands it to the CPU
+	// once the frame that recorded the copy has completed, so reading back never stalls.
+	// Copies must be recorded on command lists of the current frame.
+	class ReadbackManager
+	{
+	public:
+		ReadbackManager(Renderer* pRenderer) : m_Renderer(pRenderer) {};
+
+		void readbackBuffer(rhi::ICommandList* pCommandList, rhi::IBuffer* buffer, uint32_t offset, uint32_t size, ReadbackCallback callback);
+		std::future<std::vector<uint8_t>> readbackBuffer(rhi::ICommandList* pCommandList, rhi::IBuffer* buffer, uint32_t offset, uint32_t size);
+
+		// The texture must be in the TransferSrc state, rows are tightly packed
+		void readbackTexture(rhi::ICommandList* pCommandList, rhi::ITexture* texture, uint32_t mipLevel, uint32_t arraySlice, ReadbackCallback callback);
+		std::future<std::vector<uint8_t>> readbackTexture(rhi::ICommandList* pCommandList, rhi::ITexture* texture, uint32_t mipLevel, uint32_t arraySlice);
+
+		// Call after the frame fence of this frame slot was waited on, runs the callbacks of its readbacks
+		void beginFrame();
+
+	private:
+		struct Request
+		{
+			rhi::IBuffer* buffer = nullptr;
+			uint32_t offset = 0;
+			uint32_t size = 0;
+			ReadbackCallback callback;
+		};
+
+		struct FrameRing
+		{
+			std::vector<Scoped<rhi::IBuffer>> buffers;
+			uint32_t currentBuffer = 0;
+			uint32_t allocatedSize = 0;
+			std::vector<Request> requests;
+		};
+
+		Request allocate(uint32_t size);
+		static ReadbackCallback makePromiseCallback(std::shared_ptr<std::promise<std::vector<uint8_t>>> promise);
+
+	private:
+		Renderer* m_Renderer = nullptr;
+		FrameRing m_Frames[SE_MAX_FRAMES_IN_FLIGHT];
+	};
+}
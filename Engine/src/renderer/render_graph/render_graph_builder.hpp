@@ -32,6 +32,17 @@ namespace SE
 			return m_pGraph->import(texture, state);
 		}
 
+		RGHandle import(rhi::IBuffer* buffer, rhi::ResourceAccessFlags state)
+		{
+			return m_pGraph->import(buffer, state);
+		}
+
+		// Argument (and count) buffers consumed by draw/dispatch indirect
+		RGHandle readIndirectArgs(const RGHandle& input, uint32_t subresource = 0)
+		{
+			return read(input, rhi::ResourceAccessFlags::IndirectArgs, subresource);
+		}
+
 		RGHandle read(const RGHandle& input, rhi::ResourceAccessFlags usage, uint32_t subresource)
 		{
 			SE_ASSERT(rhi::anySet(usage, (rhi::ResourceAccessFlags::MaskShaderStorage | rhi::ResourceAccessFlags::IndirectArgs | rhi::ResourceAccessFlags::TransferSrc)));
@@ -1,8 +1,30 @@
 #include "render_graph_resource_allocator.hpp"
 #include <fmt/format.h> // or any other string formatting method you use
+#include <algorithm>
 
 namespace SE
 {
+	namespace
+	{
+		// Smallest heap created for transient resources, small resources are packed into it
+		static const uint32_t MIN_HEAP_SIZE = 16 * 1024 * 1024;
+
+		// Descriptions of placed resources carry their heap offset, compare the layout only
+		static bool isSameLayout(rhi::TextureDescription lhs, const rhi::TextureDescription& rhs)
+		{
+			lhs.heap = rhs.heap;
+			lhs.heapOffset = rhs.heapOffset;
+			return lhs == rhs;
+		}
+
+		static bool isSameLayout(rhi::BufferDescription lhs, const rhi::BufferDescription& rhs)
+		{
+			lhs.heap = rhs.heap;
+			lhs.heapOffset = rhs.heapOffset;
+			return lhs == rhs;
+		}
+	}
+
 	RenderGraphResourceAllocator::RenderGraphResourceAllocator(rhi::IDevice* pDevice)
 	{
 		m_Device = pDevice;
@@ -67,9 +89,15 @@ namespace SE
 		{
 			if (current_frame - iter->lastUsedFrame > 30)
 			{
+				rhi::HeapAllocation block = iter->block;
 				deleteDescriptor(iter->resource);
 				delete iter->resource;
 				iter = heap.resources.erase(iter);
+
+				if (!heap.isBlockUsed(block))
+				{
+					heap.heap->free(block);
+				}
 			}
 			else
 			{
@@ -78,6 +106,33 @@ namespace SE
 		}
 	}
 
+	bool RenderGraphResourceAllocator::findBlock(Heap& heap, const rhi::MemoryRequirements& requirements, const LifetimeRange& lifetime, rhi::HeapAllocation& block)
+	{
+		// Alias the smallest block that fits and has no resource alive during lifetime
+		const rhi::HeapAllocation* bestBlock = nullptr;
+		for (size_t i = 0; i < heap.resources.size(); ++i)
+		{
+			const rhi::HeapAllocation& candidate = heap.resources[i].block;
+			if (candidate.size < requirements.size ||
+				candidate.offset % requirements.alignment != 0 ||
+				(bestBlock && bestBlock->size <= candidate.size) ||
+				heap.isOverlapping(candidate, lifetime))
+			{
+				continue;
+			}
+			bestBlock = &candidate;
+		}
+
+		if (bestBlock)
+		{
+			block = *bestBlock;
+			return true;
+		}
+
+		// Otherwise take free memory from the heap
+		return heap.heap->allocate(requirements.size, requirements.alignment, block);
+	}
+
 	rhi::ITexture* RenderGraphResourceAllocator::allocateTexture(uint32_t firstPass,
 		uint32_t lastPass,
 		rhi::ResourceAccessFlags lastState,
@@ -86,25 +141,24 @@ namespace SE
 		rhi::ResourceAccessFlags& initial_state)
 	{
 		LifetimeRange lifetime{ firstPass, lastPass };
-		uint32_t texture_size = m_Device->getAllocationSize(desc);
+		rhi::MemoryRequirements requirements = m_Device->getMemoryRequirements(desc);
 
-		// Try to find a heap that can hold it and doesn't overlap in pass usage
 		for (size_t i = 0; i < m_AllocatedHeaps.size(); ++i)
 		{
 			Heap& heap = m_AllocatedHeaps[i];
-			if (heap.heap->getDescription().size < texture_size ||
-				heap.isOverlapping(lifetime))
+			if (heap.heap->getDescription().size < requirements.size)
 			{
 				continue;
 			}
 
-			// Try reusing an existing texture if it has the same desc and is unused
+			// Try reusing an existing texture if it has the same desc and its memory is free during lifetime
 			for (size_t j = 0; j < heap.resources.size(); ++j)
 			{
 				AliasedResource& aliasedResource = heap.resources[j];
 				if (aliasedResource.resource->isTexture() &&
 					!aliasedResource.lifetime.isUsed() &&
-					((rhi::ITexture*)aliasedResource.resource)->getDescription() == desc)
+					isSameLayout(((rhi::ITexture*)aliasedResource.resource)->getDescription(), desc) &&
+					!heap.isOverlapping(aliasedResource.block, lifetime))
 				{
 					aliasedResource.lifetime = lifetime;
 					initial_state = aliasedResource.lastUsedState;
@@ -113,14 +167,22 @@ namespace SE
 				}
 			}
 
-			// Otherwise create a new texture in this heap
+			// Otherwise place a new texture in this heap
+			rhi::HeapAllocation block;
+			if (!findBlock(heap, requirements, lifetime, block))
+			{
+				continue;
+			}
+
 			rhi::TextureDescription newDesc = desc;
 			newDesc.heap = heap.heap;
+			newDesc.heapOffset = block.offset;
 
 			AliasedResource aliasedTexture;
 			aliasedTexture.resource = m_Device->createTexture(newDesc, "RGTexture " + name);
 			aliasedTexture.lifetime = lifetime;
 			aliasedTexture.lastUsedState = lastState;
+			aliasedTexture.block = block;
 			heap.resources.push_back(aliasedTexture);
 
 			if (isDepthFormat(desc.format))
@@ -141,7 +203,7 @@ namespace SE
 		}
 
 		// No existing heap can hold it; allocate a new heap
-		allocateHeap(texture_size);
+		allocateHeap(requirements.size);
 		return allocateTexture(firstPass, lastPass, lastState, desc, name, initial_state);
 	}
 
@@ -153,25 +215,24 @@ namespace SE
 		rhi::ResourceAccessFlags& initial_state)
 	{
 		LifetimeRange lifetime{ firstPass, lastPass };
-		uint32_t buffer_size = desc.size;
+		rhi::MemoryRequirements requirements = m_Device->getMemoryRequirements(desc);
 
-		// Try to find a heap that can hold it and doesn't overlap in pass usage
 		for (size_t i = 0; i < m_AllocatedHeaps.size(); ++i)
 		{
 			Heap& heap = m_AllocatedHeaps[i];
-			if (heap.heap->getDescription().size < buffer_size ||
-				heap.isOverlapping(lifetime))
+			if (heap.heap->getDescription().size < requirements.size)
 			{
 				continue;
 			}
 
-			// Try reusing an existing buffer if it has the same desc and is unused
+			// Try reusing an existing buffer if it has the same desc and its memory is free during lifetime
 			for (size_t j = 0; j < heap.resources.size(); ++j)
 			{
 				AliasedResource& aliasedResource = heap.resources[j];
 				if (aliasedResource.resource->isBuffer() &&
 					!aliasedResource.lifetime.isUsed() &&
-					((rhi::IBuffer*)aliasedResource.resource)->getDescription() == desc)
+					isSameLayout(((rhi::IBuffer*)aliasedResource.resource)->getDescription(), desc) &&
+					!heap.isOverlapping(aliasedResource.block, lifetime))
 				{
 					aliasedResource.lifetime = lifetime;
 					initial_state = aliasedResource.lastUsedState;
@@ -180,14 +241,22 @@ namespace SE
 				}
 			}
 
-			// Otherwise create a new buffer in this heap
+			// Otherwise place a new buffer in this heap
+			rhi::HeapAllocation block;
+			if (!findBlock(heap, requirements, lifetime, block))
+			{
+				continue;
+			}
+
 			rhi::BufferDescription newDesc = desc;
 			newDesc.heap = heap.heap;
+			newDesc.heapOffset = block.offset;
 
 			AliasedResource aliasedBuffer;
 			aliasedBuffer.resource = m_Device->createBuffer(newDesc, "RGBuffer " + name);
 			aliasedBuffer.lifetime = lifetime;
 			aliasedBuffer.lastUsedState = lastState;
+			aliasedBuffer.block = block;
 			heap.resources.push_back(aliasedBuffer);
 
 			initial_state = rhi::ResourceAccessFlags::Discard;
@@ -197,14 +266,14 @@ namespace SE
 		}
 
 		// No existing heap can hold it; allocate a new heap
-		allocateHeap(buffer_size);
+		allocateHeap(requirements.size);
 		return allocateBuffer(firstPass, lastPass, lastState, desc, name, initial_state);
 	}
 
 	void RenderGraphResourceAllocator::allocateHeap(uint32_t size)
 	{
 		rhi::HeapDescription heapDesc;
-		heapDesc.size = alignToPowerOfTwo(size, 64u * 1024);
+		heapDesc.size = alignToPowerOfTwo(std::max(size, MIN_HEAP_SIZE), 64u * 1024);
 
 		std::string heapName = fmt::format("RG Heap {:.1f} MB", heapDesc.size / (1024.0f * 1024.0f));
 
@@ -251,6 +320,17 @@ namespace SE
 				continue;
 			}
 
+			uint64_t block = 0;
+			for (size_t j = 0; j < heap.resources.size(); ++j)
+			{
+				if (heap.resources[j].resource == resource)
+				{
+					block = heap.resources[j].block.handle;
+					break;
+				}
+			}
+
+			// Only resources placed in the same block share memory with this one
 			AliasedResource* bestPrev = nullptr;
 			rhi::IResource* prevResource = nullptr;
 			uint32_t prevLastPass = 0;
@@ -259,6 +339,7 @@ namespace SE
 			{
 				AliasedResource& ar = heap.resources[j];
 				if (ar.resource != resource &&
+					ar.block.handle == block &&
 					ar.lifetime.lastPass < firstPass &&
 					ar.lifetime.lastPass > prevLastPass)
 				{
@@ -32,6 +32,7 @@ namespace SE
 			LifetimeRange lifetime;
 			uint64_t lastUsedFrame = 0;
 			rhi::ResourceAccessFlags lastUsedState = rhi::ResourceAccessFlags::Discard;
+			rhi::HeapAllocation block; // Sub-allocated range, shared by all resources aliasing it
 		};
 
 		struct Heap
@@ -39,11 +40,25 @@ namespace SE
 			rhi::IHeap* heap = nullptr;
 			std::vector<AliasedResource> resources;
 
-			bool isOverlapping(const LifetimeRange& lifetime) const
+			// Whether a resource placed in block is alive during lifetime
+			bool isOverlapping(const rhi::HeapAllocation& block, const LifetimeRange& lifetime) const
 			{
 				for (size_t i = 0; i < resources.size(); ++i)
 				{
-					if (resources[i].lifetime.isOverlapping(lifetime))
+					if (resources[i].block.handle == block.handle &&
+						resources[i].lifetime.isOverlapping(lifetime))
+					{
+						return true;
+					}
+				}
+				return false;
+			}
+
+			bool isBlockUsed(const rhi::HeapAllocation& block) const
+			{
+				for (size_t i = 0; i < resources.size(); ++i)
+				{
+					if (resources[i].block.handle == block.handle)
 					{
 						return true;
 					}
@@ -122,6 +137,7 @@ namespace SE
 
 	private:
 		void checkHeapUsage(Heap& heap);
+		bool findBlock(Heap& heap, const rhi::MemoryRequirements& requirements, const LifetimeRange& lifetime, rhi::HeapAllocation& block);
 		void deleteDescriptor(rhi::IResource* resource);
 		void allocateHeap(uint32_t size);
 
@@ -5,11 +5,55 @@
 #include "resources/formatted_buffer.hpp"
 #include "resources/structured_buffer.hpp"
 #include "resources/index_buffer.hpp"
+#include "vertex_compression.hpp"
 #include "gpu_scene.hlsli"
+#include <fstream>
+#include <numeric>
+#include <algorithm>
+#include <map>
+#include <unordered_map>
 #include"global_constants.hlsli"
+// Largest buffer that is placed in device local host visible memory and written directly
+#define DIRECT_UPLOAD_MAX_SIZE (4 * 1024 * 1024)
+#define STAGING_RING_SIZE (64 * 1024 * 1024)
+// Staged bytes per frame before uploads are streamed in chunks over the following frames
+#define STAGING_FRAME_BUDGET (16 * 1024 * 1024)
+#define STAGING_CHUNK_SIZE (4 * 1024 * 1024)
+#define STAGING_ALIGNMENT 256u
+#define ASYNC_UPLOAD_STAGING_SIZE (32 * 1024 * 1024)
 using namespace rhi;
 namespace SE
 {
+	namespace
+	{
+		// Planes of clip = viewProjection * position, normals point inside
+		static void extractFrustumPlanes(const glm::mat4& viewProjection, float4* planes)
+		{
+			glm::vec4 rows[4];
+			for (int i = 0; i < 4; ++i)
+			{
+				rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+			}
+
+			const glm::vec4 frustum[6] =
+			{
+				rows[3] + rows[0],
+				rows[3] - rows[0],
+				rows[3] + rows[1],
+				rows[3] - rows[1],
+				rows[2],
+				rows[3] - rows[2],
+			};
+
+			for (int i = 0; i < 6; ++i)
+			{
+				float length = glm::length(glm::vec3(frustum[i]));
+				// Degenerate for infinite projections, never rejects
+				planes[i] = length > 0.0f ? float4(frustum[i].x, frustum[i].y, frustum[i].z, frustum[i].w) / length : float4(0.0f, 0.0f, 0.0f, 1.0f);
+			}
+		}
+	}
+
 	Renderer::Renderer()
 	{
 		Engine::getInstance().getWindow().WindowResizeSignal.connect(&Renderer::onWindowResize, this);
@@ -41,6 +85,7 @@ namespace SE
 #else
 		desc.enableValidation = false;
 #endif
+		desc.enableSubmissionThread = true;
 		auto device = rhi::createDevice(desc);
 		SE_ASSERT(device.get(), "Device creation is failed");
 		m_Device = std::move(device);
@@ -75,6 +120,18 @@ namespace SE
 		pipeDesc.depthStencil = depthInfo;
 		m_DefaultPipeline = Scoped<rhi::IPipelineState>(m_Device->createGraphicsPipelineState(pipeDesc, "TestGraphicsPipeline"));
 
+		if (m_Device->isMeshShadingSupported())
+		{
+			MeshShadingPipelineDescription meshletPipeDesc{};
+			meshletPipeDesc.amplificationShader = m_ShaderCache->getShader("meshletShader.hlsl", "ASMain", ShaderType::Amplification, {});
+			meshletPipeDesc.meshShader = m_ShaderCache->getShader("meshletShader.hlsl", "MSMain", ShaderType::Mesh, {});
+			meshletPipeDesc.pixelShader = m_ShaderCache->getShader("meshletShader.hlsl", "PSMain", ShaderType::Pixel, {});
+			meshletPipeDesc.renderTargetFormat[0] = Format::R8G8B8A8_UNORM;
+			meshletPipeDesc.depthStencilFormat = Format::D32_SFLOAT;
+			meshletPipeDesc.depthStencil = depthInfo;
+			m_MeshletPipeline = Scoped<rhi::IPipelineState>(m_Device->createMeshShadingPipelineState(meshletPipeDesc, "MeshletPipeline"));
+		}
+
 		std::vector<glm::vec3> cubeVertices =
 		{
 			glm::vec3(-0.5f, -0.5f, -0.5f), // Vertex 0
@@ -130,10 +187,14 @@ namespace SE
 			}
 		);
 
-		InstanceData data;
-		data.posBufferAddress = allocateSceneStaticBuffer(rotatedCube.data(), rotatedCube.size() * sizeof(float3)).offset;
-		data.indexBufferAddress = allocateSceneStaticBuffer(indices.data(), sizeof(uint32_t) * indices.size()).offset;
-		m_GpuScene->addInstance(data);
+		VertexStreams streams;
+		streams.positions = rotatedCube.data();
+		streams.vertexCount = (uint32_t)rotatedCube.size();
+
+		InstanceData data = {};
+		std::vector<OffsetAllocator::Allocation> allocations;
+		m_GpuScene->uploadMesh(streams, indices.data(), (uint32_t)indices.size(), data, &allocations);
+		m_GpuScene->addInstance(data, allocations);
 	}
 
 	rhi::IBuffer* Renderer::getSceneStaticBuffer() const
@@ -147,7 +208,7 @@ namespace SE
 
 		if (data)
 		{
-			uploadBuffer(m_GpuScene->getSceneStaticBuffer(), allocation.offset, data, size);
+			m_GpuScene->writeStatic(allocation.offset, nullptr, data, size);
 		}
 
 		return allocation;
@@ -166,6 +227,7 @@ namespace SE
 		{
 			void* dst = (char*)m_GpuScene->getSceneConstantBuffer()->getCpuAddress() + address;
 			memcpy(dst, data, size);
+			m_UploadStats.directBytes += size;
 		}
 
 		return address;
@@ -194,7 +256,7 @@ namespace SE
 	RawBuffer* Renderer::createRawBuffer(const void* data, uint32_t size, const std::string& name, rhi::MemoryType memType, bool uav)
 	{
 		RawBuffer* buffer = new RawBuffer(name);
-		if (!buffer->create(size, memType, uav))
+		if (!buffer->create(size, data ? getUploadMemoryType(memType, size) : memType, uav))
 		{
 			delete buffer;
 			return nullptr;
@@ -211,7 +273,7 @@ namespace SE
 	IndexBuffer* Renderer::createIndexBuffer(const void* data, uint32_t stride, uint32_t elementsCount, const std::string& name, rhi::MemoryType memType)
 	{
 		IndexBuffer* buffer = new IndexBuffer(name);
-		if (!buffer->create(stride, elementsCount, memType))
+		if (!buffer->create(stride, elementsCount, data ? getUploadMemoryType(memType, stride * elementsCount) : memType))
 		{
 			delete buffer;
 			return nullptr;
@@ -228,7 +290,7 @@ namespace SE
 	StructuredBuffer* Renderer::createStructuredBuffer(const void* data, uint32_t stride, uint32_t elementCount, const std::string& name, rhi::MemoryType memType, bool uav)
 	{
 		StructuredBuffer* buffer = new StructuredBuffer(name);
-		if (!buffer->create(stride, elementCount, memType, uav))
+		if (!buffer->create(stride, elementCount, data ? getUploadMemoryType(memType, stride * elementCount) : memType, uav))
 		{
 			delete buffer;
 			return nullptr;
@@ -245,7 +307,7 @@ namespace SE
 	FormattedBuffer* Renderer::createFormattedBuffer(const void* data, rhi::Format format, uint32_t elementCount, const std::string& name, rhi::MemoryType memType, bool uav)
 	{
 		FormattedBuffer* buffer = new FormattedBuffer(name);
-		if (!buffer->create(format, elementCount, memType, uav))
+		if (!buffer->create(format, elementCount, data ? getUploadMemoryType(memType, rhi::getFormatRowPitch(format, 1) * elementCount) : memType, uav))
 		{
 			delete buffer;
 			return nullptr;
@@ -261,9 +323,11 @@ namespace SE
 
 	void Renderer::renderFrame()
 	{
-		m_GpuScene->update();
 		buildRenderGraph(m_OutputColorHandle, m_OutputDepthHandle);
 		beginFrame();
+		// Scene constants go to this frame's buffer, only safe to write once its fence has been waited on
+		uint32_t frameIndex = m_Device->getFrameID() % SE_MAX_FRAMES_IN_FLIGHT;
+		m_GpuScene->update(m_FrameResources[frameIndex].commandList.get());
 		uploadResources();
 		render();
 		endFrame();
@@ -271,23 +335,276 @@ namespace SE
 	}
 	void Renderer::uploadTexture(rhi::ITexture* texture, const void* data)
 	{
+		// data holds every subresource in subresource order with tightly packed rows
+		const rhi::TextureDescription& desc = texture->getDescription();
+		std::vector<rhi::SubresourceFootprint> footprints;
+		uint32_t stagingSize = rhi::getTextureFootprints(desc, footprints);
+		uint32_t alignment = std::lcm(STAGING_ALIGNMENT, rhi::getFormatCopyAlignment(desc.format));
+
+		const char* src_data = (const char*)data;
+		uint32_t src_size = 0;
+		for (const rhi::SubresourceFootprint& footprint : footprints)
+		{
+			src_size += footprint.size;
+		}
+
+		StagingBuffer staging_buffer;
+		if (stagingSize <= STAGING_FRAME_BUDGET && allocateStaging(stagingSize, alignment, staging_buffer))
+		{
+			char* dst_data = (char*)m_StagingBufferAllocator->getCpuAddress(staging_buffer);
+			uint32_t src_offset = 0;
+			for (const rhi::SubresourceFootprint& footprint : footprints)
+			{
+				memcpy(dst_data + footprint.offset, src_data + src_offset, footprint.size);
+				src_offset += footprint.size;
+			}
+			staging_buffer.buffer->flush(staging_buffer.offset, stagingSize);
+
+			TextureUpload upload;
+			upload.texture = texture;
+			upload.staging_buffer = staging_buffer;
+			upload.offset = 0;
+			upload.footprints = std::move(footprints);
+			upload.last_chunk = true;
+			m_PendingTextureUploads.push_back(std::move(upload));
+			++m_UploadStats.stagedUploads;
+
+			m_UploadStats.stagingBytes += src_size;
+			return;
+		}
+
+		StreamedUpload upload;
+		upload.texture = texture;
+		upload.footprints = std::move(footprints);
+		upload.data.assign(src_data, src_data + src_size);
+		m_StreamingBytes += src_size;
+		++m_UploadStats.stagedUploads;
+		m_StreamedUploads.push_back(std::move(upload));
 	}
 	void Renderer::uploadBuffer(rhi::IBuffer* buffer, uint32_t offset, const void* data, uint32_t data_size)
 	{
-		uint32_t frame_index = m_Device->getFrameID() % SE_MAX_FRAMES_IN_FLIGHT;
+		rhi::MemoryType memoryType = buffer->getDescription().memoryType;
+		if (memoryType == rhi::MemoryType::GpuUpload || memoryType == rhi::MemoryType::CpuToGpu)
+		{
+			char* dst_data = (char*)buffer->map() + offset;
+			memcpy(dst_data, data, data_size);
+			buffer->flush(offset, data_size);
+
+			m_UploadStats.directBytes += data_size;
+			return;
+		}
 
-		StagingBufferAllocator* pAllocator = m_FrameResources[frame_index].stagingBufferAllocator.get();
-		StagingBuffer staging_buffer = pAllocator->allocate(data_size);
+		StagingBuffer staging_buffer;
+		if (data_size <= STAGING_FRAME_BUDGET && allocateStaging(data_size, STAGING_ALIGNMENT, staging_buffer))
+		{
+			memcpy(m_StagingBufferAllocator->getCpuAddress(staging_buffer), data, data_size);
+			staging_buffer.buffer->flush(staging_buffer.offset, data_size);
 
-		staging_buffer.buffer->map();
-		char* dst_data = (char*)staging_buffer.buffer->getCpuAddress() + staging_buffer.offset;
-		memcpy(dst_data, data, data_size);
+			BufferUpload upload;
+			upload.buffer = buffer;
+			upload.offset = offset;
+			upload.staging_buffer = staging_buffer;
+			m_PendingBufferUpload.push_back(upload);
 
-		BufferUpload upload;
+			m_UploadStats.stagingBytes += data_size;
+			++m_UploadStats.stagedUploads;
+			return;
+		}
+
+		// Too large for a single frame, or the ring is filled by uploads that were not submitted yet
+		StreamedUpload upload;
 		upload.buffer = buffer;
 		upload.offset = offset;
-		upload.staging_buffer = staging_buffer;
-		m_PendingBufferUpload.push_back(upload);
+		upload.data.assign((const char*)data, (const char*)data + data_size);
+		m_StreamingBytes += data_size;
+		++m_UploadStats.stagedUploads;
+		m_StreamedUploads.push_back(std::move(upload));
+	}
+	uint64_t Renderer::uploadBufferAsync(rhi::IBuffer* buffer, uint32_t offset, const void* data, uint32_t data_size)
+	{
+		rhi::MemoryType memoryType = buffer->getDescription().memoryType;
+		if (memoryType == rhi::MemoryType::GpuUpload || memoryType == rhi::MemoryType::CpuToGpu)
+		{
+			char* dst_data = (char*)buffer->map() + offset;
+			memcpy(dst_data, data, data_size);
+			buffer->flush(offset, data_size);
+			return 0;
+		}
+		return m_AsyncUploadQueue->uploadBuffer(buffer, offset, data, data_size);
+	}
+	uint64_t Renderer::uploadBufferAsync(rhi::IBuffer* buffer, uint32_t offset, Shared<const void> owner, const void* data, uint32_t data_size)
+	{
+		rhi::MemoryType memoryType = buffer->getDescription().memoryType;
+		if (memoryType == rhi::MemoryType::GpuUpload || memoryType == rhi::MemoryType::CpuToGpu)
+		{
+			return uploadBufferAsync(buffer, offset, data, data_size);
+		}
+		return m_AsyncUploadQueue->uploadBuffer(buffer, offset, std::move(owner), data, data_size);
+	}
+	uint64_t Renderer::uploadTextureAsync(rhi::ITexture* texture, const void* data)
+	{
+		return m_AsyncUploadQueue->uploadTexture(texture, data);
+	}
+	void Renderer::waitAsyncUploads(rhi::ICommandList* commandList)
+	{
+		if (m_RequiredAsyncUploadValue <= m_WaitedAsyncUploadValue)
+		{
+			return;
+		}
+
+		// Timeline waits must not be submitted ahead of their signal, this only blocks until the copy is recorded
+		m_AsyncUploadQueue->waitForSubmission(m_RequiredAsyncUploadValue);
+		commandList->wait(m_AsyncUploadQueue->getFence(), m_RequiredAsyncUploadValue);
+		m_WaitedAsyncUploadValue = m_RequiredAsyncUploadValue;
+
+		std::vector<rhi::ITexture*> textures;
+		m_AsyncUploadQueue->takeUploadedTextures(m_RequiredAsyncUploadValue, textures);
+		if (m_Device->getDescription().backend == rhi::RenderBackend::Vulkan)
+		{
+			for (rhi::ITexture* texture : textures)
+			{
+				commandList->textureBarrier(texture, rhi::ResourceAccessFlags::TransferDst, rhi::ResourceAccessFlags::MaskShaderRead);
+			}
+		}
+	}
+	bool Renderer::allocateStaging(uint32_t size, uint32_t alignment, StagingBuffer& staging)
+	{
+		// Throttles the producer on the oldest upload batch in flight while the ring is full
+		while (!m_StagingBufferAllocator->allocate(size, alignment, staging))
+		{
+			if (!m_StagingBufferAllocator->waitForSpace())
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+	void Renderer::streamUploads()
+	{
+		uint32_t budget = STAGING_FRAME_BUDGET;
+
+		while (!m_StreamedUploads.empty() && budget > 0)
+		{
+			StreamedUpload& upload = m_StreamedUploads.front();
+			StagingBuffer staging_buffer;
+			uint32_t size = 0;
+			bool done = false;
+
+			if (upload.texture)
+			{
+				// Textures are streamed one subresource at a time
+				rhi::SubresourceFootprint footprint = upload.footprints[upload.progress];
+				SE_ASSERT(footprint.size <= m_StagingBufferAllocator->getSize(), "Subresource does not fit into the staging ring");
+
+				size = footprint.size;
+				uint32_t alignment = std::lcm(STAGING_ALIGNMENT, rhi::getFormatCopyAlignment(upload.texture->getDescription().format));
+				if ((size > budget && budget < STAGING_FRAME_BUDGET) || !m_StagingBufferAllocator->allocate(size, alignment, staging_buffer))
+				{
+					break;
+				}
+
+				memcpy(m_StagingBufferAllocator->getCpuAddress(staging_buffer), upload.data.data() + upload.dataOffset, size);
+				staging_buffer.buffer->flush(staging_buffer.offset, size);
+
+				footprint.offset = 0;
+				++upload.progress;
+				done = upload.progress == upload.footprints.size();
+
+				TextureUpload textureUpload;
+				textureUpload.texture = upload.texture;
+				textureUpload.staging_buffer = staging_buffer;
+				textureUpload.offset = 0;
+				textureUpload.footprints.push_back(footprint);
+				textureUpload.last_chunk = done;
+				m_PendingTextureUploads.push_back(std::move(textureUpload));
+			}
+			else
+			{
+				size = std::min<uint32_t>({ STAGING_CHUNK_SIZE, budget, (uint32_t)upload.data.size() - upload.dataOffset });
+				if (!m_StagingBufferAllocator->allocate(size, STAGING_ALIGNMENT, staging_buffer))
+				{
+					break;
+				}
+
+				memcpy(m_StagingBufferAllocator->getCpuAddress(staging_buffer), upload.data.data() + upload.dataOffset, size);
+				staging_buffer.buffer->flush(staging_buffer.offset, size);
+
+				BufferUpload bufferUpload;
+				bufferUpload.buffer = upload.buffer;
+				bufferUpload.offset = upload.offset + upload.dataOffset;
+				bufferUpload.staging_buffer = staging_buffer;
+				m_PendingBufferUpload.push_back(bufferUpload);
+				done = upload.dataOffset + size == upload.data.size();
+			}
+
+			upload.dataOffset += size;
+			budget -= std::min(budget, size);
+			m_StreamingBytes -= size;
+			m_UploadStats.stagingBytes += size;
+
+			if (done)
+			{
+				m_StreamedUploads.pop_front();
+			}
+		}
+	}
+	StagingStats Renderer::getStagingStats() const
+	{
+		StagingStats stats = m_StagingBufferAllocator->getStats();
+		stats.streamingBytes = m_StreamingBytes;
+		return stats;
+	}
+	rhi::MemoryType Renderer::getUploadMemoryType(rhi::MemoryType memType, uint32_t size) const
+	{
+		if (memType == rhi::MemoryType::GpuOnly && m_Device->isDirectUploadSupported() && size <= DIRECT_UPLOAD_MAX_SIZE)
+		{
+			return rhi::MemoryType::GpuUpload;
+		}
+		return memType;
+	}
+	bool Renderer::dumpMemoryStats(const std::string& path) const
+	{
+		std::ofstream file(path);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		rhi::MemoryStats stats = m_Device->getMemoryStats();
+		file << "{\n\t\"frame\": " << m_Device->getFrameCount() << ",\n\t\"categories\": {";
+		for (uint32_t i = 0; i < (uint32_t)rhi::MemoryCategory::Count; ++i)
+		{
+			const rhi::MemoryCategoryStats& category = stats.categories[i];
+			file << (i == 0 ? "\n" : ",\n") << "\t\t\"" << rhi::getMemoryCategoryName((rhi::MemoryCategory)i) << "\": { "
+				<< "\"allocatedBytes\": " << category.allocatedBytes << ", "
+				<< "\"peakBytes\": " << category.peakBytes << ", "
+				<< "\"allocationCount\": " << category.allocationCount << " }";
+		}
+		file << "\n\t},\n\t\"pools\": {";
+		for (uint32_t i = 0; i < (uint32_t)rhi::MemoryPoolType::Count; ++i)
+		{
+			const rhi::MemoryPoolStats& pool = stats.pools[i];
+			file << (i == 0 ? "\n" : ",\n") << "\t\t\"" << rhi::getMemoryPoolName((rhi::MemoryPoolType)i) << "\": { "
+				<< "\"allocationCount\": " << pool.allocationCount << ", "
+				<< "\"blockCount\": " << pool.blockCount << ", "
+				<< "\"allocatedBytes\": " << pool.allocatedBytes << ", "
+				<< "\"blockBytes\": " << pool.blockBytes << ", "
+				<< "\"fragmentation\": " << pool.fragmentation << " }";
+		}
+		file << "\n\t},\n\t\"heaps\": [";
+		for (uint32_t i = 0; i < stats.heapCount; ++i)
+		{
+			const rhi::MemoryHeapStats& heap = stats.heaps[i];
+			file << (i == 0 ? "\n" : ",\n") << "\t\t{ "
+				<< "\"index\": " << i << ", "
+				<< "\"deviceLocal\": " << (heap.deviceLocal ? "true" : "false") << ", "
+				<< "\"sizeBytes\": " << heap.sizeBytes << ", "
+				<< "\"usageBytes\": " << heap.usageBytes << ", "
+				<< "\"budgetBytes\": " << heap.budgetBytes << ", "
+				<< "\"peakUsageBytes\": " << heap.peakUsageBytes << " }";
+		}
+		file << "\n\t]\n}\n";
+		return true;
 	}
 	void SE::Renderer::onWindowResize(uint32_t width, uint32_t height)
 	{
@@ -317,6 +634,22 @@ namespace SE
 
 		commandList->textureBarrier(presentImage, ResourceAccessFlags::Present, ResourceAccessFlags::TransferDst);
 		commandList->copyTexture(presentImage, 0, 0, colorImage->getTexture(), 0, 0);
+		if (!m_ScreenshotPath.empty())
+		{
+			const rhi::TextureDescription& desc = colorImage->getTexture()->getDescription();
+			m_ReadbackManager->readbackTexture(commandList, colorImage->getTexture(), 0, 0,
+				[path = m_ScreenshotPath, width = desc.width, height = desc.height](const void* data, uint32_t size)
+				{
+					std::ofstream file(path, std::ios::binary);
+					file << "P6\n" << width << " " << height << "\n255\n";
+					const uint8_t* rgba = (const uint8_t*)data;
+					for (uint32_t i = 0; i < width * height; ++i)
+					{
+						file.write((const char*)rgba + i * 4, 3);
+					}
+				});
+			m_ScreenshotPath.clear();
+		}
 		commandList->textureBarrier(presentImage, ResourceAccessFlags::TransferDst, ResourceAccessFlags::RenderTarget);
 		//for the next frame
 		commandList->textureBarrier(colorImage->getTexture(), ResourceAccessFlags::TransferSrc, ResourceAccessFlags::RenderTarget);
@@ -338,10 +671,29 @@ namespace SE
 			frame.commandList.reset(m_Device->createCommandList(rhi::CommandType::Graphics, "MainCommands"));
 			frame.computeCommandList.reset(m_Device->createCommandList(rhi::CommandType::Compute, "ComputeCommands"));
 			frame.uploadCommandList.reset(m_Device->createCommandList(rhi::CommandType::Copy, "UploadCommands"));
-			frame.stagingBufferAllocator = createScoped<StagingBufferAllocator>(this);
 		}
 		m_FrameFence.reset(m_Device->createFence("FrameFence"));
 		m_UploadFence.reset(m_Device->createFence("UploadFence"));
+		m_StagingBufferAllocator = createScoped<StagingBufferAllocator>(this, m_UploadFence.get(), STAGING_RING_SIZE);
+		m_AsyncUploadQueue = createScoped<AsyncUploadQueue>(this, ASYNC_UPLOAD_STAGING_SIZE);
+		m_ReadbackManager = createScoped<ReadbackManager>(this);
+
+		QueryHeapDescription queryHeapDesc;
+		queryHeapDesc.type = QueryType::Timestamp;
+		queryHeapDesc.queryCount = 2;
+		m_FrameTimestampHeap.reset(m_Device->createQueryHeap(queryHeapDesc, "FrameTimestamps"));
+
+		queryHeapDesc.type = QueryType::PipelineStatistics;
+		queryHeapDesc.queryCount = 1;
+		m_PipelineStatisticsHeap.reset(m_Device->createQueryHeap(queryHeapDesc, "ForwardPassStatistics"));
+
+		if (m_Device->isTimestampSupported(rhi::CommandType::Copy))
+		{
+			// The copy queue writes a frame's pair before the graphics queue of that frame resets it, each frame owns its own pair
+			queryHeapDesc.type = QueryType::Timestamp;
+			queryHeapDesc.queryCount = 2 * SE_MAX_FRAMES_IN_FLIGHT;
+			m_UploadTimestampHeap.reset(m_Device->createQueryHeap(queryHeapDesc, "UploadTimestamps"));
+		}
 	}
 
 	void SE::Renderer::beginFrame()
@@ -350,11 +702,47 @@ namespace SE
 		FrameResources& frame = m_FrameResources[frameIndex];
 		m_FrameFence->wait(frame.frameFenceValue);
 
+		if (m_DefragmentMemory)
+		{
+			// A step swaps the staging rings to their new memory, the upload worker must not be writing them
+			std::unique_lock<std::mutex> suspended = m_AsyncUploadQueue->suspend();
+			m_DefragmentMemory = m_Device->defragmentMemory();
+		}
+
+		m_ReadbackManager->beginFrame();
+		m_StagingBufferAllocator->beginFrame();
+
+		m_LastFrameUploadStats = m_UploadStats;
+		m_TotalUploadStats.directBytes += m_UploadStats.directBytes;
+		m_TotalUploadStats.stagingBytes += m_UploadStats.stagingBytes;
+		m_TotalUploadStats.stagedUploads += m_UploadStats.stagedUploads;
+		m_TotalUploadStats.copyCommands += m_UploadStats.copyCommands;
+		m_TotalUploadStats.copyRegions += m_UploadStats.copyRegions;
+		m_UploadStats = {};
+
 		m_Device->beginFrame();
 
+		uint64_t timestamps[2];
+		if (m_FrameTimestampHeap->readResults(0, 2, timestamps))
+		{
+			m_GpuFrameTimeMs = (float)((double)(timestamps[1] - timestamps[0]) * 1000.0 / (double)m_Device->getTimestampFrequency());
+		}
+		m_PipelineStatisticsHeap->readResults(0, 1, &m_ForwardPassStatistics);
+
+		if (m_UploadTimestampHeap && frame.uploadBytes > 0 && m_UploadTimestampHeap->readResults(2 * frameIndex, 2, timestamps))
+		{
+			m_UploadTimeMs = (float)((double)(timestamps[1] - timestamps[0]) * 1000.0 / (double)m_Device->getTimestampFrequency());
+			if (m_UploadTimeMs > 0.0f)
+			{
+				m_UploadThroughputMBps = (float)(frame.uploadBytes / (1024.0 * 1024.0) / (m_UploadTimeMs / 1000.0));
+			}
+		}
+		frame.uploadBytes = 0;
+
 		rhi::ICommandList* pCommandList = frame.commandList.get();
 		pCommandList->resetAllocator();
 		pCommandList->begin();
+		pCommandList->writeTimestamp(m_FrameTimestampHeap.get(), 0);
 
 		rhi::ICommandList* pComputeCommandList = frame.computeCommandList.get();
 		pComputeCommandList->resetAllocator();
@@ -370,8 +758,16 @@ namespace SE
 		pComputeCommandList->end();
 
 		rhi::ICommandList* pCommandList = frame.commandList.get();
+		pCommandList->writeTimestamp(m_FrameTimestampHeap.get(), 1);
+		pCommandList->resolveQueries(m_FrameTimestampHeap.get(), 0, 2);
+		pCommandList->resolveQueries(m_PipelineStatisticsHeap.get(), 0, 1);
 		pCommandList->end();
 
+		m_CommandListStats = pCommandList->getStats();
+		m_CommandListStats += pComputeCommandList->getStats();
+		pCommandList->resetStats();
+		pComputeCommandList->resetStats();
+
 		frame.frameFenceValue = ++m_CurrenFrameFenceValue;
 
 		pCommandList->present(m_Swapchain.get());
@@ -381,48 +777,147 @@ namespace SE
 		m_Device->endFrame();
 	}
 
-	void SE::Renderer::uploadResources()
+	void Renderer::recordBufferUploads(rhi::ICommandList* commandList)
 	{
-		if (m_PendingTextureUploads.empty() && m_PendingBufferUpload.empty())
+		// Uploads are split into batches without overlapping destination ranges, so a batch may be reordered freely.
+		// A later upload into a range written earlier starts a new batch behind a barrier.
+		std::vector<BufferUpload> batch;
+		std::unordered_map<rhi::IBuffer*, std::map<uint32_t, uint32_t>> writtenRanges;
+
+		for (const BufferUpload& upload : m_PendingBufferUpload)
 		{
-			return;
+			uint32_t begin = upload.offset;
+			uint32_t end = upload.offset + upload.staging_buffer.size;
+
+			std::map<uint32_t, uint32_t>& ranges = writtenRanges[upload.buffer];
+			auto next = ranges.lower_bound(begin);
+			bool overlaps = (next != ranges.end() && next->first < end) ||
+				(next != ranges.begin() && std::prev(next)->second > begin);
+
+			if (overlaps)
+			{
+				recordBufferCopies(commandList, batch);
+				commandList->globalBarrier(rhi::ResourceAccessFlags::TransferDst, rhi::ResourceAccessFlags::TransferDst);
+				batch.clear();
+				writtenRanges.clear();
+			}
+
+			writtenRanges[upload.buffer].emplace(begin, end);
+			batch.push_back(upload);
+		}
+
+		recordBufferCopies(commandList, batch);
+	}
+
+	void Renderer::recordBufferCopies(rhi::ICommandList* commandList, std::vector<BufferUpload>& batch)
+	{
+		std::sort(batch.begin(), batch.end(), [](const BufferUpload& a, const BufferUpload& b)
+			{
+				if (a.buffer != b.buffer)
+					return a.buffer < b.buffer;
+				if (a.staging_buffer.buffer != b.staging_buffer.buffer)
+					return a.staging_buffer.buffer < b.staging_buffer.buffer;
+				return a.offset < b.offset;
+			});
+
+		std::vector<rhi::BufferCopyRegion> regions;
+		for (size_t i = 0; i < batch.size(); ++i)
+		{
+			const BufferUpload& upload = batch[i];
+
+			// Neighbouring uploads that are contiguous in both the staging ring and the destination become one region
+			rhi::BufferCopyRegion* last = regions.empty() ? nullptr : &regions.back();
+			if (last && last->dstOffset + last->size == upload.offset && last->srcOffset + last->size == upload.staging_buffer.offset)
+			{
+				last->size += upload.staging_buffer.size;
+			}
+			else
+			{
+				regions.push_back({ upload.staging_buffer.offset, upload.offset, upload.staging_buffer.size });
+			}
+
+			bool lastOfGroup = i + 1 == batch.size() || batch[i + 1].buffer != upload.buffer ||
+				batch[i + 1].staging_buffer.buffer != upload.staging_buffer.buffer;
+			if (lastOfGroup)
+			{
+				commandList->copyBuffer(upload.buffer, upload.staging_buffer.buffer, (uint32_t)regions.size(), regions.data());
+				++m_UploadStats.copyCommands;
+				m_UploadStats.copyRegions += (uint32_t)regions.size();
+				regions.clear();
+			}
 		}
+	}
+
+	void SE::Renderer::uploadResources()
+	{
+		streamUploads();
 
 		uint32_t frame_index = m_Device->getFrameID() % SE_MAX_FRAMES_IN_FLIGHT;
 
 		FrameResources& currentFrame = m_FrameResources[frame_index];
+		waitAsyncUploads(currentFrame.commandList.get());
+
+		if (m_PendingTextureUploads.empty() && m_PendingBufferUpload.empty())
+		{
+			return;
+		}
+
 		rhi::ICommandList* uploadCommandList = currentFrame.uploadCommandList.get();
 		uploadCommandList->resetAllocator();
 		uploadCommandList->begin();
 
+		if (m_UploadTimestampHeap)
 		{
+			uploadCommandList->writeTimestamp(m_UploadTimestampHeap.get(), 2 * frame_index);
+		}
+
+		{
+			uint64_t uploadBytes = 0;
 			for (size_t i = 0; i < m_PendingBufferUpload.size(); ++i)
 			{
-				const BufferUpload& upload = m_PendingBufferUpload[i];
-				uploadCommandList->copyBuffer(upload.buffer, upload.offset,
-					upload.staging_buffer.buffer, upload.staging_buffer.offset, upload.staging_buffer.size);
+				uploadBytes += m_PendingBufferUpload[i].staging_buffer.size;
 			}
+			recordBufferUploads(uploadCommandList);
 
 			for (size_t i = 0; i < m_PendingTextureUploads.size(); ++i)
 			{
 				const TextureUpload& upload = m_PendingTextureUploads[i];
-				uploadCommandList->copyBufferToTexture(upload.texture, upload.mip_level, upload.array_slice,
-					upload.staging_buffer.buffer, upload.staging_buffer.offset + upload.offset);
+				uploadCommandList->copyBufferToTexture(upload.texture, upload.staging_buffer.buffer, upload.staging_buffer.offset + upload.offset,
+					(uint32_t)upload.footprints.size(), upload.footprints.data());
+				uploadBytes += upload.staging_buffer.size;
+				++m_UploadStats.copyCommands;
 			}
+			currentFrame.uploadBytes = uploadBytes;
+		}
+
+		if (m_UploadTimestampHeap)
+		{
+			uploadCommandList->writeTimestamp(m_UploadTimestampHeap.get(), 2 * frame_index + 1);
 		}
 
 		uploadCommandList->end();
 		uploadCommandList->signal(m_UploadFence.get(), ++m_CurrentUploadFenceValue);
 		uploadCommandList->submit();
+		m_StagingBufferAllocator->endBatch(m_CurrentUploadFenceValue);
 
 		ICommandList* commandList = currentFrame.commandList.get();
 		commandList->wait(m_UploadFence.get(), m_CurrentUploadFenceValue);
 
+		// Copy queues can not copy query results, the graphics queue resolves them after waiting on the upload
+		if (m_UploadTimestampHeap)
+		{
+			commandList->resolveQueries(m_UploadTimestampHeap.get(), 2 * frame_index, 2);
+		}
+
 		if (m_Device->getDescription().backend == rhi::RenderBackend::Vulkan)
 		{
 			for (size_t i = 0; i < m_PendingTextureUploads.size(); ++i)
 			{
 				const TextureUpload& upload = m_PendingTextureUploads[i];
+				if (!upload.last_chunk)
+				{
+					continue;
+				}
 				commandList->textureBarrier(upload.texture,
 					rhi::ResourceAccessFlags::TransferDst, rhi::ResourceAccessFlags::MaskShaderRead);
 			}
@@ -453,8 +948,22 @@ namespace SE
 			},
 			[&](const ForwardPassData& data, ICommandList* pCommandList)
 			{
-				pCommandList->bindPipeline(m_DefaultPipeline.get());
-				pCommandList->draw(36, 1);
+				pCommandList->beginQuery(m_PipelineStatisticsHeap.get(), 0);
+				if (isMeshShadingEnabled())
+				{
+					// X: meshlet task groups of the largest instance, Y: instance
+					uint32_t groupCountX = (m_GpuScene->getMaxInstanceMeshletCount() + MESHLET_TASK_GROUP_SIZE - 1) / MESHLET_TASK_GROUP_SIZE;
+					pCommandList->bindPipeline(m_MeshletPipeline.get());
+					pCommandList->dispatchMesh(groupCountX, m_GpuScene->getInstanceCount(), 1);
+				}
+				else
+				{
+					// Vertices: indices of the largest instance, instances: the whole scene
+					pCommandList->bindPipeline(m_DefaultPipeline.get());
+					pCommandList->draw(m_GpuScene->getMaxInstanceIndexCount(), m_GpuScene->getInstanceCount());
+				}
+
+				pCommandList->endQuery(m_PipelineStatisticsHeap.get(), 0);
 			});
 
 		color = forward_pass->outSceneColorRT;
@@ -470,17 +979,18 @@ namespace SE
 	{
 		SceneConstant sceneCB;
 
+		const Camera& camera = Engine::getInstance().getCamera();
 		CameraConstant camera_cb;
-		camera_cb.viewProjection = (glmMat4ToHlslpp(Engine::getInstance().getCamera().getViewProjectionMatrix()));
+		camera_cb.viewProjection = (glmMat4ToHlslpp(camera.getViewProjectionMatrix()));
 		//camera_cb.view = float4x4();
 		//camera_cb.projection = float4x4();
+		camera_cb.position = float4(camera.getPosition().x, camera.getPosition().y, camera.getPosition().z, 1.0f);
+		extractFrustumPlanes(camera.getViewProjectionMatrix(), camera_cb.frustumPlanes);
 		sceneCB.cameraCB = camera_cb;
-		sceneCB.instanceDataAddress = m_GpuScene->getInstanceAddress();
+		sceneCB.instanceBufferSRV = m_GpuScene->getInstanceBufferSRV()->getDescriptorArrayIndex();
 		sceneCB.sceneStaticBufferSRV = m_GpuScene->getSceneStaticBufferSRV()->getDescriptorArrayIndex();
 		sceneCB.sceneConstantBufferSRV = m_GpuScene->getSceneConstantSRV()->getDescriptorArrayIndex();;
 
-		cmd->setGraphicsConstants(2, &sceneCB, sizeof(SceneConstant));
-
 		if (cmd->getQueueType() == rhi::CommandType::Graphics)
 		{
 			cmd->setGraphicsConstants(2, &sceneCB, sizeof(sceneCB));
@@ -1,11 +1,14 @@
 #pragma once
 #include <array>
 #include <vector>
+#include <deque>
 #include"core/engine.hpp"
 #include "engine_core.h"
 #include "render_graph/render_graph.hpp"
 #include "shader_cache.hpp"
 #include "staging_buffer_allocator.hpp"
+#include "async_upload_queue.hpp"
+#include "readback_manager.hpp"
 #include "glm/glm.hpp"
 #include "gpu_scene.hpp"
 
@@ -19,6 +22,15 @@ namespace SE
 	class ShaderCompiler;
 	class Camera;
 
+	struct UploadStats
+	{
+		uint64_t directBytes = 0;  // written straight into mapped GPU memory
+		uint64_t stagingBytes = 0; // copied through staging buffers on the copy queue
+		uint32_t stagedUploads = 0; // buffer and texture uploads requested through staging
+		uint32_t copyCommands = 0; // copy commands recorded for them after merging
+		uint32_t copyRegions = 0;
+	};
+
 	class Renderer
 	{
 	public:
@@ -42,11 +54,43 @@ namespace SE
 		rhi::IDevice* getDevice() const { return m_Device.get(); }
 		ShaderCompiler* getShaderCompiler() const { return m_ShaderCompiler.get(); }
 		ShaderCache* getShaderCache() const { return m_ShaderCache.get(); }
+		GpuScene* getGpuScene() const { return m_GpuScene.get(); }
+		AsyncUploadQueue* getAsyncUploadQueue() const { return m_AsyncUploadQueue.get(); }
 		uint64_t getFrameID() { return m_Device->getFrameID(); };
 		rhi::ISwapchain* getSwapchain() const { return m_Swapchain.get(); }
 		rhi::ITexture* getRenderTarget() const { return m_OutputTextureColor.get(); }
+		const rhi::CommandListStats& getCommandListStats() const { return m_CommandListStats; }
+		float getGpuFrameTimeMs() const { return m_GpuFrameTimeMs; }
+		const rhi::PipelineStatistics& getForwardPassStatistics() const { return m_ForwardPassStatistics; }
+		bool isMeshShadingEnabled() const { return m_MeshletPipeline && m_MeshShadingEnabled; }
+		void setMeshShadingEnabled(bool enabled) { m_MeshShadingEnabled = enabled; }
+		bool dumpMemoryStats(const std::string& path) const;
+		// Compacts the upload pool over the next frames, one pass per frame
+		void requestMemoryDefragmentation() { m_DefragmentMemory = true; }
+		uint64_t getLastDefragmentedBytes() const { return m_Device->getLastDefragmentedBytes(); }
+		ReadbackManager* getReadbackManager() const { return m_ReadbackManager.get(); }
+		// Saves the next presented frame as a binary PPM once it has been read back
+		void requestScreenshot(const std::string& path) { m_ScreenshotPath = path; }
 		void uploadTexture(rhi::ITexture* texture, const void* data);
 		void uploadBuffer(rhi::IBuffer* buffer, uint32_t offset, const void* data, uint32_t data_size);
+		// Memory type for a GPU buffer filled from the CPU, small buffers are written directly when possible
+		rhi::MemoryType getUploadMemoryType(rhi::MemoryType memType, uint32_t size) const;
+		const UploadStats& getUploadStats() const { return m_LastFrameUploadStats; }
+		const UploadStats& getTotalUploadStats() const { return m_TotalUploadStats; }
+		// Copy queue time and throughput of the last measured frame with staged uploads, 0 without copy queue timestamps
+		float getUploadTimeMs() const { return m_UploadTimeMs; }
+		float getUploadThroughputMBps() const { return m_UploadThroughputMBps; }
+		StagingStats getStagingStats() const;
+		const InstanceUploadStats& getInstanceUploadStats() const { return m_GpuScene->getInstanceUploadStats(); }
+		// Thread safe, streamed on the copy queue outside the frame. Returns the upload value to pass to waitForUpload()
+		// before the resource is first used, 0 when it was written directly
+		uint64_t uploadBufferAsync(rhi::IBuffer* buffer, uint32_t offset, const void* data, uint32_t data_size);
+		// Same without copying data on the calling thread, owner keeps it alive until it reached staging memory
+		uint64_t uploadBufferAsync(rhi::IBuffer* buffer, uint32_t offset, Shared<const void> owner, const void* data, uint32_t data_size);
+		uint64_t uploadTextureAsync(rhi::ITexture* texture, const void* data);
+		// The graphics queue of the current frame waits for the upload, only when it has not waited for it already
+		void waitForUpload(uint64_t uploadValue) { m_RequiredAsyncUploadValue = std::max(m_RequiredAsyncUploadValue, uploadValue); }
+		AsyncUploadStats getAsyncUploadStats() const { return m_AsyncUploadQueue->getStats(); }
 	private:
 		Scoped<rhi::IDevice> m_Device = nullptr;
 		Scoped<rhi::ISwapchain> m_Swapchain = nullptr;
@@ -64,6 +108,9 @@ namespace SE
 		rhi::IShader* m_TestShaderVS;
 		rhi::IShader* m_TestShaderPS;
 
+		Scoped<rhi::IPipelineState> m_MeshletPipeline;
+		bool m_MeshShadingEnabled = true;
+
 		Scoped<StructuredBuffer> m_VertexBuffer;
 
 		struct FrameResources {
@@ -71,9 +118,22 @@ namespace SE
 			Scoped<rhi::ICommandList> commandList = nullptr;
 			Scoped<rhi::ICommandList> computeCommandList = nullptr;
 			Scoped<rhi::ICommandList> uploadCommandList = nullptr;
-			Scoped<StagingBufferAllocator> stagingBufferAllocator = nullptr;
+			uint64_t uploadBytes = 0; // copied on the copy queue, pairs with the upload timestamps of this frame slot
 		};
 
+		Scoped<ReadbackManager> m_ReadbackManager = nullptr;
+		std::string m_ScreenshotPath;
+
+		// Results trail the frame by SE_MAX_FRAMES_IN_FLIGHT frames
+		Scoped<rhi::IQueryHeap> m_FrameTimestampHeap = nullptr;
+		Scoped<rhi::IQueryHeap> m_PipelineStatisticsHeap = nullptr;
+		Scoped<rhi::IQueryHeap> m_UploadTimestampHeap = nullptr;
+		float m_GpuFrameTimeMs = 0.0f;
+		float m_UploadTimeMs = 0.0f;
+		float m_UploadThroughputMBps = 0.0f;
+		bool m_DefragmentMemory = false;
+		rhi::PipelineStatistics m_ForwardPassStatistics;
+
 		Scoped<rhi::IFence> m_UploadFence = nullptr;
 		Scoped<rhi::IFence> m_FrameFence = nullptr;
 		uint64_t m_CurrenFrameFenceValue = 0;
@@ -83,14 +143,18 @@ namespace SE
 		Scoped<ShaderCompiler> m_ShaderCompiler;
 		Scoped<ShaderCache> m_ShaderCache;
 		Scoped<GpuScene> m_GpuScene;
+		// Destroyed before the scene and the device, its thread may still be copying into their resources
+		Scoped<AsyncUploadQueue> m_AsyncUploadQueue;
+		uint64_t m_RequiredAsyncUploadValue = 0;
+		uint64_t m_WaitedAsyncUploadValue = 0;
 
 		struct TextureUpload
 		{
 			rhi::ITexture* texture;
-			uint32_t mip_level;
-			uint32_t array_slice;
 			StagingBuffer staging_buffer;
 			uint32_t offset;
+			std::vector<rhi::SubresourceFootprint> footprints;
+			bool last_chunk; // streamed textures stay in TransferDst until their last subresource arrived
 		};
 		std::vector<TextureUpload> m_PendingTextureUploads;
 
@@ -101,10 +165,35 @@ namespace SE
 			StagingBuffer staging_buffer;
 		};
 		std::vector<BufferUpload> m_PendingBufferUpload;
+
+		// Uploads that did not fit into the staging ring, copied out of the caller's memory and streamed in chunks
+		struct StreamedUpload
+		{
+			rhi::IBuffer* buffer = nullptr;
+			rhi::ITexture* texture = nullptr;
+			uint32_t offset = 0;
+			std::vector<rhi::SubresourceFootprint> footprints;
+			std::vector<char> data;
+			uint32_t dataOffset = 0;
+			uint32_t progress = 0;
+		};
+		std::deque<StreamedUpload> m_StreamedUploads;
+		uint64_t m_StreamingBytes = 0;
+		Scoped<StagingBufferAllocator> m_StagingBufferAllocator = nullptr;
+		UploadStats m_UploadStats;
+		UploadStats m_LastFrameUploadStats;
+		UploadStats m_TotalUploadStats;
+
+		rhi::CommandListStats m_CommandListStats;
 	private:
 		void onWindowResize(uint32_t width, uint32_t height);
 		void onViewportResize(uint32_t width, uint32_t height);
 		void waitForPreviousFrame();
+		bool allocateStaging(uint32_t size, uint32_t alignment, StagingBuffer& staging);
+		void streamUploads();
+		void waitAsyncUploads(rhi::ICommandList* commandList);
+		void recordBufferUploads(rhi::ICommandList* commandList);
+		void recordBufferCopies(rhi::ICommandList* commandList, std::vector<BufferUpload>& batch);
 		void copyToBackBuffer(rhi::ICommandList* commandList);
 	private:
 		void initFrameResources();
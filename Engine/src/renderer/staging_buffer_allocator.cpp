@@ -1,58 +1,133 @@
 #include "staging_buffer_allocator.hpp"
 #include "renderer.hpp"
 #include "../RHI/types.hpp"
-
-#define BUFFER_SIZE (64 * 1024 * 1024)
+#include <algorithm>
+#include <chrono>
 
 namespace SE
 {
-	StagingBuffer StagingBufferAllocator::allocate(uint32_t size)
+	StagingBufferAllocator::StagingBufferAllocator(Renderer* pRenderer, rhi::IFence* uploadFence, uint32_t size)
+		: m_Renderer(pRenderer), m_UploadFence(uploadFence), m_Size(size)
 	{
-		SE_ASSERT_NOMSG(size <= BUFFER_SIZE);
+		rhi::BufferDescription desc;
+		desc.size = size;
+		desc.memoryType = rhi::MemoryType::CpuOnly;
+		// Persistently mapped, defragmentation only relocates mapped staging memory
+		desc.mapped = true;
+		m_Buffer.reset(m_Renderer->getDevice()->createBuffer(desc, "StagingBufferAllocator::m_Buffer"));
+		SE_ASSERT(m_Buffer, "Staging ring creation failed");
+
+		m_Stats.ringSize = size;
+	}
 
-		if (m_pBuffers.empty())
+	bool StagingBufferAllocator::allocate(uint32_t size, uint32_t alignment, StagingBuffer& staging)
+	{
+		if (size > m_Size)
 		{
-			createNewBuffer();
+			return false;
 		}
 
-		if (m_AllocatedSize + size > BUFFER_SIZE)
+		if (m_UsedSize == 0)
+		{
+			m_Head = 0;
+			m_Tail = 0;
+		}
+		else if (m_UsedSize == m_Size)
 		{
-			createNewBuffer();
-			m_CurrentBuffer++;
-			m_AllocatedSize = 0;
+			return false;
 		}
 
-		StagingBuffer buffer;
-		buffer.buffer = m_pBuffers[m_CurrentBuffer].get();
-		buffer.size = size;
-		buffer.offset = m_AllocatedSize;
+		// Texture copies of 3 and 12 byte formats need alignments that are not a power of two
+		uint32_t alignedHead = (m_Head + alignment - 1) / alignment * alignment;
+		uint32_t offset = 0;
+		uint32_t allocatedSize = 0;
+		if (m_Head >= m_Tail)
+		{
+			if (alignedHead + size <= m_Size)
+			{
+				offset = alignedHead;
+				allocatedSize = alignedHead - m_Head + size;
+			}
+			else if (size <= m_Tail)
+			{
+				// Wrap around, the end of the ring stays unused until this batch retires
+				offset = 0;
+				allocatedSize = m_Size - m_Head + size;
+			}
+			else
+			{
+				return false;
+			}
+		}
+		else if (alignedHead + size <= m_Tail)
+		{
+			offset = alignedHead;
+			allocatedSize = alignedHead - m_Head + size;
+		}
+		else
+		{
+			return false;
+		}
 
-		m_AllocatedSize += SE::alignToPowerOfTwo<uint32_t>(size, 256);
-		m_LastAllocatedFrame = m_Renderer->getFrameID();
+		m_Head = offset + size;
+		m_UsedSize += allocatedSize;
+		m_BatchSize += allocatedSize;
+		m_Stats.highWater = std::max(m_Stats.highWater, m_UsedSize);
 
-		return buffer;
+		staging.buffer = m_Buffer.get();
+		staging.size = size;
+		staging.offset = offset;
+		return true;
 	}
 
-	void StagingBufferAllocator::reset()
+	bool StagingBufferAllocator::waitForSpace()
 	{
-		m_CurrentBuffer = 0;
-		m_AllocatedSize = 0;
+		if (m_Batches.empty())
+		{
+			return false;
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		m_UploadFence->wait(m_Batches.front().fenceValue);
+		auto end = std::chrono::high_resolution_clock::now();
+		m_FrameStallTimeMs += std::chrono::duration<float, std::milli>(end - start).count();
+
+		retire();
+		return true;
+	}
 
-		if (!m_pBuffers.empty())
+	void StagingBufferAllocator::endBatch(uint64_t fenceValue)
+	{
+		if (m_BatchSize > 0)
 		{
-			if (m_Renderer->getFrameID() - m_LastAllocatedFrame > 100)
-			{
-				m_pBuffers.clear();
-			}
+			m_Batches.push_back({ fenceValue, m_Head, m_BatchSize });
+			m_BatchSize = 0;
 		}
 	}
 
-	void StagingBufferAllocator::createNewBuffer()
+	void StagingBufferAllocator::retire()
 	{
-		rhi::BufferDescription desc;
-		desc.size = BUFFER_SIZE;
-		desc.memoryType = rhi::MemoryType::CpuOnly;
-		rhi::IBuffer* buffer = m_Renderer->getDevice()->createBuffer(desc, "StagingBufferAllocator::m_pBuffer");
-		m_pBuffers.push_back(Scoped<rhi::IBuffer>(buffer));
+		uint64_t completedValue = m_UploadFence->getCompletedValue();
+		while (!m_Batches.empty() && m_Batches.front().fenceValue <= completedValue)
+		{
+			m_Tail = m_Batches.front().end;
+			m_UsedSize -= m_Batches.front().size;
+			m_Batches.pop_front();
+		}
+	}
+
+	void* StagingBufferAllocator::getCpuAddress(const StagingBuffer& staging) const
+	{
+		// Defragmentation may relocate the mapping, it is not cached
+		return (char*)m_Buffer->getCpuAddress() + staging.offset;
+	}
+
+	void StagingBufferAllocator::beginFrame()
+	{
+		retire();
+
+		m_Stats.usedSize = m_UsedSize;
+		m_Stats.stallTimeMs = m_FrameStallTimeMs;
+		m_FrameStallTimeMs = 0.0f;
 	}
-}
\ No newline at end of file
+}
@@ -1,6 +1,7 @@
 #pragma once
 #include "../rhi/rhi.hpp"
 #include "engine_core.h"
+#include <deque>
 namespace SE
 {
 	class Renderer;
@@ -12,20 +13,55 @@ namespace SE
 		uint32_t offset;
 	};
 
+	struct StagingStats
+	{
+		uint32_t ringSize = 0;
+		uint32_t usedSize = 0;
+		uint32_t highWater = 0;
+		float stallTimeMs = 0.0f; // producers blocked on the upload fence during the last frame
+		uint64_t streamingBytes = 0; // large uploads still waiting for ring space
+	};
+
+	// Ring over a persistently mapped staging buffer. Allocations made between two endBatch() calls are reclaimed
+	// once the upload fence reaches the value that batch was submitted with.
 	class StagingBufferAllocator
 	{
 	public:
-		StagingBufferAllocator(Renderer* pRenderer) : m_Renderer(pRenderer) {};
-		StagingBuffer allocate(uint32_t size);
-		void reset();
+		StagingBufferAllocator(Renderer* pRenderer, rhi::IFence* uploadFence, uint32_t size);
+		// Does not block, false when the ring has no room left
+		bool allocate(uint32_t size, uint32_t alignment, StagingBuffer& staging);
+		// Blocks until the oldest batch in flight retired, false if there is nothing in flight to wait for
+		bool waitForSpace();
+		void endBatch(uint64_t fenceValue);
+		void retire();
+
+		void* getCpuAddress(const StagingBuffer& staging) const;
+		uint32_t getSize() const { return m_Size; }
+		// Rolls the per-frame stall time over
+		void beginFrame();
+		const StagingStats& getStats() const { return m_Stats; }
+
 	private:
-		void createNewBuffer();
+		struct Batch
+		{
+			uint64_t fenceValue = 0;
+			uint32_t end = 0;
+			uint32_t size = 0;
+		};
 
 	private:
 		Renderer* m_Renderer = nullptr;
-		std::vector<Scoped<rhi::IBuffer>> m_pBuffers;
-		uint32_t m_CurrentBuffer = 0;
-		uint32_t m_AllocatedSize = 0;
-		uint64_t m_LastAllocatedFrame = 0;
+		rhi::IFence* m_UploadFence = nullptr;
+		Scoped<rhi::IBuffer> m_Buffer;
+
+		uint32_t m_Size = 0;
+		uint32_t m_Head = 0;
+		uint32_t m_Tail = 0;
+		uint32_t m_UsedSize = 0;
+		uint32_t m_BatchSize = 0;
+		std::deque<Batch> m_Batches;
+
+		float m_FrameStallTimeMs = 0.0f;
+		StagingStats m_Stats;
 	};
-}
\ No newline at end of file
+}
@@ -0,0 +1,81 @@
+#include "vertex_compression.hpp"
+#include "glm/gtc/packing.hpp"
+
+namespace SE
+{
+	namespace
+	{
+		static uint32_t packOctahedral(glm::vec3 n)
+		{
+			float length = glm::abs(n.x) + glm::abs(n.y) + glm::abs(n.z);
+			if (length == 0.0f)
+			{
+				return glm::packSnorm2x16(glm::vec2(0.0f));
+			}
+
+			n /= length;
+			glm::vec2 e(n.x, n.y);
+			if (n.z < 0.0f)
+			{
+				// Folds the lower hemisphere over the diagonals
+				glm::vec2 signs(e.x >= 0.0f ? 1.0f : -1.0f, e.y >= 0.0f ? 1.0f : -1.0f);
+				e = (1.0f - glm::abs(glm::vec2(e.y, e.x))) * signs;
+			}
+			return glm::packSnorm2x16(e);
+		}
+	}
+
+	void packVertices(const VertexStreams& streams, std::vector<PackedVertex>& output, InstanceData& data)
+	{
+		glm::vec3 boundsMin(FLT_MAX);
+		glm::vec3 boundsMax(-FLT_MAX);
+		for (uint32_t i = 0; i < streams.vertexCount; ++i)
+		{
+			boundsMin = glm::min(boundsMin, streams.positions[i]);
+			boundsMax = glm::max(boundsMax, streams.positions[i]);
+		}
+		if (streams.vertexCount == 0)
+		{
+			boundsMin = boundsMax = glm::vec3(0.0f);
+		}
+
+		glm::vec3 extent = boundsMax - boundsMin;
+		glm::vec3 quantize(extent.x > 0.0f ? 65535.0f / extent.x : 0.0f, extent.y > 0.0f ? 65535.0f / extent.y : 0.0f, extent.z > 0.0f ? 65535.0f / extent.z : 0.0f);
+		data.positionOffset = float4(boundsMin.x, boundsMin.y, boundsMin.z, 0.0f);
+		data.positionScale = float4(extent.x / 65535.0f, extent.y / 65535.0f, extent.z / 65535.0f, 0.0f);
+
+		output.resize(streams.vertexCount);
+		for (uint32_t i = 0; i < streams.vertexCount; ++i)
+		{
+			glm::uvec3 position = glm::uvec3(glm::clamp((streams.positions[i] - boundsMin) * quantize + 0.5f, glm::vec3(0.0f), glm::vec3(65535.0f)));
+			glm::vec3 normal = streams.normals ? streams.normals[i] : glm::vec3(0.0f, 0.0f, 1.0f);
+			glm::vec4 tangent = streams.tangents ? streams.tangents[i] : glm::vec4(1.0f, 0.0f, 0.0f, 1.0f);
+			glm::vec2 uv = streams.uvs ? streams.uvs[i] : glm::vec2(0.0f);
+
+			PackedVertex& vertex = output[i];
+			vertex.positionXY = position.x | (position.y << 16);
+			vertex.positionZ = position.z | (tangent.w < 0.0f ? 0x80000000u : 0u);
+			vertex.normal = packOctahedral(normal);
+			vertex.tangent = packOctahedral(glm::vec3(tangent));
+			vertex.uv = glm::packHalf2x16(uv);
+		}
+	}
+
+	void packIndices(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, std::vector<uint32_t>& output, InstanceData& data)
+	{
+		data.indexCount = indexCount;
+		if (vertexCount > 0xFFFF + 1)
+		{
+			output.assign(indices, indices + indexCount);
+			data.flags &= ~INSTANCE_FLAG_16BIT_INDICES;
+			return;
+		}
+
+		output.assign((indexCount + 1) / 2, 0);
+		for (uint32_t i = 0; i < indexCount; ++i)
+		{
+			output[i / 2] |= indices[i] << ((i & 1) * 16);
+		}
+		data.flags |= INSTANCE_FLAG_16BIT_INDICES;
+	}
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include "engine_core.h"
+#include "glm/glm.hpp"
+#include "utils/math.hpp"
+#include <gpu_scene.hlsli>
+#include <vector>
+
+namespace SE
+{
+	// Source streams of a mesh, everything but the positions is optional
+	struct VertexStreams
+	{
+		const glm::vec3* positions = nullptr;
+		const glm::vec3* normals = nullptr;
+		const glm::vec4* tangents = nullptr; // w: handedness
+		const glm::vec2* uvs = nullptr;
+		uint32_t vertexCount = 0;
+	};
+
+	// Quantizes positions to 16 bits inside the mesh bounds, normals and tangents to octahedral 16-bit snorm pairs and
+	// uvs to halfs. Fills the dequantization fields of the instance
+	void packVertices(const VertexStreams& streams, std::vector<PackedVertex>& output, InstanceData& data);
+	// Uses 16-bit indices when every vertex is addressable with them, the output is padded to whole uints
+	void packIndices(const uint32_t* indices, uint32_t indexCount, uint32_t vertexCount, std::vector<uint32_t>& output, InstanceData& data);
+}
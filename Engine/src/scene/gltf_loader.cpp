@@ -0,0 +1,305 @@
+#include "gltf_loader.hpp"
+#include "renderer/renderer.hpp"
+#include "renderer/vertex_compression.hpp"
+#include "utils/thread_pool.hpp"
+#include <fastgltf/glm_element_traits.hpp>
+#include <fastgltf/parser.hpp>
+#include <fastgltf/tools.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <stb_image.h>
+#include <numeric>
+
+namespace SE
+{
+	namespace
+	{
+		using Clock = std::chrono::high_resolution_clock;
+
+		struct PrimitiveTask
+		{
+			size_t mesh = 0;
+			size_t primitive = 0;
+			glm::mat4 transform = glm::mat4(1.0f);
+		};
+
+		struct DecodedImage
+		{
+			stbi_uc* pixels = nullptr; // RGBA8
+			int width = 0;
+			int height = 0;
+		};
+
+		static float elapsedMs(Clock::time_point start)
+		{
+			return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+		}
+
+		static glm::mat4 getLocalTransform(const fastgltf::Node& node)
+		{
+			glm::mat4 transform(1.0f);
+			std::visit(fastgltf::visitor{
+				[&](const fastgltf::Node::TransformMatrix& matrix)
+				{
+					memcpy(&transform, matrix.data(), sizeof(matrix));
+				},
+				[&](const fastgltf::Node::TRS& trs)
+				{
+					glm::vec3 translation(trs.translation[0], trs.translation[1], trs.translation[2]);
+					glm::quat rotation(trs.rotation[3], trs.rotation[0], trs.rotation[1], trs.rotation[2]);
+					glm::vec3 scale(trs.scale[0], trs.scale[1], trs.scale[2]);
+					transform = glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(rotation) * glm::scale(glm::mat4(1.0f), scale);
+				} }, node.transform);
+			return transform;
+		}
+
+		static void collectPrimitives(const fastgltf::Asset& asset, size_t nodeIndex, const glm::mat4& parentTransform, std::vector<PrimitiveTask>& tasks)
+		{
+			const fastgltf::Node& node = asset.nodes[nodeIndex];
+			glm::mat4 transform = parentTransform * getLocalTransform(node);
+			if (node.meshIndex.has_value())
+			{
+				const fastgltf::Mesh& mesh = asset.meshes[*node.meshIndex];
+				for (size_t i = 0; i < mesh.primitives.size(); ++i)
+				{
+					const fastgltf::Primitive& primitive = mesh.primitives[i];
+					if (primitive.type == fastgltf::PrimitiveType::Triangles && primitive.findAttribute("POSITION") != primitive.attributes.end())
+					{
+						tasks.push_back({ *node.meshIndex, i, transform });
+					}
+				}
+			}
+
+			for (size_t child : node.children)
+			{
+				collectPrimitives(asset, child, transform, tasks);
+			}
+		}
+
+		static void decodePrimitive(const fastgltf::Asset& asset, const PrimitiveTask& task, PackedMesh& mesh)
+		{
+			const fastgltf::Primitive& primitive = asset.meshes[task.mesh].primitives[task.primitive];
+			const fastgltf::Accessor& positionAccessor = asset.accessors[primitive.findAttribute("POSITION")->second];
+			uint32_t vertexCount = (uint32_t)positionAccessor.count;
+
+			// Instances have no transform of their own, the node transform goes into the vertices
+			glm::mat3 tangentMatrix(task.transform);
+			glm::mat3 normalMatrix = glm::transpose(glm::inverse(tangentMatrix));
+			bool mirrored = glm::determinant(tangentMatrix) < 0.0f;
+
+			VertexStreams streams;
+			streams.vertexCount = vertexCount;
+
+			std::vector<glm::vec3> positions(vertexCount);
+			fastgltf::iterateAccessorWithIndex<glm::vec3>(asset, positionAccessor, [&](glm::vec3 position, size_t index)
+				{
+					positions[index] = glm::vec3(task.transform * glm::vec4(position, 1.0f));
+				});
+			streams.positions = positions.data();
+
+			std::vector<glm::vec3> normals;
+			auto normalAttribute = primitive.findAttribute("NORMAL");
+			if (normalAttribute != primitive.attributes.end())
+			{
+				normals.resize(vertexCount);
+				fastgltf::iterateAccessorWithIndex<glm::vec3>(asset, asset.accessors[normalAttribute->second], [&](glm::vec3 normal, size_t index)
+					{
+						normals[index] = glm::normalize(normalMatrix * normal);
+					});
+				streams.normals = normals.data();
+			}
+
+			std::vector<glm::vec4> tangents;
+			auto tangentAttribute = primitive.findAttribute("TANGENT");
+			if (tangentAttribute != primitive.attributes.end())
+			{
+				tangents.resize(vertexCount);
+				fastgltf::iterateAccessorWithIndex<glm::vec4>(asset, asset.accessors[tangentAttribute->second], [&](glm::vec4 tangent, size_t index)
+					{
+						tangents[index] = glm::vec4(glm::normalize(tangentMatrix * glm::vec3(tangent)), mirrored ? -tangent.w : tangent.w);
+					});
+				streams.tangents = tangents.data();
+			}
+
+			std::vector<glm::vec2> uvs;
+			auto uvAttribute = primitive.findAttribute("TEXCOORD_0");
+			if (uvAttribute != primitive.attributes.end())
+			{
+				uvs.resize(vertexCount);
+				fastgltf::iterateAccessorWithIndex<glm::vec2>(asset, asset.accessors[uvAttribute->second], [&](glm::vec2 uv, size_t index)
+					{
+						uvs[index] = uv;
+					});
+				streams.uvs = uvs.data();
+			}
+
+			std::vector<uint32_t> indices;
+			if (primitive.indicesAccessor.has_value())
+			{
+				const fastgltf::Accessor& indexAccessor = asset.accessors[*primitive.indicesAccessor];
+				indices.resize(indexAccessor.count);
+				fastgltf::iterateAccessorWithIndex<uint32_t>(asset, indexAccessor, [&](uint32_t vertexIndex, size_t index)
+					{
+						indices[index] = vertexIndex;
+					});
+			}
+			else
+			{
+				indices.resize(vertexCount);
+				std::iota(indices.begin(), indices.end(), 0u);
+			}
+
+			// A negative scale turns the triangles inside out
+			if (mirrored)
+			{
+				for (size_t i = 0; i + 2 < indices.size(); i += 3)
+				{
+					std::swap(indices[i + 1], indices[i + 2]);
+				}
+			}
+
+			GpuScene::packMesh(streams, indices.data(), (uint32_t)indices.size(), mesh);
+		}
+
+		// Base color and emissive maps hold sRGB encoded colors, every other map holds linear data
+		static void collectColorImages(const fastgltf::Asset& asset, std::vector<bool>& colorImages)
+		{
+			auto markImage = [&](size_t textureIndex)
+				{
+					const fastgltf::Texture& texture = asset.textures[textureIndex];
+					if (texture.imageIndex.has_value())
+					{
+						colorImages[texture.imageIndex.value()] = true;
+					}
+				};
+
+			for (const fastgltf::Material& material : asset.materials)
+			{
+				if (material.pbrData.baseColorTexture.has_value())
+				{
+					markImage(material.pbrData.baseColorTexture->textureIndex);
+				}
+				if (material.emissiveTexture.has_value())
+				{
+					markImage(material.emissiveTexture->textureIndex);
+				}
+			}
+		}
+
+		static void decodeImage(const fastgltf::Asset& asset, const fastgltf::Image& image, const std::filesystem::path& directory, DecodedImage& decoded)
+		{
+			int channels = 0;
+			std::visit(fastgltf::visitor{
+				[](const auto&) {},
+				[&](const fastgltf::sources::URI& uri)
+				{
+					std::string path = (directory / std::string(uri.uri.path().begin(), uri.uri.path().end())).string();
+					decoded.pixels = stbi_load(path.c_str(), &decoded.width, &decoded.height, &channels, 4);
+				},
+				[&](const fastgltf::sources::Vector& vector)
+				{
+					decoded.pixels = stbi_load_from_memory(vector.bytes.data(), (int)vector.bytes.size(), &decoded.width, &decoded.height, &channels, 4);
+				},
+				[&](const fastgltf::sources::BufferView& view)
+				{
+					const fastgltf::BufferView& bufferView = asset.bufferViews[view.bufferViewIndex];
+					std::visit(fastgltf::visitor{
+						[](const auto&) {},
+						[&](const fastgltf::sources::Vector& vector)
+						{
+							decoded.pixels = stbi_load_from_memory(vector.bytes.data() + bufferView.byteOffset, (int)bufferView.byteLength,
+								&decoded.width, &decoded.height, &channels, 4);
+						} }, asset.buffers[bufferView.bufferIndex].data);
+				} }, image.data);
+		}
+	}
+
+	Shared<LoadedScene> loadGLTF(Renderer* renderer, ThreadPool& threadPool, const std::filesystem::path& path)
+	{
+		Clock::time_point start = Clock::now();
+		Shared<LoadedScene> scene = createShared<LoadedScene>();
+		scene->name = path.filename().string();
+		scene->gpuScene = renderer->getGpuScene();
+		SceneImportStats& stats = scene->stats;
+
+		fastgltf::GltfDataBuffer data;
+		if (!data.loadFromFile(path))
+		{
+			LogError("Failed to read glTF file {}", path.string());
+			return nullptr;
+		}
+
+		constexpr fastgltf::Options options = fastgltf::Options::DontRequireValidAssetMember | fastgltf::Options::AllowDouble |
+			fastgltf::Options::LoadGLBBuffers | fastgltf::Options::LoadExternalBuffers;
+		fastgltf::Parser parser;
+		auto asset = fastgltf::determineGltfFileType(&data) == fastgltf::GltfType::GLB ?
+			parser.loadBinaryGLTF(&data, path.parent_path(), options) : parser.loadGLTF(&data, path.parent_path(), options);
+		if (asset.error() != fastgltf::Error::None)
+		{
+			LogError("Failed to parse glTF file {}: error {}", path.string(), (uint32_t)fastgltf::to_underlying(asset.error()));
+			return nullptr;
+		}
+
+		std::vector<PrimitiveTask> tasks;
+		if (!asset->scenes.empty())
+		{
+			const fastgltf::Scene& gltfScene = asset->scenes[asset->defaultScene.value_or(0)];
+			for (size_t node : gltfScene.nodeIndices)
+			{
+				collectPrimitives(asset.get(), node, glm::mat4(1.0f), tasks);
+			}
+		}
+		stats.parseMs = elapsedMs(start);
+
+		start = Clock::now();
+		std::vector<Shared<PackedMesh>> meshes(tasks.size());
+		std::vector<DecodedImage> images(asset->images.size());
+		uint32_t imageCount = (uint32_t)images.size();
+		threadPool.parallelFor(imageCount + (uint32_t)tasks.size(), [&](uint32_t i)
+			{
+				// Images are the longest tasks, they start first
+				if (i < imageCount)
+				{
+					decodeImage(asset.get(), asset->images[i], path.parent_path(), images[i]);
+					return;
+				}
+
+				uint32_t task = i - imageCount;
+				meshes[task] = createShared<PackedMesh>();
+				decodePrimitive(asset.get(), tasks[task], *meshes[task]);
+			});
+		stats.decodeMs = elapsedMs(start);
+
+		start = Clock::now();
+		for (const Shared<PackedMesh>& mesh : meshes)
+		{
+			scene->addMesh(mesh);
+		}
+
+		std::vector<bool> colorImages(imageCount, false);
+		collectColorImages(asset.get(), colorImages);
+
+		uint64_t textureUploadValue = 0;
+		for (uint32_t i = 0; i < imageCount; ++i)
+		{
+			DecodedImage& image = images[i];
+			if (!image.pixels)
+			{
+				LogWarn("Failed to decode image {} of {}", i, scene->name);
+				continue;
+			}
+
+			rhi::Format format = colorImages[i] ? rhi::Format::R8G8B8A8_SRGB : rhi::Format::R8G8B8A8_UNORM;
+			uint64_t uploadValue = scene->addTexture(renderer, std::string(asset->images[i].name), image.pixels, (uint32_t)image.width, (uint32_t)image.height, format);
+			textureUploadValue = std::max(textureUploadValue, uploadValue);
+			stbi_image_free(image.pixels);
+		}
+		// Moves the textures out of TransferDst once they arrived
+		renderer->waitForUpload(textureUploadValue);
+		stats.uploadMs = elapsedMs(start);
+
+		LogInfo("Imported {}: {} instances, {} vertices, {} triangles, {} textures. Parse {:.2f} ms, decode {:.2f} ms on {} threads, upload {:.2f} ms",
+			scene->name, stats.instances, stats.vertices, stats.triangles, stats.textures, stats.parseMs, stats.decodeMs,
+			threadPool.getThreadCount(), stats.uploadMs);
+		return scene;
+	}
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include "loaded_scene.hpp"
+#include <filesystem>
+
+namespace SE
+{
+	class Renderer;
+	class ThreadPool;
+
+	// Parses a .gltf or .glb file, decodes its primitives and images on the thread pool and adds one instance per
+	// node primitive with the node transform baked into the vertices. Returns nullptr when the file can not be parsed
+	Shared<LoadedScene> loadGLTF(Renderer* renderer, ThreadPool& threadPool, const std::filesystem::path& path);
+}
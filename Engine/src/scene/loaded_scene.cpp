@@ -0,0 +1,42 @@
+#include "loaded_scene.hpp"
+#include "renderer/renderer.hpp"
+
+namespace SE
+{
+	LoadedScene::~LoadedScene()
+	{
+		for (InstanceHandle instance : instances)
+		{
+			if (gpuScene->isValid(instance))
+			{
+				gpuScene->removeInstance(instance);
+			}
+		}
+	}
+
+	void LoadedScene::addMesh(const Shared<PackedMesh>& mesh)
+	{
+		std::vector<OffsetAllocator::Allocation> allocations;
+		gpuScene->uploadMesh(mesh, &allocations);
+		instances.push_back(gpuScene->addInstance(mesh->data, allocations));
+
+		uint32_t indexCount = (uint32_t)mesh->indices.size() * ((mesh->data.flags & INSTANCE_FLAG_16BIT_INDICES) ? 2 : 1);
+		stats.instances++;
+		stats.vertices += (uint32_t)mesh->vertices.size();
+		stats.triangles += indexCount / 3;
+	}
+
+	uint64_t LoadedScene::addTexture(Renderer* renderer, const std::string& textureName, const void* pixels, uint32_t width, uint32_t height, rhi::Format format)
+	{
+		Scoped<Texture2D> texture = createScoped<Texture2D>(fmt::format("{}::{}", name, textureName));
+		if (!texture->create(width, height, 1, format, rhi::TextureUsageFlags::None))
+		{
+			return 0;
+		}
+
+		uint64_t uploadValue = renderer->uploadTextureAsync(texture->getTexture(), pixels);
+		textures.push_back(std::move(texture));
+		stats.textures++;
+		return uploadValue;
+	}
+}
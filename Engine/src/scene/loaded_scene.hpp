@@ -0,0 +1,39 @@
+#pragma once
+#include "engine_core.h"
+#include "renderer/gpu_scene.hpp"
+#include "renderer/resources/texture2D.hpp"
+#include <string>
+#include <vector>
+
+namespace SE
+{
+	// CPU time of each import phase, upload is the hand off to the async upload queue
+	struct SceneImportStats
+	{
+		float parseMs = 0.0f;
+		float decodeMs = 0.0f;
+		float uploadMs = 0.0f;
+		uint32_t instances = 0;
+		uint32_t vertices = 0;
+		uint32_t triangles = 0;
+		uint32_t textures = 0;
+	};
+
+	// Everything an imported file added to the renderer, its instances leave the GpuScene with it
+	struct LoadedScene
+	{
+		~LoadedScene();
+
+		// Streams the mesh to the static buffer and adds its instance
+		void addMesh(const Shared<PackedMesh>& mesh);
+		// Creates an RGBA8 texture of the given UNORM or SRGB format and queues its upload, returns the upload value or 0
+		// when creation failed
+		uint64_t addTexture(Renderer* renderer, const std::string& textureName, const void* pixels, uint32_t width, uint32_t height, rhi::Format format);
+
+		std::string name;
+		GpuScene* gpuScene = nullptr;
+		std::vector<InstanceHandle> instances;
+		std::vector<Scoped<Texture2D>> textures;
+		SceneImportStats stats;
+	};
+}
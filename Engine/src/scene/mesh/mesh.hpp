@@ -15,10 +15,7 @@ namespace SE
 		Renderer* m_pRenderer = nullptr;
 		std::string m_DebugName;
 
-		OffsetAllocator::Allocation m_PosBuffer;
-		OffsetAllocator::Allocation m_UvBuffer;
-		OffsetAllocator::Allocation m_NormalBuffer;
-		OffsetAllocator::Allocation m_TangentBuffer;
+		OffsetAllocator::Allocation m_VertexBuffer; // PackedVertex stream
 
 		OffsetAllocator::Allocation m_IndexBuffer;
 		rhi::Format m_indexBufferFormat;
@@ -26,6 +23,6 @@ namespace SE
 		uint32_t m_VertexCount = 0;
 
 		InstanceData m_InstanceData = {};
-		uint32_t m_InstanceIndex = 0;
+		InstanceHandle m_Instance;
 	};
 };
\ No newline at end of file
@@ -0,0 +1,455 @@
+#include "obj_loader.hpp"
+#include "renderer/renderer.hpp"
+#include "renderer/vertex_compression.hpp"
+#include "utils/mapped_file.hpp"
+#include "utils/thread_pool.hpp"
+#include <charconv>
+#include <cstring>
+#include <unordered_map>
+// Chunks are at least this large, small files are parsed by fewer threads
+#define OBJ_MIN_CHUNK_SIZE (256 * 1024)
+// More chunks than threads even out lines of different cost
+#define OBJ_CHUNKS_PER_THREAD 4
+
+namespace SE
+{
+	namespace
+	{
+		using Clock = std::chrono::high_resolution_clock;
+
+		enum CornerComponent : uint32_t
+		{
+			CornerPosition = 1 << 0,
+			CornerUV = 1 << 1,
+			CornerNormal = 1 << 2
+		};
+
+		// Zero based indices into the merged streams, -1 when the corner has no such attribute
+		struct FaceCorner
+		{
+			int32_t position = -1;
+			int32_t uv = -1;
+			int32_t normal = -1;
+			uint32_t relativeMask = 0; // negative indices are resolved against the chunk until its streams are merged
+		};
+
+		struct CornerHash
+		{
+			size_t operator()(const FaceCorner& corner) const
+			{
+				uint64_t hash = (uint64_t)(uint32_t)corner.position * 0x9E3779B97F4A7C15ull;
+				hash ^= (uint64_t)(uint32_t)corner.uv + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+				hash ^= (uint64_t)(uint32_t)corner.normal + 0x9E3779B97F4A7C15ull + (hash << 6) + (hash >> 2);
+				return (size_t)hash;
+			}
+		};
+
+		struct CornerEqual
+		{
+			bool operator()(const FaceCorner& a, const FaceCorner& b) const
+			{
+				return a.position == b.position && a.uv == b.uv && a.normal == b.normal;
+			}
+		};
+
+		struct MaterialSwitch
+		{
+			std::string material;
+			uint32_t firstCorner = 0;
+		};
+
+		struct ObjChunk
+		{
+			const char* begin = nullptr;
+			const char* end = nullptr;
+			std::vector<glm::vec3> positions;
+			std::vector<glm::vec3> normals;
+			std::vector<glm::vec2> uvs;
+			std::vector<FaceCorner> corners; // triangle list
+			std::vector<MaterialSwitch> materialSwitches;
+			bool hasRelativeIndices = false;
+		};
+
+		struct CornerSpan
+		{
+			const ObjChunk* chunk = nullptr;
+			uint32_t begin = 0;
+			uint32_t end = 0;
+		};
+
+		struct ObjMaterial
+		{
+			std::string name;
+			std::vector<CornerSpan> spans; // in file order
+		};
+
+		static float elapsedMs(Clock::time_point start)
+		{
+			return std::chrono::duration<float, std::milli>(Clock::now() - start).count();
+		}
+
+		static bool isBlank(char c)
+		{
+			return c == ' ' || c == '\t' || c == '\r';
+		}
+
+		static const char* skipBlanks(const char* p, const char* end)
+		{
+			while (p < end && isBlank(*p))
+			{
+				++p;
+			}
+			return p;
+		}
+
+		template<size_t N>
+		static bool isKeyword(const char* p, const char* end, const char(&keyword)[N])
+		{
+			return (size_t)(end - p) > N - 1 && memcmp(p, keyword, N - 1) == 0 && isBlank(p[N - 1]);
+		}
+
+		// Rest of the line without surrounding blanks
+		static std::string parseName(const char* p, const char* end)
+		{
+			p = skipBlanks(p, end);
+			while (end > p && isBlank(end[-1]))
+			{
+				--end;
+			}
+			return std::string(p, end);
+		}
+
+		static const char* parseFloat(const char* p, const char* end, float& value)
+		{
+			p = skipBlanks(p, end);
+			if (p < end && *p == '+')
+			{
+				++p;
+			}
+			return std::from_chars(p, end, value).ptr;
+		}
+
+		static const char* parseIndex(const char* p, const char* end, size_t count, CornerComponent component, FaceCorner& corner, int32_t& index)
+		{
+			int32_t value = 0;
+			const char* next = std::from_chars(p, end, value).ptr;
+			if (value > 0)
+			{
+				index = value - 1;
+			}
+			else if (value < 0)
+			{
+				index = (int32_t)count + value;
+				corner.relativeMask |= component;
+			}
+			return next;
+		}
+
+		static void parseFace(const char* p, const char* end, ObjChunk& chunk, std::vector<FaceCorner>& polygon)
+		{
+			polygon.clear();
+			while (true)
+			{
+				p = skipBlanks(p, end);
+				if (p >= end || *p == '#')
+				{
+					break;
+				}
+
+				FaceCorner corner;
+				p = parseIndex(p, end, chunk.positions.size(), CornerPosition, corner, corner.position);
+				if (p < end && *p == '/')
+				{
+					++p;
+					if (p < end && *p != '/')
+					{
+						p = parseIndex(p, end, chunk.uvs.size(), CornerUV, corner, corner.uv);
+					}
+					if (p < end && *p == '/')
+					{
+						p = parseIndex(p + 1, end, chunk.normals.size(), CornerNormal, corner, corner.normal);
+					}
+				}
+				// Skips whatever could not be parsed
+				while (p < end && !isBlank(*p))
+				{
+					++p;
+				}
+
+				chunk.hasRelativeIndices |= corner.relativeMask != 0;
+				polygon.push_back(corner);
+			}
+
+			for (size_t i = 2; i < polygon.size(); ++i)
+			{
+				chunk.corners.push_back(polygon[0]);
+				chunk.corners.push_back(polygon[i - 1]);
+				chunk.corners.push_back(polygon[i]);
+			}
+		}
+
+		static void parseChunk(ObjChunk& chunk)
+		{
+			std::vector<FaceCorner> polygon;
+			const char* line = chunk.begin;
+			while (line < chunk.end)
+			{
+				const char* lineEnd = (const char*)memchr(line, '\n', chunk.end - line);
+				if (!lineEnd)
+				{
+					lineEnd = chunk.end;
+				}
+
+				const char* p = skipBlanks(line, lineEnd);
+				if (isKeyword(p, lineEnd, "v"))
+				{
+					glm::vec3 position(0.0f);
+					p = parseFloat(p + 1, lineEnd, position.x);
+					p = parseFloat(p, lineEnd, position.y);
+					parseFloat(p, lineEnd, position.z);
+					chunk.positions.push_back(position);
+				}
+				else if (isKeyword(p, lineEnd, "vn"))
+				{
+					glm::vec3 normal(0.0f);
+					p = parseFloat(p + 2, lineEnd, normal.x);
+					p = parseFloat(p, lineEnd, normal.y);
+					parseFloat(p, lineEnd, normal.z);
+					chunk.normals.push_back(normal);
+				}
+				else if (isKeyword(p, lineEnd, "vt"))
+				{
+					glm::vec2 uv(0.0f);
+					p = parseFloat(p + 2, lineEnd, uv.x);
+					parseFloat(p, lineEnd, uv.y);
+					// OBJ puts the texture origin at the bottom left
+					chunk.uvs.push_back(glm::vec2(uv.x, 1.0f - uv.y));
+				}
+				else if (isKeyword(p, lineEnd, "f"))
+				{
+					parseFace(p + 1, lineEnd, chunk, polygon);
+				}
+				else if (isKeyword(p, lineEnd, "usemtl"))
+				{
+					chunk.materialSwitches.push_back({ parseName(p + 6, lineEnd), (uint32_t)chunk.corners.size() });
+				}
+
+				line = lineEnd + 1;
+			}
+		}
+
+		// Chunk boundaries are moved past the next line break, so every line is parsed by exactly one chunk
+		static void splitChunks(const char* data, size_t size, uint32_t chunkCount, std::vector<ObjChunk>& chunks)
+		{
+			const char* end = data + size;
+			const char* begin = data;
+			for (uint32_t i = 1; i <= chunkCount && begin < end; ++i)
+			{
+				const char* chunkEnd = std::max(begin, data + size * i / chunkCount);
+				const char* lineBreak = chunkEnd < end ? (const char*)memchr(chunkEnd, '\n', end - chunkEnd) : nullptr;
+				chunkEnd = lineBreak ? lineBreak + 1 : end;
+
+				ObjChunk& chunk = chunks.emplace_back();
+				chunk.begin = begin;
+				chunk.end = chunkEnd;
+				begin = chunkEnd;
+			}
+		}
+
+		// Deduplicates the corners of a material into an indexed mesh and packs it
+		static Shared<PackedMesh> buildMesh(const ObjMaterial& material, const std::vector<glm::vec3>& positions,
+			const std::vector<glm::vec3>& normals, const std::vector<glm::vec2>& uvs)
+		{
+			size_t cornerCount = 0;
+			for (const CornerSpan& span : material.spans)
+			{
+				cornerCount += span.end - span.begin;
+			}
+
+			std::unordered_map<FaceCorner, uint32_t, CornerHash, CornerEqual> vertexIndices;
+			vertexIndices.reserve(cornerCount / 4);
+			std::vector<glm::vec3> meshPositions;
+			std::vector<glm::vec3> meshNormals;
+			std::vector<glm::vec2> meshUVs;
+			std::vector<uint32_t> indices;
+			indices.reserve(cornerCount);
+			bool hasNormals = false;
+			bool hasUVs = false;
+
+			for (const CornerSpan& span : material.spans)
+			{
+				for (uint32_t i = span.begin; i + 3 <= span.end; i += 3)
+				{
+					const FaceCorner* triangle = &span.chunk->corners[i];
+					bool valid = true;
+					for (uint32_t c = 0; c < 3; ++c)
+					{
+						valid &= triangle[c].position >= 0 && triangle[c].position < (int32_t)positions.size();
+					}
+					if (!valid)
+					{
+						continue;
+					}
+
+					for (uint32_t c = 0; c < 3; ++c)
+					{
+						FaceCorner corner = triangle[c];
+						if (corner.uv >= (int32_t)uvs.size())
+						{
+							corner.uv = -1;
+						}
+						if (corner.normal >= (int32_t)normals.size())
+						{
+							corner.normal = -1;
+						}
+						corner.uv = std::max(corner.uv, -1);
+						corner.normal = std::max(corner.normal, -1);
+
+						auto [entry, inserted] = vertexIndices.try_emplace(corner, (uint32_t)meshPositions.size());
+						if (inserted)
+						{
+							meshPositions.push_back(positions[corner.position]);
+							meshNormals.push_back(corner.normal >= 0 ? normals[corner.normal] : glm::vec3(0.0f, 0.0f, 1.0f));
+							meshUVs.push_back(corner.uv >= 0 ? uvs[corner.uv] : glm::vec2(0.0f));
+							hasNormals |= corner.normal >= 0;
+							hasUVs |= corner.uv >= 0;
+						}
+						indices.push_back(entry->second);
+					}
+				}
+			}
+
+			if (indices.empty())
+			{
+				return nullptr;
+			}
+
+			VertexStreams streams;
+			streams.positions = meshPositions.data();
+			streams.normals = hasNormals ? meshNormals.data() : nullptr;
+			streams.uvs = hasUVs ? meshUVs.data() : nullptr;
+			streams.vertexCount = (uint32_t)meshPositions.size();
+
+			Shared<PackedMesh> mesh = createShared<PackedMesh>();
+			GpuScene::packMesh(streams, indices.data(), (uint32_t)indices.size(), *mesh);
+			return mesh;
+		}
+	}
+
+	Shared<LoadedScene> loadOBJ(Renderer* renderer, ThreadPool& threadPool, const std::filesystem::path& path)
+	{
+		Clock::time_point start = Clock::now();
+		Shared<LoadedScene> scene = createShared<LoadedScene>();
+		scene->name = path.filename().string();
+		scene->gpuScene = renderer->getGpuScene();
+		SceneImportStats& stats = scene->stats;
+
+		MappedFile file;
+		if (!file.open(path))
+		{
+			LogError("Failed to map OBJ file {}", path.string());
+			return nullptr;
+		}
+
+		uint32_t chunkCount = (uint32_t)std::clamp<size_t>(file.getSize() / OBJ_MIN_CHUNK_SIZE, 1, threadPool.getThreadCount() * OBJ_CHUNKS_PER_THREAD);
+		std::vector<ObjChunk> chunks;
+		chunks.reserve(chunkCount);
+		splitChunks(file.getData(), file.getSize(), chunkCount, chunks);
+		threadPool.parallelFor((uint32_t)chunks.size(), [&](uint32_t i) { parseChunk(chunks[i]); });
+
+		// Streams are concatenated in file order, which turns chunk relative indices into file indices
+		std::vector<size_t> positionBase(chunks.size());
+		std::vector<size_t> normalBase(chunks.size());
+		std::vector<size_t> uvBase(chunks.size());
+		size_t positionCount = 0;
+		size_t normalCount = 0;
+		size_t uvCount = 0;
+		for (size_t i = 0; i < chunks.size(); ++i)
+		{
+			positionBase[i] = positionCount;
+			normalBase[i] = normalCount;
+			uvBase[i] = uvCount;
+			positionCount += chunks[i].positions.size();
+			normalCount += chunks[i].normals.size();
+			uvCount += chunks[i].uvs.size();
+		}
+
+		std::vector<glm::vec3> positions(positionCount);
+		std::vector<glm::vec3> normals(normalCount);
+		std::vector<glm::vec2> uvs(uvCount);
+		threadPool.parallelFor((uint32_t)chunks.size(), [&](uint32_t i)
+			{
+				ObjChunk& chunk = chunks[i];
+				std::copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + positionBase[i]);
+				std::copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + normalBase[i]);
+				std::copy(chunk.uvs.begin(), chunk.uvs.end(), uvs.begin() + uvBase[i]);
+
+				if (chunk.hasRelativeIndices)
+				{
+					for (FaceCorner& corner : chunk.corners)
+					{
+						corner.position += (corner.relativeMask & CornerPosition) ? (int32_t)positionBase[i] : 0;
+						corner.uv += (corner.relativeMask & CornerUV) ? (int32_t)uvBase[i] : 0;
+						corner.normal += (corner.relativeMask & CornerNormal) ? (int32_t)normalBase[i] : 0;
+					}
+				}
+			});
+
+		// Faces before the first usemtl of a chunk continue the material the previous chunk ended with
+		std::vector<ObjMaterial> materials;
+		std::unordered_map<std::string, uint32_t> materialIndices;
+		auto getMaterial = [&](const std::string& name)
+			{
+				auto [entry, inserted] = materialIndices.try_emplace(name, (uint32_t)materials.size());
+				if (inserted)
+				{
+					materials.emplace_back().name = name;
+				}
+				return entry->second;
+			};
+
+		uint32_t material = getMaterial("");
+		for (const ObjChunk& chunk : chunks)
+		{
+			uint32_t first = 0;
+			for (const MaterialSwitch& materialSwitch : chunk.materialSwitches)
+			{
+				if (materialSwitch.firstCorner > first)
+				{
+					materials[material].spans.push_back({ &chunk, first, materialSwitch.firstCorner });
+				}
+				material = getMaterial(materialSwitch.material);
+				first = materialSwitch.firstCorner;
+			}
+			if (chunk.corners.size() > first)
+			{
+				materials[material].spans.push_back({ &chunk, first, (uint32_t)chunk.corners.size() });
+			}
+		}
+
+		stats.parseMs = elapsedMs(start);
+
+		start = Clock::now();
+		std::vector<Shared<PackedMesh>> meshes(materials.size());
+		threadPool.parallelFor((uint32_t)materials.size(), [&](uint32_t i)
+			{
+				meshes[i] = buildMesh(materials[i], positions, normals, uvs);
+			});
+		stats.decodeMs = elapsedMs(start);
+
+		start = Clock::now();
+		for (const Shared<PackedMesh>& mesh : meshes)
+		{
+			if (mesh)
+			{
+				scene->addMesh(mesh);
+			}
+		}
+		stats.uploadMs = elapsedMs(start);
+
+		LogInfo("Imported {}: {:.1f} MB in {} chunks, {} instances, {} vertices, {} triangles. Parse {:.2f} ms, build {:.2f} ms on {} threads, upload {:.2f} ms",
+			scene->name, file.getSize() / (1024.0f * 1024.0f), chunks.size(), stats.instances, stats.vertices, stats.triangles,
+			stats.parseMs, stats.decodeMs, threadPool.getThreadCount(), stats.uploadMs);
+		return scene;
+	}
+}
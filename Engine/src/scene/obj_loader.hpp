@@ -0,0 +1,14 @@
+#pragma once
+#include "loaded_scene.hpp"
+#include <filesystem>
+
+namespace SE
+{
+	class Renderer;
+	class ThreadPool;
+
+	// Parses a memory mapped .obj in line aligned chunks on the thread pool, deduplicates the face corners of every
+	// material into an indexed mesh and adds one instance per material. The .mtl library is not read, materials only
+	// split the meshes until the renderer binds textures. Returns nullptr when the file can not be read
+	Shared<LoadedScene> loadOBJ(Renderer* renderer, ThreadPool& threadPool, const std::filesystem::path& path);
+}
@@ -0,0 +1,119 @@
+#include "mapped_file.hpp"
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace SE
+{
+	MappedFile::~MappedFile()
+	{
+		close();
+	}
+
+#ifdef _WIN32
+	bool MappedFile::open(const std::filesystem::path& path)
+	{
+		close();
+
+		HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			return false;
+		}
+		m_File = file;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+		{
+			close();
+			return false;
+		}
+
+		m_Mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!m_Mapping)
+		{
+			close();
+			return false;
+		}
+
+		m_Data = (const char*)MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0);
+		if (!m_Data)
+		{
+			close();
+			return false;
+		}
+		m_Size = (size_t)size.QuadPart;
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (m_Data)
+		{
+			UnmapViewOfFile(m_Data);
+		}
+		if (m_Mapping)
+		{
+			CloseHandle(m_Mapping);
+		}
+		if (m_File)
+		{
+			CloseHandle(m_File);
+		}
+		m_Data = nullptr;
+		m_Size = 0;
+		m_Mapping = nullptr;
+		m_File = nullptr;
+	}
+#else
+	bool MappedFile::open(const std::filesystem::path& path)
+	{
+		close();
+
+		m_File = ::open(path.c_str(), O_RDONLY);
+		if (m_File < 0)
+		{
+			return false;
+		}
+
+		struct stat info;
+		if (fstat(m_File, &info) != 0 || info.st_size == 0)
+		{
+			close();
+			return false;
+		}
+
+		void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, m_File, 0);
+		if (data == MAP_FAILED)
+		{
+			close();
+			return false;
+		}
+		madvise(data, (size_t)info.st_size, MADV_SEQUENTIAL);
+
+		m_Data = (const char*)data;
+		m_Size = (size_t)info.st_size;
+		return true;
+	}
+
+	void MappedFile::close()
+	{
+		if (m_Data)
+		{
+			munmap((void*)m_Data, m_Size);
+		}
+		if (m_File >= 0)
+		{
+			::close(m_File);
+		}
+		m_Data = nullptr;
+		m_Size = 0;
+		m_File = -1;
+	}
+#endif
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+
+namespace SE
+{
+	// Read-only view of a whole file, pages are loaded by the OS as they are touched
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		~MappedFile();
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool open(const std::filesystem::path& path);
+		void close();
+
+		const char* getData() const { return m_Data; }
+		size_t getSize() const { return m_Size; }
+
+	private:
+		const char* m_Data = nullptr;
+		size_t m_Size = 0;
+#ifdef _WIN32
+		void* m_File = nullptr;
+		void* m_Mapping = nullptr;
+#else
+		int m_File = -1;
+#endif
+	};
+}
@@ -9,6 +9,12 @@ namespace SE
 		rpmalloc_initialize();
 	}
 
+	// Threads created by the engine set up their heap before allocating
+	static inline void SE_INIT_THREAD_ALLOC()
+	{
+		rpmalloc_thread_initialize();
+	}
+
 	static inline void* SE_ALLOC(size_t size)
 	{
 		return rpmalloc(size);
@@ -0,0 +1,111 @@
+#include "thread_pool.hpp"
+#include "memory.hpp"
+#include <algorithm>
+
+namespace SE
+{
+	ThreadPool::ThreadPool(uint32_t workerCount)
+	{
+		if (workerCount == 0)
+		{
+			workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+		}
+
+		m_Workers.reserve(workerCount);
+		for (uint32_t i = 0; i < workerCount; ++i)
+		{
+			m_Workers.emplace_back(&ThreadPool::run, this);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Stop = true;
+		}
+		m_Condition.notify_all();
+		for (std::thread& worker : m_Workers)
+		{
+			worker.join();
+		}
+	}
+
+	void ThreadPool::parallelFor(uint32_t count, const std::function<void(uint32_t)>& func)
+	{
+		if (count == 0)
+		{
+			return;
+		}
+		if (count == 1 || m_Workers.empty())
+		{
+			for (uint32_t i = 0; i < count; ++i)
+			{
+				func(i);
+			}
+			return;
+		}
+
+		std::lock_guard<std::mutex> callLock(m_CallMutex);
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Func = &func;
+			m_Count = count;
+			m_NextIndex = 0;
+			++m_Generation;
+		}
+		m_Condition.notify_all();
+
+		process(func, count);
+
+		// Every index is claimed by now, wait for the workers still running theirs
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_DoneCondition.wait(lock, [&]() { return m_ActiveWorkers == 0; });
+		m_Func = nullptr;
+	}
+
+	void ThreadPool::process(const std::function<void(uint32_t)>& func, uint32_t count)
+	{
+		for (uint32_t i = m_NextIndex++; i < count; i = m_NextIndex++)
+		{
+			func(i);
+		}
+	}
+
+	void ThreadPool::run()
+	{
+		SE_INIT_THREAD_ALLOC();
+		uint64_t generation = 0;
+		while (true)
+		{
+			const std::function<void(uint32_t)>* func = nullptr;
+			uint32_t count = 0;
+			{
+				std::unique_lock<std::mutex> lock(m_Mutex);
+				m_Condition.wait(lock, [&]() { return m_Stop || m_Generation != generation; });
+				if (m_Stop)
+				{
+					break;
+				}
+
+				// A late wakeup may find the loop already finished, or joins the next one
+				generation = m_Generation;
+				if (!m_Func)
+				{
+					continue;
+				}
+				func = m_Func;
+				count = m_Count;
+				++m_ActiveWorkers;
+			}
+
+			process(*func, count);
+
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				--m_ActiveWorkers;
+			}
+			m_DoneCondition.notify_one();
+		}
+	}
+}
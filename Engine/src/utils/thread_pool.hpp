@@ -0,0 +1,40 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace SE
+{
+	// Fixed set of worker threads for data parallel loops, the calling thread works along with them
+	class ThreadPool
+	{
+	public:
+		// 0 uses one worker per hardware thread besides the caller
+		explicit ThreadPool(uint32_t workerCount = 0);
+		~ThreadPool();
+
+		// Runs func(i) for every i in [0, count) and returns once all of them finished. Not reentrant
+		void parallelFor(uint32_t count, const std::function<void(uint32_t)>& func);
+		uint32_t getThreadCount() const { return (uint32_t)m_Workers.size() + 1; }
+
+	private:
+		void run();
+		void process(const std::function<void(uint32_t)>& func, uint32_t count);
+
+		std::vector<std::thread> m_Workers;
+		std::mutex m_Mutex;
+		std::mutex m_CallMutex;
+		std::condition_variable m_Condition;
+		std::condition_variable m_DoneCondition;
+
+		const std::function<void(uint32_t)>* m_Func = nullptr;
+		uint32_t m_Count = 0;
+		std::atomic<uint32_t> m_NextIndex = 0;
+		uint32_t m_ActiveWorkers = 0;
+		uint64_t m_Generation = 0;
+		bool m_Stop = false;
+	};
+}
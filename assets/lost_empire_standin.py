@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+# Writes a stand-in for lost_empire.obj, which is not part of the repository. The output matches the layout and size of
+# the Mineways export: welded block corners, shared normals and texture coordinates, quads grouped by the 45 materials
+# of lost_empire.mtl and about 225k faces on 450k vertices. Usage: lost_empire_standin.py [output]
+import math
+import os
+import random
+import re
+import sys
+
+SIZE = 360
+SEED = 1337
+
+directory = os.path.dirname(os.path.abspath(__file__))
+output = sys.argv[1] if len(sys.argv) > 1 else os.path.join(directory, "lost_empire.obj")
+with open(os.path.join(directory, "lost_empire.mtl")) as mtl:
+	materials = re.findall(r"^newmtl (.+)$", mtl.read(), re.M)
+
+random.seed(SEED)
+phases = [random.uniform(0, 2 * math.pi) for _ in range(6)]
+
+def height(x, z):
+	h = 12 + 6 * math.sin(x * 0.05 + phases[0]) * math.cos(z * 0.04 + phases[1])
+	h += 3 * math.sin(x * 0.13 + z * 0.11 + phases[2]) + 1.5 * math.sin(z * 0.31 + phases[3])
+	return max(1, int(h))
+
+heights = [[height(x, z) for z in range(SIZE)] for x in range(SIZE)]
+
+def material(x, y, z, top):
+	if top:
+		return materials[(x // 16 + z // 16 * 3) % 8]
+	return materials[8 + (y * 7 + x // 8 + z // 8) % (len(materials) - 8)]
+
+# Corners are welded within a material only, like the Mineways export
+vertices = {}
+def vertex(name, x, y, z):
+	return vertices.setdefault((name, x, y, z), len(vertices) + 1)
+
+# Corners in counter clockwise order seen from outside, vt and vn are shared by all faces
+faces = {name: [] for name in materials}
+def quad(name, corners, normal):
+	faces[name].append([(vertex(name, *c), i + 1, normal) for i, c in enumerate(corners)])
+
+for x in range(SIZE):
+	for z in range(SIZE):
+		h = heights[x][z]
+		quad(material(x, h, z, True), [(x, h, z), (x, h, z + 1), (x + 1, h, z + 1), (x + 1, h, z)], 3)
+		for dx, dz, normal in ((1, 0, 1), (-1, 0, 2), (0, 1, 5), (0, -1, 6)):
+			nx, nz = x + dx, z + dz
+			neighbor = heights[nx][nz] if 0 <= nx < SIZE and 0 <= nz < SIZE else 0
+			for y in range(neighbor, h):
+				if dx == 1:
+					corners = [(x + 1, y, z), (x + 1, y + 1, z), (x + 1, y + 1, z + 1), (x + 1, y, z + 1)]
+				elif dx == -1:
+					corners = [(x, y, z + 1), (x, y + 1, z + 1), (x, y + 1, z), (x, y, z)]
+				elif dz == 1:
+					corners = [(x + 1, y, z + 1), (x + 1, y + 1, z + 1), (x, y + 1, z + 1), (x, y, z + 1)]
+				else:
+					corners = [(x, y, z), (x, y + 1, z), (x + 1, y + 1, z), (x + 1, y, z)]
+				quad(material(x, y, z, False), corners, normal)
+
+with open(output, "w", newline="\n") as obj:
+	obj.write("# Stand-in for the Mineways export of the Lost Empire scene\n")
+	obj.write("mtllib lost_empire.mtl\n\n")
+	for _, x, y, z in vertices:
+		obj.write(f"v {x * 0.5 - SIZE * 0.25:.6f} {y * 0.5:.6f} {z * 0.5 - SIZE * 0.25:.6f}\n")
+	obj.write("vt 0 0\nvt 0 1\nvt 1 1\nvt 1 0\n")
+	obj.write("vn 1 0 0\nvn -1 0 0\nvn 0 1 0\nvn 0 -1 0\nvn 0 0 1\nvn 0 0 -1\n")
+	faceCount = 0
+	for name, quads in faces.items():
+		if not quads:
+			continue
+		obj.write(f"\nusemtl {name}\n")
+		for corners in quads:
+			obj.write("f " + " ".join(f"{v}/{t}/{n}" for v, t, n in corners) + "\n")
+		faceCount += len(quads)
+
+print(f"{output}: {faceCount} faces, {len(vertices)} vertices, {len(materials)} materials")
@@ -12,8 +12,17 @@ PSInput VSMain(uint vertexId : SV_VertexID, uint instanceId : SV_InstanceID)
 {
 	PSInput output;
 
+	// One draw covers every instance, the shorter ones emit NaN positions which discard their trailing triangles
+	InstanceData instanceData = GetInstanceData(instanceId);
+	if (vertexId >= instanceData.indexCount)
+	{
+		output.position = asfloat(0x7FC00000).xxxx;
+		output.color = 0.0f;
+		return output;
+	}
+
 	CameraConstant cb = GetCameraCB();
-	Vertex v = GetVertex(instanceId, vertexId);
+	Vertex v = GetInstanceVertex(instanceData, GetInstanceVertexIndex(instanceData, vertexId));
 
 	float4 pos = mul(float4(v.position, 1.0f), cb.viewProjection);
 	output.position = pos;
@@ -5,6 +5,8 @@ struct CameraConstant
     float4x4 view;
     float4x4 projection;
     float4x4 viewProjection;
+    float4 position;
+    float4 frustumPlanes[6]; // xyz: normal pointing inside, w: distance
 };
 
 
@@ -12,7 +14,7 @@ struct SceneConstant
 {
     CameraConstant cameraCB;
    
-    uint instanceDataAddress;
+    uint instanceBufferSRV;
     uint sceneConstantBufferSRV;
     uint sceneStaticBufferSRV;
 
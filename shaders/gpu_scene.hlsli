@@ -1,17 +1,67 @@
 #pragma once
 #include "global_constants.hlsli"
 
+#define MAX_MESHLET_VERTICES 64
+#define MAX_MESHLET_TRIANGLES 124
+#define MESHLET_TASK_GROUP_SIZE 32
+
+#define INSTANCE_FLAG_16BIT_INDICES (1 << 0)
+
 struct InstanceData
 {
-    uint posBufferAddress;
+    float4 positionOffset; // xyz: minimum of the mesh bounds
+    float4 positionScale; // xyz: bounds extent / 65535, dequantizes the vertex positions
+
+    uint vertexBufferAddress; // PackedVertex stream
     uint indexBufferAddress;
+
+    uint meshletBufferAddress;
+    uint meshletVertexBufferAddress;
+    uint meshletTriangleBufferAddress;
+    uint meshletCount;
+    uint flags;
+    uint indexCount; // triangle list
+};
+
+// 20 bytes per vertex instead of 48 at full precision
+struct PackedVertex
+{
+    uint positionXY; // 16-bit unorm x and y inside the mesh bounds
+    uint positionZ; // 16-bit unorm z, bit 31 set for a negative tangent handedness
+    uint normal; // octahedral, two 16-bit snorm
+    uint tangent; // octahedral, two 16-bit snorm
+    uint uv; // two halfs
+};
+
+struct Meshlet
+{
+    float4 boundingSphere; // xyz: center, w: radius
+    float4 cone; // xyz: axis, w: cutoff, 1 disables cone culling
+
+    uint vertexOffset;
+    uint triangleOffset;
+    uint vertexCount;
+    uint triangleCount;
 };
 
 
 
+// Scatters packed instances from the scene constant buffer into the persistent instance buffer
+struct InstanceScatterConstants
+{
+    uint dataAddress; // InstanceData entries
+    uint indexAddress; // destination instance id of each entry
+    uint count;
+    uint srcBufferSRV;
+    uint instanceBufferUAV;
+};
+
 struct Vertex
 {
     float3 position;
+    float3 normal;
+    float4 tangent;
+    float2 uv;
 };
 
 #ifndef __cplusplus
@@ -38,34 +88,66 @@ T LoadSceneConstantBuffer(uint bufferAddress)
 
 InstanceData GetInstanceData(uint instance_id)
 {
-    return LoadSceneConstantBuffer < InstanceData > (SceneCB.instanceDataAddress + sizeof(InstanceData) * instance_id);
+    ByteAddressBuffer instanceBuffer = ResourceDescriptorHeap[SceneCB.instanceBufferSRV];
+    return instanceBuffer.Load < InstanceData > (sizeof(InstanceData) * instance_id);
 }
 
 
-//Vertex GetVertex(uint instance_id, uint vertex_id)
-//{
-//    InstanceData instanceData = GetInstanceData(instance_id);
+float3 DecodeOctahedral(uint packed)
+{
+    float2 e = clamp(float2(int(packed << 16) >> 16, int(packed) >> 16) / 32767.0, -1.0, 1.0);
+    float3 n = float3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
 
-//    Vertex v;
-//    v.position = LoadSceneStaticBuffer <
+Vertex GetInstanceVertex(InstanceData instanceData, uint vertex_index)
+{
+    PackedVertex packed = LoadSceneStaticBuffer < PackedVertex > (instanceData.vertexBufferAddress, vertex_index);
 
-//    float3 > (instanceData.posBufferAddress, vertex_id);
+    Vertex v;
+    float3 quantized = float3(packed.positionXY & 0xFFFF, packed.positionXY >> 16, packed.positionZ & 0xFFFF);
+    v.position = instanceData.positionOffset.xyz + quantized * instanceData.positionScale.xyz;
+    v.normal = DecodeOctahedral(packed.normal);
+    v.tangent = float4(DecodeOctahedral(packed.tangent), (packed.positionZ >> 31) ? -1.0 : 1.0);
+    v.uv = f16tof32(uint2(packed.uv & 0xFFFF, packed.uv >> 16));
+    return v;
+}
 
-//    return v;
-//}
+uint GetInstanceVertexIndex(InstanceData instanceData, uint index_id)
+{
+    if (instanceData.flags & INSTANCE_FLAG_16BIT_INDICES)
+    {
+        uint packed = LoadSceneStaticBuffer < uint > (instanceData.indexBufferAddress, index_id / 2);
+        return (index_id & 1) ? packed >> 16 : packed & 0xFFFF;
+    }
+    return LoadSceneStaticBuffer < uint > (instanceData.indexBufferAddress, index_id);
+}
 
 Vertex GetVertex(uint instance_id, uint vertex_id)
 {
     InstanceData instanceData = GetInstanceData(instance_id);
+    return GetInstanceVertex(instanceData, GetInstanceVertexIndex(instanceData, vertex_id));
+}
 
-    Vertex v;
-    v.position = LoadSceneStaticBuffer <
-
-    float3 > (instanceData.posBufferAddress, LoadSceneStaticBuffer <
-    uint > (instanceData.indexBufferAddress, vertex_id));
+Meshlet GetMeshlet(InstanceData instanceData, uint meshlet_id)
+{
+    return LoadSceneStaticBuffer < Meshlet > (instanceData.meshletBufferAddress, meshlet_id);
+}
 
-    return v;
+// Returns the instance vertex index of a meshlet-local vertex
+uint GetMeshletVertexIndex(InstanceData instanceData, Meshlet meshlet, uint local_vertex_id)
+{
+    return LoadSceneStaticBuffer < uint > (instanceData.meshletVertexBufferAddress, meshlet.vertexOffset + local_vertex_id);
 }
 
+// Triangles are packed as three 8-bit meshlet-local vertex indices
+uint3 GetMeshletTriangle(InstanceData instanceData, Meshlet meshlet, uint triangle_id)
+{
+    uint packed = LoadSceneStaticBuffer < uint > (instanceData.meshletTriangleBufferAddress, meshlet.triangleOffset + triangle_id);
+    return uint3(packed & 0xFF, (packed >> 8) & 0xFF, (packed >> 16) & 0xFF);
+}
 
 #endif //__cplusplus
\ No newline at end of file
@@ -0,0 +1,20 @@
+#include "gpu_scene.hlsli"
+
+ConstantBuffer<InstanceScatterConstants> ScatterCB : register(b1);
+
+[numthreads(64, 1, 1)]
+void CSMain(uint3 dispatchThreadId : SV_DispatchThreadID)
+{
+	uint entry = dispatchThreadId.x;
+	if (entry >= ScatterCB.count)
+	{
+		return;
+	}
+
+	ByteAddressBuffer srcBuffer = ResourceDescriptorHeap[ScatterCB.srcBufferSRV];
+	RWByteAddressBuffer instanceBuffer = ResourceDescriptorHeap[ScatterCB.instanceBufferUAV];
+
+	uint instanceId = srcBuffer.Load(ScatterCB.indexAddress + entry * 4);
+	InstanceData data = srcBuffer.Load < InstanceData > (ScatterCB.dataAddress + entry * sizeof(InstanceData));
+	instanceBuffer.Store < InstanceData > (instanceId * sizeof(InstanceData), data);
+}
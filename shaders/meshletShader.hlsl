@@ -0,0 +1,101 @@
+#include "global_constants.hlsli"
+#include "gpu_scene.hlsli"
+
+struct Payload
+{
+	uint instanceId;
+	uint meshletIds[MESHLET_TASK_GROUP_SIZE];
+};
+
+struct PSInput
+{
+	float4 position : SV_Position;
+	float3 color : COLOR;
+};
+
+groupshared Payload s_Payload;
+groupshared uint s_VisibleCount;
+
+bool IsMeshletVisible(Meshlet meshlet)
+{
+	CameraConstant cb = GetCameraCB();
+	float3 center = meshlet.boundingSphere.xyz;
+	float radius = meshlet.boundingSphere.w;
+
+	for (uint i = 0; i < 6; ++i)
+	{
+		if (dot(cb.frustumPlanes[i].xyz, center) + cb.frustumPlanes[i].w < -radius)
+		{
+			return false;
+		}
+	}
+
+	float3 view = center - cb.position.xyz;
+	if (dot(view, meshlet.cone.xyz) >= meshlet.cone.w * length(view) + radius)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+// Amplification Shader: one thread per meshlet, group Y is the instance
+[numthreads(MESHLET_TASK_GROUP_SIZE, 1, 1)]
+void ASMain(uint groupThreadId : SV_GroupThreadID, uint3 groupId : SV_GroupID)
+{
+	uint instanceId = groupId.y;
+	uint meshletId = groupId.x * MESHLET_TASK_GROUP_SIZE + groupThreadId;
+
+	if (groupThreadId == 0)
+	{
+		s_VisibleCount = 0;
+		s_Payload.instanceId = instanceId;
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	InstanceData instanceData = GetInstanceData(instanceId);
+	if (meshletId < instanceData.meshletCount && IsMeshletVisible(GetMeshlet(instanceData, meshletId)))
+	{
+		uint index;
+		InterlockedAdd(s_VisibleCount, 1, index);
+		s_Payload.meshletIds[index] = meshletId;
+	}
+	GroupMemoryBarrierWithGroupSync();
+
+	DispatchMesh(s_VisibleCount, 1, 1, s_Payload);
+}
+
+// Mesh Shader: one group per visible meshlet
+[numthreads(128, 1, 1)]
+[outputtopology("triangle")]
+void MSMain(uint groupThreadId : SV_GroupThreadID, uint3 groupId : SV_GroupID, in payload Payload payload,
+	out vertices PSInput outVertices[MAX_MESHLET_VERTICES], out indices uint3 outTriangles[MAX_MESHLET_TRIANGLES])
+{
+	InstanceData instanceData = GetInstanceData(payload.instanceId);
+	Meshlet meshlet = GetMeshlet(instanceData, payload.meshletIds[groupId.x]);
+
+	SetMeshOutputCounts(meshlet.vertexCount, meshlet.triangleCount);
+
+	CameraConstant cb = GetCameraCB();
+	if (groupThreadId < meshlet.vertexCount)
+	{
+		uint vertexIndex = GetMeshletVertexIndex(instanceData, meshlet, groupThreadId);
+		float3 position = GetInstanceVertex(instanceData, vertexIndex).position;
+
+		PSInput output;
+		output.position = mul(float4(position, 1.0f), cb.viewProjection);
+		output.color = position * 0.5f + 0.5f;
+		outVertices[groupThreadId] = output;
+	}
+
+	if (groupThreadId < meshlet.triangleCount)
+	{
+		outTriangles[groupThreadId] = GetMeshletTriangle(instanceData, meshlet, groupThreadId);
+	}
+}
+
+// Pixel Shader
+float4 PSMain(PSInput input) : SV_Target
+{
+	return float4(input.color, 1.0f);
+}